@@ -69,6 +69,7 @@ Integer nvim_buf_line_count(Buffer buffer, Error *err)
     return 0;
   }
 
+  ml_pt_finish(buf);
   return buf->b_ml.ml_line_count;
 }
 
@@ -486,23 +487,27 @@ void nvim_buf_set_lines(uint64_t channel_id,
   }
 
   // Now we may need to insert the remaining new old_len
-  for (size_t i = to_replace; i < new_len; i++) {
-    int64_t lnum = start + (int64_t)i - 1;
+  if (to_replace < new_len) {
+    int64_t lnum = start + (int64_t)to_replace - 1;
 
-    if (lnum >= MAXLNUM) {
+    if (lnum + (int64_t)(new_len - to_replace) > MAXLNUM) {
       api_set_error(err, kErrorTypeValidation, "Index value is too high");
       goto end;
     }
 
-    if (ml_append((linenr_T)lnum, (char_u *)lines[i], 0, false) == FAIL) {
+    linenr_T count = (linenr_T)(new_len - to_replace);
+    if (ml_append_lines((linenr_T)lnum, (char_u **)lines + to_replace, NULL,
+                        count, false) == FAIL) {
       api_set_error(err, kErrorTypeException, "Failed to insert line");
       goto end;
     }
 
     // Same as with replacing, but we also need to free lines
-    xfree(lines[i]);
-    lines[i] = NULL;
-    extra++;
+    for (size_t i = to_replace; i < new_len; i++) {
+      xfree(lines[i]);
+      lines[i] = NULL;
+    }
+    extra += count;
   }
 
   // Adjust marks. Invalidate any which lie in the
@@ -555,6 +560,7 @@ Integer nvim_buf_get_offset(Buffer buffer, Integer index, Error *err)
     return -1;
   }
 
+  ml_pt_finish(buf);
   if (index < 0 || index > buf->b_ml.ml_line_count) {
     api_set_error(err, kErrorTypeValidation, "Index out of bounds");
     return 0;
@@ -1199,6 +1205,7 @@ static void fix_cursor(linenr_T lo, linenr_T hi, linenr_T extra)
 // Normalizes 0-based indexes to buffer line numbers
 static int64_t normalize_index(buf_T *buf, int64_t index, bool *oob)
 {
+  ml_pt_finish(buf);
   int64_t line_count = buf->b_ml.ml_line_count;
   // Fix if < 0
   index = index < 0 ? line_count + index +1 : index;
@@ -8,6 +8,7 @@
 
 #include "nvim/vim.h"
 #include "nvim/ui.h"
+#include "nvim/garray.h"
 #include "nvim/memory.h"
 #include "nvim/map.h"
 #include "nvim/msgpack_rpc/channel.h"
@@ -15,11 +16,20 @@
 #include "nvim/api/private/defs.h"
 #include "nvim/api/private/helpers.h"
 #include "nvim/popupmnu.h"
+#include "nvim/schar.h"
 #include "nvim/cursor_shape.h"
 #include "nvim/highlight.h"
 #include "nvim/screen.h"
 #include "nvim/window.h"
 
+// Glyph numbers in a grid_line_packed event: below PACKED_GLYPH_NEW the ASCII
+// char itself, or 0 for the empty text.  PACKED_GLYPH_NEW is followed by the
+// text, which gets the next id from PACKED_GLYPH_FIRST on, up to
+// PACKED_GLYPH_MAX ids.
+#define PACKED_GLYPH_NEW 128
+#define PACKED_GLYPH_FIRST 129
+#define PACKED_GLYPH_MAX 4096
+
 #ifdef INCLUDE_GENERATED_DECLARATIONS
 # include "api/ui.c.generated.h"
 # include "ui_events_remote.generated.h"
@@ -35,6 +45,10 @@ typedef struct {
   // Position of legacy cursor, used both for drawing and visible user cursor.
   Integer client_row, client_col;
   bool wildmenu_active;
+
+  // Ids of the glyphs sent for ext_packedlines, by schar_T.
+  Map(int, int) *glyphs;
+  int glyph_count;
 } UIData;
 
 static PMap(uint64_t) *connected_uis = NULL;
@@ -54,6 +68,9 @@ void remote_ui_disconnect(uint64_t channel_id)
   }
   UIData *data = ui->data;
   api_free_array(data->buffer);  // Destroy pending screen updates.
+  if (data->glyphs) {
+    map_free(int, int)(data->glyphs);
+  }
   pmap_del(uint64_t)(connected_uis, channel_id);
   xfree(ui->data);
   ui->data = NULL;  // Flag UI as "stopped".
@@ -147,7 +164,8 @@ void nvim_ui_attach(uint64_t channel_id, Integer width, Integer height,
     }
   }
 
-  if (ui->ui_ext[kUIHlState] || ui->ui_ext[kUIMultigrid]) {
+  if (ui->ui_ext[kUIHlState] || ui->ui_ext[kUIMultigrid]
+      || ui->ui_ext[kUIPackedLines]) {
     ui->ui_ext[kUILinegrid] = true;
   }
 
@@ -164,6 +182,8 @@ void nvim_ui_attach(uint64_t channel_id, Integer width, Integer height,
   data->hl_id = 0;
   data->client_col = -1;
   data->wildmenu_active = false;
+  data->glyphs = NULL;
+  data->glyph_count = 0;
   ui->data = data;
 
   pmap_put(uint64_t)(connected_uis, channel_id, ui);
@@ -272,11 +292,13 @@ static void ui_set_option(UI *ui, bool init, String name, Object value,
         return;
       }
       bool boolval = value.data.boolean;
-      if (!init && i == kUILinegrid && boolval != ui->ui_ext[i]) {
+      if (!init && (i == kUILinegrid || i == kUIPackedLines)
+          && boolval != ui->ui_ext[i]) {
         // There shouldn't be a reason for an UI to do this ever
         // so explicitly don't support this.
         api_set_error(error, kErrorTypeValidation,
-                      "ext_linegrid option cannot be changed");
+                      "%s option cannot be changed", ui_ext_names[i]);
+        return;
       }
       ui->ui_ext[i] = boolval;
       if (!init) {
@@ -513,7 +535,10 @@ static void remote_ui_raw_line(UI *ui, Integer grid, Integer row,
                                const sattr_T *attrs)
 {
   UIData *data = ui->data;
-  if (ui->ui_ext[kUILinegrid]) {
+  if (ui->ui_ext[kUIPackedLines]) {
+    remote_ui_raw_line_packed(ui, grid, row, startcol, endcol, clearcol,
+                              clearattr, chunk, attrs);
+  } else if (ui->ui_ext[kUILinegrid]) {
     Array args = ARRAY_DICT_INIT;
     ADD(args, INTEGER_OBJ(grid));
     ADD(args, INTEGER_OBJ(row));
@@ -525,9 +550,11 @@ static void remote_ui_raw_line(UI *ui, Integer grid, Integer row,
     for (size_t i = 0; i < ncells; i++) {
       repeat++;
       if (i == ncells-1 || attrs[i] != attrs[i+1]
-          || STRCMP(chunk[i], chunk[i+1])) {
+          || chunk[i] != chunk[i+1]) {
+        char text[MAX_SCHAR_SIZE];
+        size_t len = schar_get(text, chunk[i]);
         Array cell = ARRAY_DICT_INIT;
-        ADD(cell, STRING_OBJ(cstr_to_string((const char *)chunk[i])));
+        ADD(cell, STRING_OBJ(cbuf_to_string(text, len)));
         if (attrs[i] != last_hl || repeat > 1) {
           ADD(cell, INTEGER_OBJ(attrs[i]));
           last_hl = attrs[i];
@@ -551,10 +578,12 @@ static void remote_ui_raw_line(UI *ui, Integer grid, Integer row,
     push_call(ui, "grid_line", args);
   } else {
     for (int i = 0; i < endcol-startcol; i++) {
+      char text[MAX_SCHAR_SIZE];
+      schar_get(text, chunk[i]);
       remote_ui_cursor_goto(ui, row, startcol+i);
       remote_ui_highlight_set(ui, attrs[i]);
-      remote_ui_put(ui, (const char *)chunk[i]);
-      if (utf_ambiguous_width(utf_ptr2char(chunk[i]))) {
+      remote_ui_put(ui, text);
+      if (utf_ambiguous_width(utf_ptr2char((char_u *)text))) {
         data->client_col = -1;  // force cursor update
       }
     }
@@ -575,6 +604,91 @@ static void remote_ui_raw_line(UI *ui, Integer grid, Integer row,
   }
 }
 
+/// The grid_line_packed event, for a UI with ext_packedlines: the cells as
+/// runs in a string of bytes.  See |ui-event-grid_line_packed|.
+static void remote_ui_raw_line_packed(UI *ui, Integer grid, Integer row,
+                                      Integer startcol, Integer endcol,
+                                      Integer clearcol, Integer clearattr,
+                                      const schar_T *chunk,
+                                      const sattr_T *attrs)
+{
+  UIData *data = ui->data;
+  if (!data->glyphs) {
+    data->glyphs = map_new(int, int)();
+  }
+
+  garray_T ga;
+  ga_init(&ga, 1, 64);
+  size_t ncells = (size_t)(endcol-startcol);
+  int last_hl = -1;
+  size_t start = 0;
+  for (size_t i = 0; i < ncells; i++) {
+    if (i == ncells-1 || attrs[i] != attrs[i+1]
+        || chunk[i] != chunk[i+1]) {
+      packed_put_run(ui, &ga, chunk[i], attrs[i], i + 1 - start, &last_hl);
+      start = i + 1;
+    }
+  }
+  if (endcol < clearcol) {
+    packed_put_run(ui, &ga, SCHAR_SPACE, (int)clearattr,
+                   (size_t)(clearcol-endcol), &last_hl);
+  }
+  if (ga.ga_len == 0) {
+    return;
+  }
+
+  Array args = ARRAY_DICT_INIT;
+  ADD(args, INTEGER_OBJ(grid));
+  ADD(args, INTEGER_OBJ(row));
+  ADD(args, INTEGER_OBJ(startcol));
+  ADD(args, STRING_OBJ(ga_take_string(&ga)));
+  push_call(ui, "grid_line_packed", args);
+}
+
+/// Append a run of "count" cells with text "sc" and highlight "hl".  The
+/// highlight is left out when it is "*last_hl".
+static void packed_put_run(UI *ui, garray_T *ga, schar_T sc, int hl,
+                           size_t count, int *last_hl)
+{
+  bool has_hl = hl != *last_hl;
+  packed_put_num(ga, ((uint64_t)count << 1) | has_hl);
+  if (has_hl) {
+    packed_put_num(ga, (uint64_t)hl);
+    *last_hl = hl;
+  }
+
+  UIData *data = ui->data;
+  char text[MAX_SCHAR_SIZE];
+  size_t len = schar_get(text, sc);
+  if (len == 0 || (len == 1 && (uint8_t)text[0] < PACKED_GLYPH_NEW)) {
+    packed_put_num(ga, len == 0 ? 0 : (uint8_t)text[0]);
+    return;
+  }
+  int id = map_get(int, int)(data->glyphs, (int)sc);
+  if (id != 0) {
+    packed_put_num(ga, (uint64_t)id);
+    return;
+  }
+  packed_put_num(ga, PACKED_GLYPH_NEW);
+  packed_put_num(ga, len);
+  ga_concat_len(ga, text, len);
+  if (data->glyph_count < PACKED_GLYPH_MAX) {
+    map_put(int, int)(data->glyphs, (int)sc,
+                      PACKED_GLYPH_FIRST + data->glyph_count++);
+  }
+}
+
+/// Append "n" as an unsigned LEB128 number: seven bits in a byte, the lowest
+/// first, with the high bit set when more bytes follow.
+static void packed_put_num(garray_T *ga, uint64_t n)
+{
+  do {
+    uint8_t byte = n & 0x7f;
+    n >>= 7;
+    ga_append(ga, (char)(byte | (n ? 0x80 : 0)));
+  } while (n);
+}
+
 static void remote_ui_flush(UI *ui)
 {
   UIData *data = ui->data;
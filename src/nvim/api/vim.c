@@ -29,6 +29,7 @@
 #include "nvim/screen.h"
 #include "nvim/memline.h"
 #include "nvim/memory.h"
+#include "nvim/schar.h"
 #include "nvim/message.h"
 #include "nvim/popupmnu.h"
 #include "nvim/edit.h"
@@ -2119,6 +2120,16 @@ Float nvim__id_float(Float flt)
   return flt;
 }
 
+/// Gets a counter that another thread adds to.
+static int64_t stat_get(int64_t *stat)
+{
+#if defined(__GNUC__) || defined(__clang__)
+  return __atomic_load_n(stat, __ATOMIC_RELAXED);
+#else
+  return *stat;
+#endif
+}
+
 /// Gets internal stats.
 ///
 /// @return Map of various internal stats.
@@ -2127,6 +2138,15 @@ Dictionary nvim__stats(void)
   Dictionary rv = ARRAY_DICT_INIT;
   PUT(rv, "fsync", INTEGER_OBJ(g_stats.fsync));
   PUT(rv, "redraw", INTEGER_OBJ(g_stats.redraw));
+  PUT(rv, "mf_hit", INTEGER_OBJ(g_stats.mf_hit));
+  PUT(rv, "mf_miss", INTEGER_OBJ(g_stats.mf_miss));
+  PUT(rv, "mf_evict", INTEGER_OBJ(g_stats.mf_evict));
+  PUT(rv, "redraw_deferred", INTEGER_OBJ(g_stats.redraw_deferred));
+  PUT(rv, "redraw_time", INTEGER_OBJ(g_stats.redraw_time));
+  PUT(rv, "redraw_time_max", INTEGER_OBJ(g_stats.redraw_time_max));
+  PUT(rv, "tui_bytes", INTEGER_OBJ(stat_get(&g_stats.tui_bytes)));
+  PUT(rv, "tui_merged", INTEGER_OBJ(stat_get(&g_stats.tui_merged)));
+  PUT(rv, "tui_waits", INTEGER_OBJ(stat_get(&g_stats.tui_waits)));
   return rv;
 }
 
@@ -2283,7 +2303,9 @@ Array nvim__inspect_cell(Integer grid, Integer row, Integer col, Error *err)
     return ret;
   }
   size_t off = g->line_offset[(size_t)row] + (size_t)col;
-  ADD(ret, STRING_OBJ(cstr_to_string((char *)g->chars[off])));
+  char text[MAX_SCHAR_SIZE];
+  schar_get(text, g->chars[off]);
+  ADD(ret, STRING_OBJ(cstr_to_string(text)));
   int attr = g->attrs[off];
   ADD(ret, DICTIONARY_OBJ(hl_get_attr_by_id(attr, true, err)));
   // will not work first time
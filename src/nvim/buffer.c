@@ -294,8 +294,10 @@ int open_buffer(
     changed();
   } else if (retval != FAIL && !read_stdin && !read_fifo) {
     unchanged(curbuf, false);
+    buf_hash_text(curbuf, 0);           // for reloading only what changed
   }
   save_file_ff(curbuf);                 // keep this fileformat
+  buf_follow_update(curbuf);            // watch the file for 'followfile'
 
   // Set last_changedtick to avoid triggering a TextChanged autocommand right
   // after it was added.
@@ -737,6 +739,8 @@ void buf_freeall(buf_T *buf, int flags)
     }
   }
 
+  buf_follow_stop(buf);
+  kv_destroy(buf->b_file_hashes);
   ml_close(buf, true);              // close and delete the memline/memfile
   buf->b_ml.ml_line_count = 0;      // no lines in buffer
   if ((flags & BFA_KEEP_UNDO) == 0) {
@@ -1916,6 +1920,7 @@ void free_buf_options(buf_T *buf, int free_p_ff)
   clear_string_option(&buf->b_p_com);
   clear_string_option(&buf->b_p_cms);
   clear_string_option(&buf->b_p_nf);
+  clear_string_option(&buf->b_p_bst);
   clear_string_option(&buf->b_p_syn);
   clear_string_option(&buf->b_s.b_syn_isk);
   clear_string_option(&buf->b_s.b_p_spc);
@@ -2780,6 +2785,7 @@ void buf_name_changed(buf_T *buf)
   status_redraw_all();          // status lines need to be redrawn
   fmarks_check_names(buf);      // check named file marks
   ml_timestamp(buf);            // reset timestamp
+  buf_follow_restart(buf);      // watch the file with the new name
 }
 
 /*
@@ -3107,7 +3113,7 @@ void maketitle(void)
         called_emsg = false;
         build_stl_str_hl(curwin, (char_u *)buf, sizeof(buf),
                          p_titlestring, use_sandbox,
-                         0, maxlen, NULL, NULL);
+                         0, maxlen, NULL, NULL, NULL);
         t_str = (char_u *)buf;
         if (called_emsg) {
           set_string_option_direct((char_u *)"titlestring", -1, (char_u *)"",
@@ -3218,7 +3224,7 @@ void maketitle(void)
         called_emsg = false;
         build_stl_str_hl(curwin, i_str, sizeof(buf),
             p_iconstring, use_sandbox,
-            0, 0, NULL, NULL);
+            0, 0, NULL, NULL, NULL);
         if (called_emsg)
           set_string_option_direct((char_u *)"iconstring", -1,
               (char_u *)"", OPT_FREE, SID_ERROR);
@@ -3326,6 +3332,8 @@ typedef enum {
 /// @param maxwidth The maximum width to make the statusline
 /// @param hltab HL attributes (can be NULL)
 /// @param tabtab Tab clicks definition (can be NULL).
+/// @param[out] deps Set to the STL_DEP_ flags for what the result depends on
+///                  (can be NULL).
 ///
 /// @return The final width of the statusline
 int build_stl_str_hl(
@@ -3337,7 +3345,8 @@ int build_stl_str_hl(
     char_u fillchar,
     int maxwidth,
     struct stl_hlrec *hltab,
-    StlClickRecord *tabtab
+    StlClickRecord *tabtab,
+    int *deps
 )
 {
   int groupitems[STL_MAX_ITEM];
@@ -3367,10 +3376,12 @@ int build_stl_str_hl(
   const int save_must_redraw = must_redraw;
   const int save_redr_type = curwin->w_redr_type;
   const int save_highlight_shcnaged = need_highlight_changed;
+  int stl_deps = 0;
 
   // When the format starts with "%!" then evaluate it as an expression and
   // use the result as the actual format string.
   if (fmt[0] == '%' && fmt[1] == '!') {
+    stl_deps |= STL_DEP_ANY;
     usefmt = eval_to_string_safe(fmt + 2, NULL, use_sandbox);
     if (usefmt == NULL) {
       usefmt = fmt;
@@ -3771,6 +3782,7 @@ int build_stl_str_hl(
     case STL_VIM_EXPR:     // '{'
     {
       itemisflag = true;
+      stl_deps |= STL_DEP_ANY;
 
       // Attempt to copy the expression to evaluate into
       // the output buffer as a null-terminated string.
@@ -3822,6 +3834,7 @@ int build_stl_str_hl(
     }
 
     case STL_LINE:
+      stl_deps |= STL_DEP_CURSOR;
       num = (wp->w_buffer->b_ml.ml_flags & ML_EMPTY)
             ? 0L : (long)(wp->w_cursor.lnum);
       break;
@@ -3831,6 +3844,7 @@ int build_stl_str_hl(
       break;
 
     case STL_COLUMN:
+      stl_deps |= STL_DEP_CURSOR;
       num = !(State & INSERT) && empty_line
             ? 0 : (int)wp->w_cursor.col + 1;
       break;
@@ -3838,6 +3852,7 @@ int build_stl_str_hl(
     case STL_VIRTCOL:
     case STL_VIRTCOL_ALT:
     {
+      stl_deps |= STL_DEP_CURSOR;
       // In list mode virtcol needs to be recomputed
       colnr_T virtcol = wp->w_virtcol;
       if (wp->w_p_list && wp->w_p_lcs_chars.tab1 == NUL) {
@@ -3856,11 +3871,13 @@ int build_stl_str_hl(
     }
 
     case STL_PERCENTAGE:
+      stl_deps |= STL_DEP_CURSOR;
       num = (int)(((long)wp->w_cursor.lnum * 100L) /
                   (long)wp->w_buffer->b_ml.ml_line_count);
       break;
 
     case STL_ALTPERCENT:
+      stl_deps |= STL_DEP_VIEW;
       // Store the position percentage in our temporary buffer.
       // Note: We cannot store the value in `num` because
       //       `get_rel_pos` can return a named position. Ex: "Top"
@@ -3886,11 +3903,13 @@ int build_stl_str_hl(
 
     case STL_KEYMAP:
       fillable = false;
+      stl_deps |= STL_DEP_ANY;  // evaluates "b:keymap_name"
       if (get_keymap_str(wp, (char_u *)"<%s>", tmp, TMPLEN)) {
         str = tmp;
       }
       break;
     case STL_PAGENUM:
+      stl_deps |= STL_DEP_ANY;
       num = printer_page_num;
       break;
 
@@ -3903,6 +3922,7 @@ int build_stl_str_hl(
       FALLTHROUGH;
     case STL_OFFSET:
     {
+      stl_deps |= STL_DEP_CURSOR;
       long l = ml_find_line_or_offset(wp->w_buffer, wp->w_cursor.lnum, NULL,
                                       false);
       num = (wp->w_buffer->b_ml.ml_flags & ML_EMPTY) || l < 0 ?
@@ -3914,6 +3934,7 @@ int build_stl_str_hl(
       base = kNumBaseHexadecimal;
       FALLTHROUGH;
     case STL_BYTEVAL:
+      stl_deps |= STL_DEP_CURSOR;
       num = byteval;
       if (num == NL) {
         num = 0;
@@ -4437,6 +4458,9 @@ int build_stl_str_hl(
   curwin->w_redr_type = save_redr_type;
   need_highlight_changed = save_highlight_shcnaged;
 
+  if (deps != NULL) {
+    *deps = stl_deps;
+  }
   return width;
 }
 
@@ -59,6 +59,14 @@ enum bfa_values {
   BFA_KEEP_UNDO = 4, // do not free undo information
 };
 
+// What the result of build_stl_str_hl() depends on, besides the buffer of
+// the window and "state_tick"
+enum stl_dep_values {
+  STL_DEP_CURSOR = 1,  // cursor position, the text under it and the mode
+  STL_DEP_VIEW   = 2,  // the lines shown in the window
+  STL_DEP_ANY    = 4,  // an expression, which may use any state
+};
+
 #ifdef INCLUDE_GENERATED_DECLARATIONS
 # include "buffer.h.generated.h"
 #endif
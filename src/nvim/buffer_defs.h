@@ -537,6 +537,13 @@ struct file_buffer {
   long b_mtime;                 /* last change time of original file */
   long b_mtime_read;            /* last change time when reading */
   uint64_t b_orig_size;         /* size of original file in bytes */
+  struct fs_event_watcher *b_follow_watcher;  ///< for 'followfile'
+  bool b_follow_dir;            ///< b_follow_watcher watches the directory
+  long b_follow_seq;            ///< b_u_seq_last after appending lines
+  kvec_t(uint64_t) b_file_hashes;  ///< hash of each range of the text as in
+                                   ///< the file, see buf_hash_text()
+  long b_file_hash_size;        ///< number of bytes in b_file_hashes
+  varnumber_T b_file_hash_tick;  ///< b:changedtick for b_file_hashes
   int b_orig_mode;              /* mode of original file */
 
   fmark_T b_namedm[NMARKS];     /* current named marks (mark.c) */
@@ -633,6 +640,7 @@ struct file_buffer {
   int b_p_bin;                  ///< 'binary'
   int b_p_bomb;                 ///< 'bomb'
   char_u *b_p_bh;               ///< 'bufhidden'
+  char_u *b_p_bst;              ///< 'bufstorage'
   char_u *b_p_bt;               ///< 'buftype'
   int b_has_qf_entry;           ///< quickfix exists for buffer
   int b_p_bl;                   ///< 'buflisted'
@@ -648,6 +656,7 @@ struct file_buffer {
   char_u *b_p_ofu;              ///< 'omnifunc'
   int b_p_eol;                  ///< 'endofline'
   int b_p_fixeol;               ///< 'fixendofline'
+  int b_p_fof;                  ///< 'followfile'
   int b_p_et;                   ///< 'expandtab'
   int b_p_et_nobin;             ///< b_p_et saved for binary mode
   int b_p_et_nopaste;           ///< b_p_et saved for paste mode
@@ -1015,6 +1024,25 @@ typedef struct {
                                           .focusable = true, \
                                           .style = kWinStyleUnused })
 
+/// A line of a window as drawn by win_line(), see win_linecache_put().
+typedef struct {
+  linenr_T lce_lnum;            ///< buffer line, zero when not used
+  varnumber_T lce_changedtick;  ///< b:changedtick when it was drawn
+  colnr_T lce_leftcol;          ///< w_leftcol when it was drawn
+  int lce_width;                ///< number of cells
+  schar_T *lce_chars;
+  sattr_T *lce_attrs;
+} linecache_entry_T;
+
+/// A status line as built before, see win_redr_custom().
+typedef struct stl_cache stl_cache_T;
+
+/// Matches of the 'hlsearch' pattern found before, see search_hl_cached().
+typedef struct search_hl_cache search_hl_cache_T;
+
+/// Virtual columns of a long line, see vcol_index_get().
+typedef struct vcol_index vcol_index_T;
+
 // Structure to store last cursor position and topline.  Used by check_lnums()
 // and reset_lnums().
 typedef struct
@@ -1287,6 +1315,15 @@ struct window_S {
   int w_tagstacklen;                    /* number of tags on stack */
 
   ScreenGrid w_grid;                    // the grid specific to the window
+  linecache_entry_T *w_linecache;       ///< drawn lines, NULL or
+                                        ///< LINECACHE_SIZE entries
+  handle_T w_linecache_buf;             ///< buffer of the w_linecache lines
+  stl_cache_T *w_stl_cache;             ///< status line, NULL when not
+                                        ///< built yet
+  search_hl_cache_T *w_search_hl_cache;  ///< 'hlsearch' matches, NULL
+                                         ///< when not used
+  vcol_index_T *w_vcol_index;           ///< virtual columns of a long line,
+                                        ///< NULL when not used
   bool w_pos_changed;                   // true if window position changed
   bool w_floating;                       ///< whether the window is floating
   FloatConfig w_float_config;
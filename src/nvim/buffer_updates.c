@@ -23,6 +23,8 @@ bool buf_updates_register(buf_T *buf, uint64_t channel_id,
   if (buf->b_ml.ml_mfp == NULL) {
     return false;
   }
+  // Updates are sent for lines added from here on, see ml_pt_finish().
+  ml_pt_finish(buf);
 
   if (channel_id == LUA_INTERNAL_CALL) {
     kv_push(buf->update_callbacks, cb);
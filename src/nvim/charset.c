@@ -30,6 +30,36 @@
 #include "nvim/strings.h"
 #include "nvim/path.h"
 #include "nvim/cursor.h"
+#include "nvim/buffer.h"
+#include "nvim/lib/kvec.h"
+
+// Virtual columns of a long line are remembered every VCOL_INDEX_STEP bytes,
+// so that getvcol() and win_line() only walk the line from the checkpoint
+// before the wanted position, instead of from its start.  This only works
+// when the size of a character depends on nothing but the character and
+// its virtual column: not with 'linebreak', 'showbreak', 'breakindent' or
+// 'list' showing a tab as ^I, see vcol_index_usable().
+#define VCOL_INDEX_STEP 1024
+
+/// Byte index "col" of a line starts a character at virtual column "vcol".
+typedef struct {
+  colnr_T col;
+  colnr_T vcol;
+} VcolCheckpoint;
+
+struct vcol_index {
+  handle_T buf;             ///< buffer of the line
+  linenr_T lnum;            ///< line number
+  varnumber_T changedtick;  ///< b:changedtick when the index was started
+  const char_u *line;       ///< text of the line
+  int tick;                 ///< vcol_index_tick when the index was started
+  long ts;                  ///< 'tabstop'
+  int wrap;                 ///< 'wrap', a double-width char may wrap early
+  int width;                ///< w_width_inner, with 'wrap' only
+  int col_off;              ///< win_col_off(), with 'wrap' only
+  int col_off2;             ///< win_col_off2(), with 'wrap' only
+  kvec_t(VcolCheckpoint) cps;  ///< checkpoints, the first one is (0, 0)
+};
 
 #ifdef INCLUDE_GENERATED_DECLARATIONS
 # include "charset.c.generated.h"
@@ -38,6 +68,9 @@
 
 static bool chartab_initialized = false;
 
+/// Incremented when the cell width of characters changed.
+static int vcol_index_tick = 0;
+
 // b_chartab[] is an array with 256 bits, each bit representing one of the
 // characters 0-255.
 #define SET_CHARTAB(buf, c) \
@@ -98,6 +131,8 @@ int buf_init_chartab(buf_T *buf, int global)
   bool do_isalpha;
 
   if (global) {
+    vcol_index_invalidate();
+
     // Set the default size for printable characters:
     // From <Space> to '~' is 1 (printable), others are 2 (not printable).
     // This also inits all 'isident' and 'isfname' flags to false.
@@ -1187,6 +1222,158 @@ bool in_win_border(win_T *wp, colnr_T vcol)
   return (vcol - width1) % width2 == width2 - 1;
 }
 
+/// Return true when the size of a character in window "wp" only depends on
+/// the character and its virtual column, so that the simple loop of
+/// getvcol() and the virtual column index can be used.
+static inline bool vcol_index_usable(const win_T *wp)
+  FUNC_ATTR_PURE FUNC_ATTR_WARN_UNUSED_RESULT FUNC_ATTR_NONNULL_ALL
+{
+  return (!wp->w_p_list || (wp->w_p_lcs_chars.tab1 != NUL))
+         && !wp->w_p_lbr
+         && (*p_sbr == NUL)
+         && !wp->w_p_bri;
+}
+
+/// Forget all virtual column indexes, when the cell width of characters
+/// changed.
+void vcol_index_invalidate(void)
+{
+  vcol_index_tick++;
+}
+
+/// Get the virtual column index of line "lnum" with text "line" in window
+/// "wp".  It is started again when the line or anything its virtual columns
+/// depend on changed.
+static vcol_index_T *vcol_index_get(win_T *wp, linenr_T lnum,
+                                    const char_u *line)
+  FUNC_ATTR_NONNULL_ALL FUNC_ATTR_NONNULL_RET
+{
+  buf_T *const buf = wp->w_buffer;
+  const int wrap = wp->w_p_wrap;
+  const int width = wrap ? wp->w_width_inner : 0;
+  const int col_off = wrap ? win_col_off(wp) : 0;
+  const int col_off2 = wrap ? win_col_off2(wp) : 0;
+  vcol_index_T *vi = wp->w_vcol_index;
+
+  if (vi == NULL) {
+    vi = wp->w_vcol_index = xcalloc(1, sizeof(vcol_index_T));
+    kv_init(vi->cps);
+  } else if (vi->buf == buf->handle
+             && vi->lnum == lnum
+             && vi->changedtick == buf_get_changedtick(buf)
+             && vi->line == line
+             && vi->tick == vcol_index_tick
+             && vi->ts == buf->b_p_ts
+             && vi->wrap == wrap
+             && vi->width == width
+             && vi->col_off == col_off
+             && vi->col_off2 == col_off2) {
+    return vi;
+  }
+  vi->buf = buf->handle;
+  vi->lnum = lnum;
+  vi->changedtick = buf_get_changedtick(buf);
+  vi->line = line;
+  vi->tick = vcol_index_tick;
+  vi->ts = buf->b_p_ts;
+  vi->wrap = wrap;
+  vi->width = width;
+  vi->col_off = col_off;
+  vi->col_off2 = col_off2;
+  kv_size(vi->cps) = 0;
+  kv_push(vi->cps, ((VcolCheckpoint) { 0, 0 }));
+  return vi;
+}
+
+/// Add checkpoints to index "vi" of "line", until byte index "col" or
+/// virtual column "vcol" is reached.
+static void vcol_index_extend(win_T *wp, vcol_index_T *vi, char_u *line,
+                              colnr_T col, colnr_T vcol)
+  FUNC_ATTR_NONNULL_ALL
+{
+  const int ts = (int)vi->ts;
+  const VcolCheckpoint last = kv_last(vi->cps);
+  char_u *ptr = line + last.col;
+  colnr_T v = last.vcol;
+  colnr_T next = last.col + VCOL_INDEX_STEP;
+
+  if (col < next || vcol - last.vcol < VCOL_INDEX_STEP) {
+    // Close enough to the last checkpoint.
+    return;
+  }
+  while (*ptr != NUL && ptr - line < col && v < vcol) {
+    if (ptr - line >= next) {
+      kv_push(vi->cps, ((VcolCheckpoint) { (colnr_T)(ptr - line), v }));
+      next = (colnr_T)(ptr - line) + VCOL_INDEX_STEP;
+    }
+    // Same as the simple loop in getvcol().
+    int incr;
+    if (*ptr == TAB) {
+      incr = ts - (v % ts);
+    } else {
+      incr = *ptr >= 0x80 ? utf_ptr2cells(ptr) : g_chartab[*ptr] & CT_CELL_MASK;
+      if (incr == 2 && wp->w_p_wrap && MB_BYTE2LEN(*ptr) > 1
+          && in_win_border(wp, v)) {
+        incr++;
+      }
+    }
+    v += incr;
+    MB_PTR_ADV(ptr);
+  }
+}
+
+/// Find the last checkpoint of index "vi" at or before byte index "col" and
+/// virtual column "vcol".
+static VcolCheckpoint vcol_index_find(const vcol_index_T *vi, colnr_T col,
+                                      colnr_T vcol)
+  FUNC_ATTR_NONNULL_ALL FUNC_ATTR_PURE
+{
+  size_t lo = 0;
+  size_t hi = kv_size(vi->cps);
+  while (hi - lo > 1) {
+    const size_t mid = lo + (hi - lo) / 2;
+    const VcolCheckpoint cp = kv_A(vi->cps, mid);
+    if (cp.col <= col && cp.vcol <= vcol) {
+      lo = mid;
+    } else {
+      hi = mid;
+    }
+  }
+  return kv_A(vi->cps, lo);
+}
+
+/// Find where to start looking for virtual column "vcol" in line "lnum" of
+/// window "wp", with text "line", without walking over the whole line.
+///
+/// @param[out] vcolp  virtual column of the returned character.
+///
+/// @return  Pointer to a character in "line" at or before virtual column
+///          "vcol".
+char_u *vcol_index_skip(win_T *wp, linenr_T lnum, char_u *line, colnr_T vcol,
+                        colnr_T *vcolp)
+  FUNC_ATTR_NONNULL_ALL FUNC_ATTR_NONNULL_RET
+{
+  if (vcol < VCOL_INDEX_STEP || !vcol_index_usable(wp)) {
+    *vcolp = 0;
+    return line;
+  }
+  vcol_index_T *vi = vcol_index_get(wp, lnum, line);
+  vcol_index_extend(wp, vi, line, MAXCOL, vcol);
+  const VcolCheckpoint cp = vcol_index_find(vi, MAXCOL, vcol);
+  *vcolp = cp.vcol;
+  return line + cp.col;
+}
+
+/// Free the virtual column index of window "wp".
+void win_vcol_index_free(win_T *wp)
+  FUNC_ATTR_NONNULL_ALL
+{
+  if (wp->w_vcol_index != NULL) {
+    kv_destroy(wp->w_vcol_index->cps);
+    XFREE_CLEAR(wp->w_vcol_index);
+  }
+}
+
 /// Get virtual column number of pos.
 ///  start: on the first position of this character (TAB, ctrl)
 /// cursor: where the cursor is on this character (first char, except for TAB)
@@ -1231,10 +1418,17 @@ void getvcol(win_T *wp, pos_T *pos, colnr_T *start, colnr_T *cursor,
   // When 'list', 'linebreak', 'showbreak' and 'breakindent' are not set
   // use a simple loop.
   // Also use this when 'list' is set but tabs take their normal size.
-  if ((!wp->w_p_list || (wp->w_p_lcs_chars.tab1 != NUL))
-      && !wp->w_p_lbr
-      && (*p_sbr == NUL)
-      && !wp->w_p_bri ) {
+  if (vcol_index_usable(wp)) {
+    // In a long line start at the checkpoint before the character.
+    if (posptr == NULL ? STRLEN(line) >= VCOL_INDEX_STEP
+        : posptr - line >= VCOL_INDEX_STEP) {
+      const colnr_T col = posptr == NULL ? MAXCOL : (colnr_T)(posptr - line);
+      vcol_index_T *vi = vcol_index_get(wp, pos->lnum, line);
+      vcol_index_extend(wp, vi, line, col, MAXCOL);
+      const VcolCheckpoint cp = vcol_index_find(vi, col, MAXCOL);
+      ptr = line + cp.col;
+      vcol = cp.vcol;
+    }
     for (;;) {
       head = 0;
       c = *ptr;
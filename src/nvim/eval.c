@@ -65,6 +65,7 @@
 #include "nvim/profile.h"
 #include "nvim/quickfix.h"
 #include "nvim/regexp.h"
+#include "nvim/schar.h"
 #include "nvim/screen.h"
 #include "nvim/search.h"
 #include "nvim/sha256.h"
@@ -9674,13 +9675,14 @@ static void get_buffer_lines(buf_T *buf, linenr_T start, linenr_T end, int retli
 ///
 /// @return Line number or 0 in case of error.
 static linenr_T tv_get_lnum_buf(const typval_T *const tv,
-                                const buf_T *const buf)
+                                buf_T *const buf)
   FUNC_ATTR_NONNULL_ARG(1) FUNC_ATTR_WARN_UNUSED_RESULT
 {
   if (tv->v_type == VAR_STRING
       && tv->vval.v_string != NULL
       && tv->vval.v_string[0] == '$'
       && buf != NULL) {
+    ml_pt_finish(buf);
     return buf->b_ml.ml_line_count;
   }
   return tv_get_number_chk(tv, NULL);
@@ -14534,8 +14536,10 @@ static void f_screenchar(typval_T *argvars, typval_T *rettv, FunPtr fptr)
       || col < 0 || col >= default_grid.Columns) {
     c = -1;
   } else {
+    char text[MAX_SCHAR_SIZE];
     off = default_grid.line_offset[row] + col;
-    c = utf_ptr2char(default_grid.chars[off]);
+    schar_get(text, default_grid.chars[off]);
+    c = utf_ptr2char((char_u *)text);
   }
   rettv->vval.v_number = c;
 }
@@ -19023,6 +19027,7 @@ pos_T *var2fpos(const typval_T *const tv, const int dollar_lnum,
     }
   } else if (name[0] == '$') {        /* last column or line */
     if (dollar_lnum) {
+      ml_pt_finish(curbuf);
       pos.lnum = curbuf->b_ml.ml_line_count;
       pos.col = 0;
     } else {
@@ -0,0 +1,72 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check
+// it. PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+#include <uv.h>
+
+#include "nvim/event/loop.h"
+#include "nvim/event/fs_event.h"
+
+#ifdef INCLUDE_GENERATED_DECLARATIONS
+# include "event/fs_event.c.generated.h"
+#endif
+
+
+void fs_event_watcher_init(Loop *loop, FsEventWatcher *watcher, void *data)
+  FUNC_ATTR_NONNULL_ARG(1) FUNC_ATTR_NONNULL_ARG(2)
+{
+  uv_fs_event_init(&loop->uv, &watcher->uv);
+  watcher->uv.data = watcher;
+  watcher->data = data;
+  watcher->cb = NULL;
+  watcher->close_cb = NULL;
+  watcher->events = loop->fast_events;
+}
+
+/// Start watching "path" for changes.
+///
+/// @return  0 on success, a libuv error code otherwise.
+int fs_event_watcher_start(FsEventWatcher *watcher, fs_event_cb cb,
+                           const char *path)
+  FUNC_ATTR_NONNULL_ALL
+{
+  watcher->cb = cb;
+  return uv_fs_event_start(&watcher->uv, fs_event_watcher_cb, path, 0);
+}
+
+void fs_event_watcher_stop(FsEventWatcher *watcher)
+  FUNC_ATTR_NONNULL_ALL
+{
+  uv_fs_event_stop(&watcher->uv);
+}
+
+void fs_event_watcher_close(FsEventWatcher *watcher, fs_event_close_cb cb)
+  FUNC_ATTR_NONNULL_ARG(1)
+{
+  watcher->close_cb = cb;
+  uv_close((uv_handle_t *)&watcher->uv, close_cb);
+}
+
+static void fs_event_event(void **argv)
+{
+  FsEventWatcher *watcher = argv[0];
+  watcher->cb(watcher, (int)(intptr_t)argv[1], watcher->data);
+}
+
+static void fs_event_watcher_cb(uv_fs_event_t *handle, const char *filename,
+                                int events, int status)
+{
+  FsEventWatcher *watcher = handle->data;
+  if (status < 0) {
+    return;
+  }
+  CREATE_EVENT(watcher->events, fs_event_event, 2, watcher,
+               (void *)(intptr_t)events);
+}
+
+static void close_cb(uv_handle_t *handle)
+{
+  FsEventWatcher *watcher = handle->data;
+  if (watcher->close_cb) {
+    watcher->close_cb(watcher, watcher->data);
+  }
+}
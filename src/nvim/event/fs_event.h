@@ -0,0 +1,25 @@
+#ifndef NVIM_EVENT_FS_EVENT_H
+#define NVIM_EVENT_FS_EVENT_H
+
+#include <uv.h>
+
+#include "nvim/event/loop.h"
+
+typedef struct fs_event_watcher FsEventWatcher;
+/// "events" has UV_RENAME when the file was renamed or deleted, UV_CHANGE
+/// when it was written.
+typedef void (*fs_event_cb)(FsEventWatcher *watcher, int events, void *data);
+typedef void (*fs_event_close_cb)(FsEventWatcher *watcher, void *data);
+
+struct fs_event_watcher {
+  uv_fs_event_t uv;
+  void *data;
+  fs_event_cb cb;
+  fs_event_close_cb close_cb;
+  MultiQueue *events;
+};
+
+#ifdef INCLUDE_GENERATED_DECLARATIONS
+# include "event/fs_event.h.generated.h"
+#endif
+#endif  // NVIM_EVENT_FS_EVENT_H
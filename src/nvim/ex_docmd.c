@@ -343,6 +343,7 @@ int do_cmdline(char_u *cmdline, LineGetter fgetline,
     return FAIL;
   }
   call_depth++;
+  state_tick++;
   start_batch_changes();
 
   cstack.cs_idx = -1;
@@ -1528,6 +1529,16 @@ static char_u * do_one_cmd(char_u **cmdlinep,
     }
   }
 
+  // A range, or a command that uses all lines or changes them, must see all
+  // lines of a file that is still being loaded.
+  if (!ea.skip && ea.addr_type == ADDR_LINES && curbuf->b_ml.ml_pt != NULL) {
+    const uint32_t argt = (ea.cmdidx == CMD_SIZE || IS_USER_CMDIDX(ea.cmdidx)
+                           ? ea.argt : cmdnames[(int)ea.cmdidx].cmd_argt);
+    if (ea.cmd > cmd || (argt & (DFLALL | MODIFY))) {
+      ml_pt_finish(curbuf);
+    }
+  }
+
   /* repeat for all ',' or ';' separated addresses */
   ea.cmd = cmd;
   for (;; ) {
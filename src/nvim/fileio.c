@@ -28,18 +28,23 @@
 #include "nvim/getchar.h"
 #include "nvim/hashtab.h"
 #include "nvim/iconv.h"
+#include "nvim/mark.h"
 #include "nvim/mbyte.h"
 #include "nvim/memfile.h"
 #include "nvim/memline.h"
+#include "nvim/memscan.h"
 #include "nvim/memory.h"
 #include "nvim/message.h"
+#include "nvim/main.h"
 #include "nvim/misc1.h"
 #include "nvim/garray.h"
+#include "nvim/lib/kvec.h"
 #include "nvim/move.h"
 #include "nvim/normal.h"
 #include "nvim/option.h"
 #include "nvim/os_unix.h"
 #include "nvim/path.h"
+#include "nvim/piecetable.h"
 #include "nvim/quickfix.h"
 #include "nvim/regexp.h"
 #include "nvim/screen.h"
@@ -57,9 +62,18 @@
 #include "nvim/os/os_defs.h"
 #include "nvim/os/time.h"
 #include "nvim/os/input.h"
+#include "nvim/event/fs_event.h"
+#include "nvim/event/multiqueue.h"
 
 #define BUFSIZE         8192    /* size of normal write buffer */
 #define SMBUFSIZE       256     /* size of emergency write buffer */
+#define STREAMBUFSIZE   (256 * 1024)  // size of write buffer for streaming
+#define STREAM_LINES    20000   // stream when writing this many lines
+#define RELOAD_BUFSIZE  (64 * 1024)  // read buffer for buf_reload_changed(),
+                                     // also the size of a hashed range
+// FNV-1a hash of the bytes in a range, for buf_hash_text()
+#define RELOAD_HASH_INIT  UINT64_C(0xcbf29ce484222325)
+#define RELOAD_HASH(h, c) (((h) ^ (uint8_t)(c)) * UINT64_C(0x100000001b3))
 
 //
 // The autocommands are stored in a list for each event.
@@ -182,6 +196,29 @@ struct bw_info {
 # endif
 };
 
+/// Streaming writer for a large buf_write(): a thread calls
+/// buf_write_bytes() for one buffer, which converts and writes it, while
+/// buf_write() fills the other buffer with lines.
+typedef struct {
+  struct bw_info *bs_info;      ///< only used by the thread while streaming
+  uv_thread_t bs_thread;
+  uv_mutex_t bs_mutex;
+  uv_cond_t bs_cond;
+  char_u *bs_spare;             ///< buffer not being filled by buf_write()
+  char_u *bs_buf;               ///< buffer to write, NULL when none
+  int bs_len;                   ///< number of bytes in bs_buf
+  bool bs_failed;               ///< buf_write_bytes() failed
+  bool bs_done;                 ///< no more buffers will follow
+} bw_stream_T;
+
+/// Reads the file for buf_reload_changed().
+typedef struct {
+  int rr_fd;
+  size_t rr_pos;                ///< next byte in rr_buf
+  size_t rr_len;                ///< number of bytes in rr_buf
+  char_u rr_buf[RELOAD_BUFSIZE];
+} reload_reader_T;
+
 #ifdef INCLUDE_GENERATED_DECLARATIONS
 # include "fileio.c.generated.h"
 #endif
@@ -286,6 +323,9 @@ readfile (
   char_u      *buffer = NULL;           /* read buffer */
   char_u      *new_buffer = NULL;       /* init to shut up gcc */
   char_u      *line_start = NULL;       /* init to shut up gcc */
+  // Lines found in the read buffer, appended with ml_append_lines().
+  kvec_t(char_u *) batch_lines = KV_INITIAL_VALUE;
+  kvec_t(colnr_T) batch_lens = KV_INITIAL_VALUE;
   int wasempty;                         /* buffer was empty before reading */
   colnr_T len;
   long size = 0;
@@ -781,6 +821,16 @@ readfile (
     fenc_alloced = true;
   }
 
+  // Use a piece table when the whole file is read into an empty buffer
+  // without conversion, see 'bufstorage'.  Only tried once.
+  bool used_pt = false;
+  bool try_pt = (newfile && wasempty && !filtering && !read_stdin
+                 && !read_buffer && !read_fifo && !recoverymode
+                 && !(flags & READ_DUMMY) && !keep_dest_enc
+                 && lines_to_skip == 0 && lines_to_read == MAXLNUM
+                 && STRCMP(curbuf->b_p_bst, "piecetable") == 0
+                 && reads_as_utf8(fenc, fenc_next));
+
   /*
    * Jump back here to retry reading the file in different ways.
    * Reasons to retry:
@@ -841,6 +891,31 @@ retry:
       fileformat = EOL_UNKNOWN;                 /* detect from file */
   }
 
+  if (try_pt) {
+    bool no_eol;
+
+    try_pt = false;
+    if (readfile_pt(fd, &fileformat, try_unix, try_dos, try_mac, set_options,
+                    &filesize, &no_eol)) {
+      used_pt = true;
+      lnum = curbuf->b_ml.ml_line_count;
+      if (no_eol) {
+        if (set_options) {
+          curbuf->b_p_eol = false;
+        }
+        read_no_eol_lnum = lnum;
+      }
+      // The text is used as-is, as if it was in 'encoding'.
+      if (fenc_alloced) {
+        xfree(fenc);
+      }
+      fenc = (char_u *)"utf-8";
+      fenc_alloced = false;
+      linerest = 0;
+      goto failed;
+    }
+  }
+
 # ifdef USE_ICONV
   if (iconv_fd != (iconv_t)-1) {
     /* aborted conversion with iconv(), close the descriptor */
@@ -1537,57 +1612,7 @@ rewind_retry:
        * when reading the first part of a file: guess EOL type
        */
       if (fileformat == EOL_UNKNOWN) {
-        /* First try finding a NL, for Dos and Unix */
-        if (try_dos || try_unix) {
-          // Reset the carriage return counter.
-          if (try_mac) {
-            try_mac = 1;
-          }
-
-          for (p = ptr; p < ptr + size; ++p) {
-            if (*p == NL) {
-              if (!try_unix
-                  || (try_dos && p > ptr && p[-1] == CAR))
-                fileformat = EOL_DOS;
-              else
-                fileformat = EOL_UNIX;
-              break;
-            } else if (*p == CAR && try_mac) {
-              try_mac++;
-            }
-          }
-
-          /* Don't give in to EOL_UNIX if EOL_MAC is more likely */
-          if (fileformat == EOL_UNIX && try_mac) {
-            /* Need to reset the counters when retrying fenc. */
-            try_mac = 1;
-            try_unix = 1;
-            for (; p >= ptr && *p != CAR; p--)
-              ;
-            if (p >= ptr) {
-              for (p = ptr; p < ptr + size; ++p) {
-                if (*p == NL)
-                  try_unix++;
-                else if (*p == CAR)
-                  try_mac++;
-              }
-              if (try_mac > try_unix)
-                fileformat = EOL_MAC;
-            }
-          } else if (fileformat == EOL_UNKNOWN && try_mac == 1) {
-            // Looking for CR but found no end-of-line markers at all:
-            // use the default format.
-            fileformat = default_fileformat();
-          }
-        }
-
-        /* No NL found: may use Mac format */
-        if (fileformat == EOL_UNKNOWN && try_mac)
-          fileformat = EOL_MAC;
-
-        /* Still nothing found?  Use first format in 'ffs' */
-        if (fileformat == EOL_UNKNOWN)
-          fileformat = default_fileformat();
+        fileformat = detect_fileformat(ptr, size, try_unix, try_dos, try_mac);
 
         // May set 'p_ff' if editing a new file.
         if (set_options) {
@@ -1596,17 +1621,12 @@ rewind_retry:
       }
     }
 
-    /*
-     * This loop is executed once for every character read.
-     * Keep it fast!
-     */
+    // This loop is executed once for every line read, memscan_eol() skips
+    // over the text quickly.  Keep it fast!
+    char_u *const ptr_end = ptr + size;
     if (fileformat == EOL_MAC) {
-      --ptr;
-      while (++ptr, --size >= 0) {
-        /* catch most common case first */
-        if ((c = *ptr) != NUL && c != CAR && c != NL)
-          continue;
-        if (c == NUL)
+      for (; (ptr = memscan_eol(ptr, ptr_end, true)) < ptr_end; ptr++) {
+        if ((c = *ptr) == NUL)
           *ptr = NL;            /* NULs are replaced by newlines! */
         else if (c == NL)
           *ptr = CAR;           /* NLs are replaced by CRs! */
@@ -1614,10 +1634,8 @@ rewind_retry:
           if (skip_count == 0) {
             *ptr = NUL;                     /* end of line */
             len = (colnr_T) (ptr - line_start + 1);
-            if (ml_append(lnum, line_start, len, newfile) == FAIL) {
-              error = TRUE;
-              break;
-            }
+            kv_push(batch_lines, line_start);
+            kv_push(batch_lens, len);
             if (read_undo_file)
               sha256_update(&sha_ctx, line_start, len);
             ++lnum;
@@ -1632,11 +1650,8 @@ rewind_retry:
         }
       }
     } else {
-      --ptr;
-      while (++ptr, --size >= 0) {
-        if ((c = *ptr) != NUL && c != NL)          /* catch most common case */
-          continue;
-        if (c == NUL)
+      for (; (ptr = memscan_eol(ptr, ptr_end, false)) < ptr_end; ptr++) {
+        if ((c = *ptr) == NUL)
           *ptr = NL;            /* NULs are replaced by newlines! */
         else {
           if (skip_count == 0) {
@@ -1656,6 +1671,10 @@ rewind_retry:
                     && !read_stdin
                     && (read_buffer
                         || vim_lseek(fd, (off_T)0L, SEEK_SET) == 0)) {
+                  // Lines not appended yet don't need to be deleted.
+                  lnum -= (linenr_T)kv_size(batch_lines);
+                  kv_size(batch_lines) = 0;
+                  kv_size(batch_lens) = 0;
                   fileformat = EOL_UNIX;
                   if (set_options)
                     set_fileformat(EOL_UNIX, OPT_LOCAL);
@@ -1666,10 +1685,8 @@ rewind_retry:
                 ff_error = EOL_DOS;
               }
             }
-            if (ml_append(lnum, line_start, len, newfile) == FAIL) {
-              error = TRUE;
-              break;
-            }
+            kv_push(batch_lines, line_start);
+            kv_push(batch_lens, len);
             if (read_undo_file)
               sha256_update(&sha_ctx, line_start, len);
             ++lnum;
@@ -1684,6 +1701,16 @@ rewind_retry:
         }
       }
     }
+    // Append the lines of this part of the file at once.
+    if (kv_size(batch_lines) > 0) {
+      if (ml_append_lines(lnum - (linenr_T)kv_size(batch_lines),
+                          batch_lines.items, batch_lens.items,
+                          (linenr_T)kv_size(batch_lines), newfile) == FAIL) {
+        error = TRUE;
+      }
+      kv_size(batch_lines) = 0;
+      kv_size(batch_lens) = 0;
+    }
     linerest = (long)(ptr - line_start);
     os_breakcheck();
   }
@@ -1744,6 +1771,8 @@ failed:
     (void)os_set_cloexec(fd);
   }
   xfree(buffer);
+  kv_destroy(batch_lines);
+  kv_destroy(batch_lens);
 
   if (read_stdin) {
     close(0);
@@ -1771,7 +1800,10 @@ failed:
   if (!recoverymode) {
     /* need to delete the last line, which comes from the empty buffer */
     if (newfile && wasempty && !(curbuf->b_ml.ml_flags & ML_EMPTY)) {
-      ml_delete(curbuf->b_ml.ml_line_count, false);
+      // A piece table replaced all lines, including the empty one.
+      if (!used_pt) {
+        ml_delete(curbuf->b_ml.ml_line_count, false);
+      }
       linecnt--;
     }
     linecnt = curbuf->b_ml.ml_line_count - linecnt;
@@ -2016,6 +2048,227 @@ bool is_dev_fd_file(char_u *fname)
 }
 #endif
 
+/// Guess the end-of-line format from the first part of a file.
+///
+/// @param ptr  Text read from the file.
+/// @param size  Number of bytes in "ptr".
+/// @param try_unix  'fileformats' includes "unix".
+/// @param try_dos  'fileformats' includes "dos".
+/// @param try_mac  'fileformats' includes "mac".
+///
+/// @return  EOL_UNIX, EOL_DOS or EOL_MAC.
+static int detect_fileformat(const char_u *ptr, long size, int try_unix,
+                             int try_dos, int try_mac)
+{
+  int fileformat = EOL_UNKNOWN;
+  const char_u *const end = ptr + size;
+
+  // First try finding a NL, for Dos and Unix
+  if (try_dos || try_unix) {
+    const char_u *p = memchr(ptr, NL, (size_t)size);
+
+    // Reset the carriage return counter.
+    if (try_mac) {
+      try_mac = 1 + (int)memscan_count(ptr, p == NULL ? end : p, CAR);
+    }
+    if (p != NULL) {
+      if (!try_unix
+          || (try_dos && p > ptr && p[-1] == CAR)) {
+        fileformat = EOL_DOS;
+      } else {
+        fileformat = EOL_UNIX;
+      }
+    }
+
+    // Don't give in to EOL_UNIX if EOL_MAC is more likely
+    if (fileformat == EOL_UNIX && try_mac > 1) {
+      if (memscan_count(ptr, end, CAR) > memscan_count(ptr, end, NL)) {
+        fileformat = EOL_MAC;
+      }
+    } else if (fileformat == EOL_UNKNOWN && try_mac == 1) {
+      // Looking for CR but found no end-of-line markers at all:
+      // use the default format.
+      fileformat = default_fileformat();
+    }
+  }
+
+  // No NL found: may use Mac format
+  if (fileformat == EOL_UNKNOWN && try_mac) {
+    fileformat = EOL_MAC;
+  }
+
+  // Still nothing found?  Use first format in 'ffs'
+  if (fileformat == EOL_UNKNOWN) {
+    fileformat = default_fileformat();
+  }
+  return fileformat;
+}
+
+/// Check whether a file would be read as utf-8 or without conversion, when
+/// "fenc" is the first encoding tried and "fenc_next" the rest of
+/// 'fileencodings'.  A "ucs-bom" entry is fine when utf-8 follows it:
+/// readfile_pt() handles a utf-8 BOM and gives up on others.
+static bool reads_as_utf8(const char_u *fenc, const char_u *fenc_next)
+{
+  if (STRCMP(fenc, "ucs-bom") == 0 && fenc_next != NULL) {
+    char_u *p = (char_u *)fenc_next;
+    char_u *next = next_fenc(&p);
+    const bool utf8 = STRCMP(next, "utf-8") == 0;
+    if (*next != NUL) {
+      xfree(next);
+    }
+    return utf8;
+  }
+  return *fenc == NUL || STRCMP(fenc, "utf-8") == 0;
+}
+
+/// Check that "p" up to "end" is valid utf-8, like readfile() checks it.
+static bool valid_utf8(const char_u *p, const char_u *const end)
+  FUNC_ATTR_NONNULL_ALL FUNC_ATTR_PURE
+{
+  while (p < end) {
+    // Skip ASCII eight bytes at a time.
+    uint64_t word;
+    while (end - p >= 8
+           && (memcpy(&word, p, 8), (word & 0x8080808080808080ULL) == 0)) {
+      p += 8;
+    }
+    if (p == end) {
+      break;
+    }
+    if (*p < 0x80) {
+      p++;
+      continue;
+    }
+    const int todo = (int)MIN(end - p, 8);
+    const int l = utf_ptr2len_len(p, todo);
+    if (l == 1 || l > todo) {
+      return false;
+    }
+    p += l;
+  }
+  return true;
+}
+
+/// Check for a NL without a CR before it in "p" up to "end".  Checks the
+/// whole text, a file with mixed line breaks must not be written back in
+/// "dos" format.
+static bool missing_cr(const char_u *const p, const char_u *const end)
+  FUNC_ATTR_NONNULL_ALL FUNC_ATTR_PURE
+{
+  const char_u *nl = p;
+  while ((nl = memchr(nl, NL, (size_t)(end - nl))) != NULL) {
+    if (nl == p || nl[-1] != CAR) {
+      return true;
+    }
+    nl++;
+  }
+  return false;
+}
+
+/// Read file "fd" into the current buffer by mapping it and using a piece
+/// table for the lines, see 'bufstorage'.
+///
+/// Files that need conversion, are empty or in "mac" format are not handled,
+/// then nothing is changed.
+///
+/// @param[in,out] fileformatp  End-of-line format, EOL_UNKNOWN to detect it.
+/// @param set_options  Set 'fileformat' and 'bomb'.
+/// @param[out] filesizep  Number of bytes in the file.
+/// @param[out] no_eolp  The whole file was indexed and the last line has no
+///                      line break.
+///
+/// @return  true when the file was read.
+static bool readfile_pt(int fd, int *fileformatp, int try_unix, int try_dos,
+                        int try_mac, bool set_options, off_T *filesizep,
+                        bool *no_eolp)
+{
+  FileInfo file_info;
+  if (!os_fileinfo_fd(fd, &file_info)
+      || !S_ISREG(file_info.stat.st_mode)) {
+    return false;
+  }
+  const uint64_t file_size = os_fileinfo_size(&file_info);
+  if (file_size == 0 || file_size > SIZE_MAX) {
+    return false;
+  }
+  const size_t size = (size_t)file_size;
+  const char_u *text = (char_u *)os_map_file(fd, size);
+  if (text == NULL) {
+    return false;
+  }
+
+  size_t skip = 0;
+  bool bomb = false;
+  if (!curbuf->b_p_bin && size >= 2) {
+    int blen;
+    char_u *ccname = check_for_bom((char_u *)text, (long)size, &blen,
+                                   FIO_ALL);
+    if (ccname != NULL) {
+      if (STRCMP(ccname, "utf-8") != 0) {
+        goto fail;  // UTF-16 or UCS-4 needs conversion
+      }
+      skip = (size_t)blen;
+      bomb = true;
+    }
+  }
+  if (skip >= size) {
+    goto fail;
+  }
+
+  int fileformat = *fileformatp;
+  if (fileformat == EOL_UNKNOWN) {
+    fileformat = detect_fileformat(text + skip,
+                                   (long)MIN(size - skip, 0x10000),
+                                   try_unix, try_dos, try_mac);
+  }
+  // In "mac" format a NL is part of the text.  A trailing CTRL-Z is dropped
+  // in "dos" format.
+  if (fileformat == EOL_MAC
+      || (fileformat == EOL_DOS && !curbuf->b_p_bin
+          && text[size - 1] == Ctrl_Z
+          && (size - 1 == skip || text[size - 2] == NL))) {
+    goto fail;
+  }
+
+  // Only text that would be read as utf-8 without any change can be used
+  // as-is.  Otherwise the normal reading tries the next encoding or gives
+  // the "[ILLEGAL BYTE]" message.
+  if (!curbuf->b_p_bin && !valid_utf8(text + skip, text + size)) {
+    goto fail;
+  }
+
+  if (fileformat == EOL_DOS && missing_cr(text + skip, text + size)) {
+    // Not all lines end in CR-NL: use "unix" when possible, otherwise let
+    // the normal reading give the "[CR missing]" message.
+    if (!try_unix || *fileformatp != EOL_UNKNOWN) {
+      goto fail;
+    }
+    fileformat = EOL_UNIX;
+  }
+
+  // Only the start of the file is indexed now, the rest is done in the
+  // background.
+  piecetable_T *pt = pt_new((char *)text, size, skip,
+                            fileformat == EOL_DOS, &file_info);
+  pt_index_more(pt, PT_INDEX_STEP);
+  ml_open_pt(curbuf, pt);
+
+  if (set_options) {
+    set_fileformat(fileformat, OPT_LOCAL);
+    curbuf->b_p_bomb = bomb;
+    curbuf->b_start_bomb = bomb;
+  }
+  *fileformatp = fileformat;
+  *filesizep = (off_T)(size - skip);
+  // When not indexed yet, a missing line break is found in the background.
+  *no_eolp = pt_index_done(pt) && pt_no_eol(pt);
+  return true;
+
+fail:
+  os_unmap_file((char *)text, size);
+  return false;
+}
 
 /*
  * From the current line count and characters read after that, estimate the
@@ -2247,6 +2500,7 @@ buf_write (
   char_u smallbuf[SMBUFSIZE];
   char_u          *backup_ext;
   int bufsize;
+  bw_stream_T *stream = NULL;               // writer thread or NULL
   long perm;                                // file permissions
   int retval = OK;
   int newfile = false;                      // TRUE if file doesn't exist yet
@@ -2291,6 +2545,12 @@ buf_write (
     EMSG(_(e_emptybuf));
     return FAIL;
   }
+  if (whole && buf->b_ml.ml_pt != NULL) {
+    // Also write the lines of a file that is still being loaded.
+    ml_pt_finish(buf);
+    end = buf->b_ml.ml_line_count;
+    old_line_count = end;
+  }
 
   /*
    * Disallow writing from .exrc and .vimrc in current directory for
@@ -2538,14 +2798,15 @@ buf_write (
         (char_u *)"", 0);               /* show that we are busy */
   msg_scroll = FALSE;               /* always overwrite the file message now */
 
-  buffer = verbose_try_malloc(BUFSIZE);
+  // Many lines are written with a writer thread, using bigger buffers.
+  bufsize = end - start + 1 >= STREAM_LINES ? STREAMBUFSIZE : BUFSIZE;
+  buffer = verbose_try_malloc((size_t)bufsize);
   // can't allocate big buffer, use small one (to be able to write when out of
   // memory)
   if (buffer == NULL) {
     buffer = smallbuf;
     bufsize = SMBUFSIZE;
-  } else
-    bufsize = BUFSIZE;
+  }
 
   /*
    * Get information about original file (if there is one).
@@ -3099,6 +3360,10 @@ nobackup:
       // quotum for number of files).
       // Appending will fail if the file does not exist and forceit is
       // FALSE.
+      if (!append) {
+        // Buffers that have the file mapped must not see it change.
+        ml_pt_unshare((char *)wfname);
+      }
       while ((fd = os_open((char *)wfname,
                            O_WRONLY |
                            (append ?
@@ -3221,6 +3486,9 @@ restore_backup:
 #ifdef HAS_BW_FLAGS
     write_info.bw_flags = wb_flags;
 #endif
+    if (bufsize == STREAMBUFSIZE) {
+      stream = bw_stream_start(&write_info, bufsize);
+    }
     fileformat = get_fileformat_force(buf, eap);
     s = buffer;
     len = 0;
@@ -3243,14 +3511,16 @@ restore_backup:
         if (++len != bufsize) {
           continue;
         }
-        if (buf_write_bytes(&write_info) == FAIL) {
+        if (buf_write_chunk(&write_info, stream, &buffer, bufsize) == FAIL) {
           end = 0;                        // write error: break loop
           break;
         }
         nchars += bufsize;
         s = buffer;
         len = 0;
-        write_info.bw_start_lnum = lnum;
+        if (stream == NULL) {
+          write_info.bw_start_lnum = lnum;
+        }
       }
       // write failed or last line has no EOL: stop here
       if (end == 0
@@ -3268,7 +3538,8 @@ restore_backup:
         *s++ = CAR;                       // EOL_MAC or EOL_DOS: write CR
         if (fileformat == EOL_DOS) {      // write CR-NL
           if (++len == bufsize) {
-            if (buf_write_bytes(&write_info) == FAIL) {
+            if (buf_write_chunk(&write_info, stream, &buffer, bufsize)
+                == FAIL) {
               end = 0;                    // write error: break loop
               break;
             }
@@ -3280,7 +3551,7 @@ restore_backup:
         }
       }
       if (++len == bufsize) {
-        if (buf_write_bytes(&write_info) == FAIL) {
+        if (buf_write_chunk(&write_info, stream, &buffer, bufsize) == FAIL) {
           end = 0;  // Write error: break loop.
           break;
         }
@@ -3296,12 +3567,17 @@ restore_backup:
       }
     }
     if (len > 0 && end > 0) {
-      write_info.bw_len = len;
-      if (buf_write_bytes(&write_info) == FAIL) {
+      if (buf_write_chunk(&write_info, stream, &buffer, len) == FAIL) {
         end = 0;                      // write error
       }
       nchars += len;
     }
+    if (stream != NULL) {
+      if (bw_stream_finish(stream) == FAIL) {
+        end = 0;                      // write error
+      }
+      stream = NULL;
+    }
 
     // Stop when writing done or an error was encountered.
     if (!checking_conversion || end == 0) {
@@ -3504,6 +3780,9 @@ restore_backup:
     }
     u_unchanged(buf);
     u_update_save_nr(buf);
+    if (overwriting) {
+      buf_hash_text(buf, 0);
+    }
   }
 
   /*
@@ -3855,6 +4134,106 @@ static bool time_differs(long t1, long t2) FUNC_ATTR_CONST
 #endif
 }
 
+/// Write "len" bytes from "*bufp" with buf_write_bytes().  With "st" the
+/// bytes are handed to the writer thread and "*bufp" is set to a buffer that
+/// can be filled meanwhile.
+///
+/// @return  FAIL when a write failed, possibly an earlier one.
+static int buf_write_chunk(struct bw_info *ip, bw_stream_T *st, char_u **bufp,
+                           int len)
+{
+  if (st == NULL) {
+    ip->bw_buf = *bufp;
+    ip->bw_len = len;
+    return buf_write_bytes(ip);
+  }
+  uv_mutex_lock(&st->bs_mutex);
+  while (st->bs_buf != NULL) {          // wait for the previous buffer
+    uv_cond_wait(&st->bs_cond, &st->bs_mutex);
+  }
+  bool failed = st->bs_failed;
+  if (!failed) {
+    st->bs_buf = *bufp;
+    st->bs_len = len;
+    *bufp = st->bs_spare;
+    st->bs_spare = st->bs_buf;
+    uv_cond_broadcast(&st->bs_cond);
+  }
+  uv_mutex_unlock(&st->bs_mutex);
+  return failed ? FAIL : OK;
+}
+
+/// Start a writer thread for buf_write(), using "ip" for the conversion
+/// state.  "bufsize" is the size of the buffer buf_write() fills.
+///
+/// @return  NULL when the thread or the spare buffer can't be created, then
+///          buf_write() writes by itself.
+static bw_stream_T *bw_stream_start(struct bw_info *ip, int bufsize)
+{
+  char_u *spare = verbose_try_malloc((size_t)bufsize);
+  if (spare == NULL) {
+    return NULL;
+  }
+  bw_stream_T *st = xcalloc(1, sizeof(bw_stream_T));
+  st->bs_info = ip;
+  st->bs_spare = spare;
+  uv_mutex_init(&st->bs_mutex);
+  uv_cond_init(&st->bs_cond);
+  if (uv_thread_create(&st->bs_thread, bw_stream_thread, st) != 0) {
+    bw_stream_free(st);
+    return NULL;
+  }
+  return st;
+}
+
+static void bw_stream_thread(void *arg)
+{
+  bw_stream_T *st = arg;
+  uv_mutex_lock(&st->bs_mutex);
+  for (;;) {
+    while (st->bs_buf == NULL && !st->bs_done) {
+      uv_cond_wait(&st->bs_cond, &st->bs_mutex);
+    }
+    if (st->bs_buf == NULL) {
+      break;
+    }
+    st->bs_info->bw_buf = st->bs_buf;
+    st->bs_info->bw_len = st->bs_len;
+    uv_mutex_unlock(&st->bs_mutex);
+    int status = buf_write_bytes(st->bs_info);
+    uv_mutex_lock(&st->bs_mutex);
+    if (status == FAIL) {
+      st->bs_failed = true;
+    }
+    st->bs_buf = NULL;
+    uv_cond_broadcast(&st->bs_cond);
+  }
+  uv_mutex_unlock(&st->bs_mutex);
+}
+
+/// Wait for the writer thread to write the last buffer and free "st".
+///
+/// @return  FAIL when a write failed.
+static int bw_stream_finish(bw_stream_T *st)
+{
+  uv_mutex_lock(&st->bs_mutex);
+  st->bs_done = true;
+  uv_cond_broadcast(&st->bs_cond);
+  uv_mutex_unlock(&st->bs_mutex);
+  uv_thread_join(&st->bs_thread);
+  int status = st->bs_failed ? FAIL : OK;
+  bw_stream_free(st);
+  return status;
+}
+
+static void bw_stream_free(bw_stream_T *st)
+{
+  uv_cond_destroy(&st->bs_cond);
+  uv_mutex_destroy(&st->bs_mutex);
+  xfree(st->bs_spare);
+  xfree(st);
+}
+
 /*
  * Call write() to write a number of bytes to the file.
  * Handles 'encoding' conversion.
@@ -4877,6 +5256,19 @@ buf_check_timestamp (
       buf_store_file_info(buf, &file_info);
     }
 
+    // The mapped file was changed under the buffer: the text is not what was
+    // read, so it can't be used without reloading.
+    if (ml_pt_file_changed(buf, file_info_ok ? os_fileinfo_size(&file_info)
+                                             : UINT64_MAX)
+        && !((buf->b_p_ar >= 0 ? buf->b_p_ar : p_ar)
+             && !bufIsChanged(buf) && file_info_ok)) {
+      buf->b_changed = true;
+      ml_setflags(buf);
+      check_status(buf);
+      redraw_tabline = true;
+      need_maketitle = true;
+    }
+
     /* Don't do anything for a directory.  Might contain the file
      * explorer. */
     if (os_isdir(buf->b_fname))
@@ -5069,6 +5461,13 @@ void buf_reload(buf_T *buf, int orig_mode)
   old_cursor = curwin->w_cursor;
   old_topline = curwin->w_topline;
 
+  // Only read the lines that changed when possible.
+  keep_filetype = true;                       // don't detect 'filetype'
+  if (buf == curbuf && buf_reload_changed(buf, &ea) == OK) {
+    savebuf = NULL;
+    goto reloaded;
+  }
+
   if (p_ur < 0 || curbuf->b_ml.ml_line_count <= p_ur) {
     /* Save all the text, so that the reload can be undone.
      * Sync first so that this is a separate undo-able action. */
@@ -5132,8 +5531,10 @@ void buf_reload(buf_T *buf, int orig_mode)
         /* Mark all undo states as changed. */
         u_unchanged(curbuf);
       }
+      buf_hash_text(buf, 0);
     }
   }
+reloaded:
   xfree(ea.cmd);
 
   if (savebuf != NULL && bufref_valid(&bufref)) {
@@ -5176,6 +5577,514 @@ void buf_reload(buf_T *buf, int orig_mode)
   /* Careful: autocommands may have made "buf" invalid! */
 }
 
+/// Reload the current buffer "buf" by only reading what changed in the file.
+/// The unchanged buffer text is compared with the file, the lines from the
+/// first one that differs are replaced with the lines in the file.  This is
+/// an undoable change, unless 'undoreload' is exceeded.  Marks in the kept
+/// lines stay.
+///
+/// @return  FAIL when the file must be read completely.
+static int buf_reload_changed(buf_T *buf, exarg_T *eap)
+  FUNC_ATTR_NONNULL_ALL
+{
+  if (bufIsChanged(buf) || BUFEMPTY() || !reload_text_as_file(buf)) {
+    return FAIL;
+  }
+  const bool ffdos = get_fileformat(buf) == EOL_DOS;
+  const linenr_T line_count = buf->b_ml.ml_line_count;
+  // Lines that have their line break in the file.
+  const linenr_T last_full = buf->b_p_eol ? line_count : line_count - 1;
+  const long old_size = ml_find_line_or_offset(buf, line_count + 1, NULL,
+                                               false);
+  FileInfo file_info;
+  if (last_full < 1 || old_size < 0
+      || !os_fileinfo((char *)buf->b_ffname, &file_info)) {
+    return FAIL;
+  }
+  reload_reader_T *rr = xmalloc(sizeof(reload_reader_T));
+  rr->rr_fd = os_open((char *)buf->b_ffname, O_RDONLY, 0);
+  if (rr->rr_fd < 0) {
+    xfree(rr);
+    return FAIL;
+  }
+
+  // Number of unchanged lines.  All the text is checked: a file that grew
+  // may also have been changed before the old end.
+  linenr_T keep = reload_keep(buf, rr, old_size, last_full, ffdos);
+  close(rr->rr_fd);
+  if (keep == 0) {
+    xfree(rr);
+    return FAIL;
+  }
+
+  // Like readfile(): the autocommands may change the file before it is
+  // read, but not the buffer.
+  const varnumber_T changedtick = buf_get_changedtick(buf);
+  apply_autocmds_exarg(EVENT_BUFREADPRE, NULL, buf->b_fname, false, buf, eap);
+  int retval = OK;
+  if (aborting()) {
+    // nothing read
+  } else if (curbuf != buf || buf_get_changedtick(buf) != changedtick) {
+    EMSG(_("E201: *ReadPre autocommands must not change current buffer"));
+  } else if ((rr->rr_fd = os_open((char *)buf->b_ffname, O_RDONLY, 0)) < 0) {
+    EMSG(_("E200: *ReadPre autocommands made the file unreadable"));
+  } else {
+    FileInfo pre_info;
+    if (os_fileinfo((char *)buf->b_ffname, &pre_info)
+        && (os_fileinfo_size(&pre_info) != os_fileinfo_size(&file_info)
+            || pre_info.stat.st_mtim.tv_sec != file_info.stat.st_mtim.tv_sec)) {
+      // Changed by the autocommands, compare again.
+      file_info = pre_info;
+      keep = reload_keep(buf, rr, old_size, last_full, ffdos);
+    }
+    retval = keep > 0
+      ? buf_read_tail(buf, rr, keep, ffdos, &file_info, false)
+      : FAIL;
+    close(rr->rr_fd);
+    if (retval == OK) {
+      apply_autocmds_exarg(EVENT_BUFREADPOST, NULL, buf->b_fname, false, buf,
+                           eap);
+    }
+  }
+  xfree(rr);
+  return retval;
+}
+
+/// Replace the lines after line "keep" of the current buffer "buf" with the
+/// lines in the file from where line "keep + 1" starts.  "file_info" is stored
+/// as the state of the file the buffer now matches.
+///
+/// @param follow  Appending for 'followfile': the change is joined with the
+///                lines appended before in one undo entry.
+static int buf_read_tail(buf_T *buf, reload_reader_T *rr, linenr_T keep,
+                         bool ffdos, FileInfo *file_info, bool follow)
+{
+  const linenr_T line_count = buf->b_ml.ml_line_count;
+  const long offset = ml_find_line_or_offset(buf, keep + 1, NULL, false);
+  // The hashes of the ranges before the one with "offset" stay valid.
+  const size_t hashed = offset >= 0 && buf_hash_valid(buf)
+                        ? (size_t)offset / RELOAD_BUFSIZE : 0;
+  garray_T text;
+  ga_init(&text, 1, 4096);
+  kvec_t(size_t) starts = KV_INITIAL_VALUE;
+  bool eol = true;
+  int retval = FAIL;
+  if (reload_seek(rr, offset)) {
+    kv_push(starts, 0);
+    int c;
+    while ((c = reload_getc(rr)) != EOF) {
+      if (c != NL) {
+        ga_append(&text, c == NUL ? NL : (char)c);
+        continue;
+      }
+      if (ffdos) {
+        if (text.ga_len == (int)kv_last(starts)
+            || ((char_u *)text.ga_data)[text.ga_len - 1] != CAR) {
+          break;                        // not a dos line break
+        }
+        text.ga_len--;
+      }
+      ga_append(&text, NUL);
+      kv_push(starts, (size_t)text.ga_len);
+    }
+    if (c == EOF) {
+      if (text.ga_len > (int)kv_last(starts)) {
+        ga_append(&text, NUL);          // last line without a line break
+        eol = false;
+      } else {
+        (void)kv_pop(starts);
+      }
+      retval = OK;
+    }
+  }
+
+  if (retval == OK) {
+    linenr_T deleted = line_count - keep;
+    linenr_T added = (linenr_T)kv_size(starts);
+    char_u **lines = xmalloc(sizeof(char_u *) * (kv_size(starts) + 1));
+    for (size_t i = 0; i < kv_size(starts); i++) {
+      lines[i] = (char_u *)text.ga_data + kv_A(starts, i);
+    }
+    // Save the replaced lines for undo like buf_reload() saves the text,
+    // also when the buffer is not modifiable.
+    const bool save_undo = follow || p_ur < 0 || line_count <= p_ur;
+    if (follow && buf->b_u_newhead != NULL && buf->b_u_curhead == NULL
+        && buf->b_u_seq_last == buf->b_follow_seq) {
+      buf->b_u_synced = false;        // like ":undojoin"
+    } else if (save_undo) {
+      u_sync(false);
+    }
+    if (save_undo && u_savecommon(keep, line_count + 1, 0, true) == FAIL) {
+      retval = FAIL;
+    } else {
+      // Not a change made by the user: no deleted_lines_mark() and
+      // appended_lines_mark(), they would warn for a readonly file and set
+      // the '. mark.
+      for (linenr_T i = 0; i < deleted; i++) {
+        ml_delete(keep + 1, false);
+      }
+      if (deleted > 0) {
+        mark_adjust(keep + 1, keep + deleted, (long)MAXLNUM, -(long)deleted,
+                    false);
+        changed_lines_reload(keep + 1, keep + 1 + deleted, -(long)deleted);
+      }
+      if (added > 0 && ml_append_lines(keep, lines, NULL, added, false) == OK) {
+        if (curwin->w_p_diff) {
+          mark_adjust(keep + 1, (linenr_T)MAXLNUM, added, 0L, false);
+        }
+        changed_lines_reload(keep + 1, keep + 1, added);
+      }
+      buf->b_p_eol = eol;
+      unchanged(buf, true);
+      if (save_undo) {
+        u_unchanged(buf);
+        u_sync(false);
+        if (follow) {
+          buf->b_follow_seq = buf->b_u_seq_last;
+        }
+      } else {
+        u_blockfree(buf);
+        u_clearall(buf);
+      }
+      buf_hash_text(buf, hashed);
+      buf_store_file_info(buf, file_info);
+      buf->b_mtime_read = buf->b_mtime;
+    }
+    xfree(lines);
+  }
+  ga_clear(&text);
+  kv_destroy(starts);
+  return retval;
+}
+
+/// Position the reader at byte "offset" of the file.
+static bool reload_seek(reload_reader_T *rr, long offset)
+{
+  rr->rr_pos = rr->rr_len = 0;
+  return offset >= 0 && vim_lseek(rr->rr_fd, (off_T)offset, SEEK_SET) == offset;
+}
+
+/// Get the next byte of the file, EOF at the end or for an error.
+static int reload_getc(reload_reader_T *rr)
+{
+  if (rr->rr_pos == rr->rr_len) {
+    ptrdiff_t n = read_eintr(rr->rr_fd, rr->rr_buf, RELOAD_BUFSIZE);
+    if (n <= 0) {
+      return EOF;
+    }
+    rr->rr_pos = 0;
+    rr->rr_len = (size_t)n;
+  }
+  return rr->rr_buf[rr->rr_pos++];
+}
+
+/// Compare lines "lnum" to "last" of the current buffer with the file at byte
+/// "offset", where line "lnum" should start.
+///
+/// @return  The first line that differs, "last + 1" if they all match.
+static linenr_T reload_compare(reload_reader_T *rr, long offset, linenr_T lnum,
+                               linenr_T last, bool ffdos)
+{
+  if (!reload_seek(rr, offset)) {
+    return lnum;
+  }
+  for (; lnum <= last; lnum++) {
+    for (char_u *p = ml_get(lnum); *p != NUL; p++) {
+      if (reload_getc(rr) != (*p == NL ? NUL : *p)) {
+        return lnum;
+      }
+    }
+    if ((ffdos && reload_getc(rr) != CAR) || reload_getc(rr) != NL) {
+      return lnum;
+    }
+  }
+  return lnum;
+}
+
+/// Get the number of lines at the start of "buf" that are the same in the
+/// file, up to "last".  The hashes of the ranges of the file are compared
+/// with the ones stored by buf_hash_text(), the text is only compared from
+/// the first range that differs.  Equal hashes are taken as equal text.
+/// Without valid hashes all the text is compared.
+///
+/// @param size  Number of bytes in the buffer text, as in the file.
+static linenr_T reload_keep(buf_T *buf, reload_reader_T *rr, long size,
+                            linenr_T last, bool ffdos)
+{
+  long offset = 0;
+  if (buf_hash_valid(buf) && reload_seek(rr, 0)) {
+    for (size_t i = 0; i < kv_size(buf->b_file_hashes); i++) {
+      size_t len = (size_t)MIN(RELOAD_BUFSIZE, size - offset);
+      if (reload_read(rr, len) != len) {
+        break;
+      }
+      uint64_t hash = RELOAD_HASH_INIT;
+      for (size_t j = 0; j < len; j++) {
+        hash = RELOAD_HASH(hash, rr->rr_buf[j]);
+      }
+      if (hash != kv_A(buf->b_file_hashes, i)) {
+        break;
+      }
+      offset += (long)len;
+    }
+  }
+  long start;
+  linenr_T lnum = reload_find_line(buf, offset, &start);
+  if (lnum == 0 || lnum > last) {
+    return lnum == 0 ? 0 : last;
+  }
+  return reload_compare(rr, start, lnum, last, ffdos) - 1;
+}
+
+/// Read "len" bytes of the file into rr_buf, at most RELOAD_BUFSIZE.
+///
+/// @return  The number of bytes read, less at the end of the file.
+static size_t reload_read(reload_reader_T *rr, size_t len)
+{
+  size_t done = 0;
+  while (done < len) {
+    ptrdiff_t n = read_eintr(rr->rr_fd, rr->rr_buf + done, len - done);
+    if (n <= 0) {
+      break;
+    }
+    done += (size_t)n;
+  }
+  rr->rr_pos = rr->rr_len = 0;    // not for reload_getc()
+  return done;
+}
+
+/// Find the line of "buf" with byte "offset" of the text as in the file.
+/// "*start" is set to the offset of that line.
+///
+/// @return  The line number, zero when the offsets are not available.
+static linenr_T reload_find_line(buf_T *buf, long offset, long *start)
+{
+  linenr_T lo = 1;
+  linenr_T hi = buf->b_ml.ml_line_count;
+  *start = 0;
+  while (lo < hi) {
+    linenr_T mid = lo + (hi - lo + 1) / 2;
+    long off = ml_find_line_or_offset(buf, mid, NULL, false);
+    if (off < 0) {
+      return 0;
+    } else if (off <= offset) {
+      lo = mid;
+      *start = off;
+    } else {
+      hi = mid - 1;
+    }
+  }
+  return lo;
+}
+
+/// Whether the text of "buf" is in its file as it is: without a conversion, a
+/// BOM or Mac line breaks.  Then parts of the file can be read again.
+static bool reload_text_as_file(buf_T *buf)
+{
+  return !buf->b_p_bomb && get_fileformat(buf) != EOL_MAC
+         && (*buf->b_p_fenc == NUL || STRCMP(buf->b_p_fenc, p_enc) == 0);
+}
+
+/// Whether the hashes stored by buf_hash_text() are for the text of "buf".
+static bool buf_hash_valid(buf_T *buf)
+{
+  return kv_size(buf->b_file_hashes) > 0
+         && buf->b_file_hash_tick == buf_get_changedtick(buf)
+         && buf->b_file_hash_size
+         == ml_find_line_or_offset(buf, buf->b_ml.ml_line_count + 1, NULL,
+                                   false);
+}
+
+/// Store a hash for each RELOAD_BUFSIZE bytes of the text of "buf" as it is
+/// in the file, for buf_reload_changed() to find what changed in the file
+/// without comparing all the text.  Used after reading or writing the file,
+/// when the buffer text is the same as the file.  The hashes of the ranges
+/// before range "first" are kept.
+void buf_hash_text(buf_T *buf, size_t first)
+  FUNC_ATTR_NONNULL_ALL
+{
+  const linenr_T line_count = buf->b_ml.ml_line_count;
+  long size = -1;
+  if (buf->b_ffname != NULL && buf->b_ml.ml_mfp != NULL
+      && !(buf->b_ml.ml_flags & ML_EMPTY) && reload_text_as_file(buf)) {
+    size = ml_find_line_or_offset(buf, line_count + 1, NULL, false);
+  }
+  long start;
+  linenr_T lnum = 0;
+  first = MIN(first, kv_size(buf->b_file_hashes));
+  if (size >= 0) {
+    lnum = reload_find_line(buf, (long)first * RELOAD_BUFSIZE, &start);
+  }
+  if (lnum == 0) {
+    kv_size(buf->b_file_hashes) = 0;
+    return;
+  }
+  kv_size(buf->b_file_hashes) = first;
+
+  const bool ffdos = get_fileformat(buf) == EOL_DOS;
+  // Like buf_write(), a line break after the last line unless 'noeol' and
+  // ('binary' or 'nofixeol').
+  const bool last_eol = buf->b_p_eol || (buf->b_p_fixeol && !buf->b_p_bin);
+  size_t skip = (size_t)((long)first * RELOAD_BUFSIZE - start);
+  uint64_t hash = RELOAD_HASH_INIT;
+  size_t len = 0;                       // number of bytes in "hash"
+  for (; lnum <= line_count; lnum++) {
+    const char_u *line = ml_get_buf(buf, lnum, false);
+    const size_t linelen = STRLEN(line);
+    size_t total = linelen;
+    if (lnum < line_count || last_eol) {
+      total += ffdos ? 2 : 1;
+    }
+    for (size_t i = skip; i < total; i++) {
+      int c = i < linelen ? (line[i] == NL ? NUL : line[i])
+                          : (ffdos && i == linelen ? CAR : NL);
+      hash = RELOAD_HASH(hash, c);
+      if (++len == RELOAD_BUFSIZE) {
+        kv_push(buf->b_file_hashes, hash);
+        hash = RELOAD_HASH_INIT;
+        len = 0;
+      }
+    }
+    skip = 0;
+  }
+  if (len > 0) {
+    kv_push(buf->b_file_hashes, hash);
+  }
+  buf->b_file_hash_size = size;
+  buf->b_file_hash_tick = buf_get_changedtick(buf);
+}
+
+/// Start or stop watching the file of "buf" for 'followfile'.  While the file
+/// does not exist its directory is watched, until the file is created.
+void buf_follow_update(buf_T *buf)
+  FUNC_ATTR_NONNULL_ALL
+{
+  bool follow = buf->b_p_fof && buf->b_ml.ml_mfp != NULL
+                && buf->b_ffname != NULL;
+  if (!follow || buf->b_follow_watcher != NULL) {
+    if (!follow) {
+      buf_follow_stop(buf);
+    }
+    return;
+  }
+  FsEventWatcher *watcher = xmalloc(sizeof(FsEventWatcher));
+  fs_event_watcher_init(&main_loop, watcher, (void *)(intptr_t)buf->handle);
+  watcher->events = multiqueue_new_child(main_loop.events);
+  buf->b_follow_watcher = watcher;
+  buf->b_follow_dir = !os_path_exists(buf->b_ffname);
+  char *path = buf->b_follow_dir
+    ? xstrndup((char *)buf->b_ffname,
+               (size_t)(path_tail(buf->b_ffname) - buf->b_ffname))
+    : xstrdup((char *)buf->b_ffname);
+  if (fs_event_watcher_start(watcher, buf_follow_cb,
+                             *path == NUL ? "." : path) != 0) {
+    buf_follow_stop(buf);
+  }
+  xfree(path);
+}
+
+/// Watch the file of "buf" again: it got another name, or the watched file
+/// was renamed or deleted (e.g., a rotated log file).
+void buf_follow_restart(buf_T *buf)
+  FUNC_ATTR_NONNULL_ALL
+{
+  if (buf->b_follow_watcher != NULL) {
+    buf_follow_stop(buf);
+    buf_follow_update(buf);
+  }
+}
+
+/// Stop watching the file of "buf".
+void buf_follow_stop(buf_T *buf)
+  FUNC_ATTR_NONNULL_ALL
+{
+  FsEventWatcher *watcher = buf->b_follow_watcher;
+  if (watcher == NULL) {
+    return;
+  }
+  buf->b_follow_watcher = NULL;
+  fs_event_watcher_stop(watcher);
+  multiqueue_free(watcher->events);   // drop pending events
+  watcher->events = NULL;
+  fs_event_watcher_close(watcher, buf_follow_close_cb);
+}
+
+static void buf_follow_close_cb(FsEventWatcher *watcher, void *data)
+{
+  xfree(watcher);
+}
+
+static void buf_follow_cb(FsEventWatcher *watcher, int events, void *data)
+{
+  buf_T *buf = handle_get_buffer((handle_T)(intptr_t)data);
+  if (buf == NULL || buf->b_follow_watcher != watcher) {
+    return;
+  }
+  bool replaced = false;
+  if ((events & UV_RENAME) || buf->b_follow_dir) {
+    // The watched file is gone, or the directory changed: a file with the
+    // name of the buffer is another file now.
+    buf_follow_restart(buf);
+    if (buf->b_follow_watcher == NULL || buf->b_follow_dir) {
+      return;
+    }
+    replaced = true;
+  }
+  buf_follow_file(buf, replaced);
+}
+
+/// The file of "buf" changed and 'followfile' is set: append the new lines
+/// without reading the file again.  The last line is read again when it had
+/// no line break.  When the file got smaller or was "replaced" by another file
+/// it is reloaded.  Nothing is done when the buffer was changed, then the file
+/// is checked as usual.
+static void buf_follow_file(buf_T *buf, bool replaced)
+{
+  FileInfo file_info;
+  if (bufIsChanged(buf) || (buf->b_ml.ml_flags & ML_EMPTY)
+      || !os_fileinfo((char *)buf->b_ffname, &file_info)) {
+    return;
+  }
+  long old_size = ml_find_line_or_offset(buf, buf->b_ml.ml_line_count + 1,
+                                         NULL, false);
+  long new_size = (long)os_fileinfo_size(&file_info);
+  if (new_size == old_size && !replaced) {
+    return;
+  }
+
+  linenr_T old_count = buf->b_ml.ml_line_count;
+  int retval = FAIL;
+  if (!replaced && old_size >= 0 && new_size > old_size
+      && reload_text_as_file(buf)) {
+    aco_save_T aco;
+    aucmd_prepbuf(&aco, buf);
+    reload_reader_T *rr = xmalloc(sizeof(reload_reader_T));
+    rr->rr_fd = os_open((char *)buf->b_ffname, O_RDONLY, 0);
+    if (rr->rr_fd >= 0) {
+      retval = buf_read_tail(buf, rr, buf->b_p_eol ? old_count : old_count - 1,
+                             get_fileformat(buf) == EOL_DOS, &file_info, true);
+      close(rr->rr_fd);
+    }
+    xfree(rr);
+    aucmd_restbuf(&aco);
+  }
+  if (retval == FAIL) {
+    buf_reload(buf, buf->b_orig_mode);
+    return;
+  }
+
+  // A window with the cursor in the last line follows the new lines.
+  FOR_ALL_TAB_WINDOWS(tp, wp) {
+    if (wp->w_buffer == buf && wp->w_cursor.lnum == old_count) {
+      wp->w_cursor.lnum = buf->b_ml.ml_line_count;
+      wp->w_cursor.col = 0;
+      if (wp == curwin) {
+        update_topline();
+      }
+    }
+  }
+}
+
 void buf_store_file_info(buf_T *buf, FileInfo *file_info)
   FUNC_ATTR_NONNULL_ALL
 {
@@ -81,7 +81,17 @@ typedef enum {
 EXTERN struct nvim_stats_s {
   int64_t fsync;
   int64_t redraw;
-} g_stats INIT(= { 0, 0 });
+  int64_t mf_hit;     // memfile blocks found in memory
+  int64_t mf_miss;    // memfile blocks read from the swap file
+  int64_t mf_evict;   // memfile blocks removed from memory, see 'swapcache'
+  int64_t redraw_deferred;  // screen updates postponed, see 'redrawrate'
+  int64_t redraw_time;      // microseconds spent in the last screen update
+  int64_t redraw_time_max;  // longest screen update in microseconds
+  // Written by the TUI thread, see tui_stat_add().
+  int64_t tui_bytes;        // bytes written to the terminal
+  int64_t tui_merged;       // frames drawn together with the next one
+  int64_t tui_waits;        // times the TUI waited for the terminal
+} g_stats INIT(= { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 });
 
 // Values for "starting".
 #define NO_SCREEN       2       // no screen updating yet
@@ -901,6 +911,11 @@ EXTERN TriState virtual_op INIT(= kNone);
 /* Display tick, incremented for each call to update_screen() */
 EXTERN disptick_T display_tick INIT(= 0);
 
+// State tick, incremented for each Ex command line, API call that is not
+// "fast" and scheduled Lua callback: anything that may change state that a
+// status line expression uses.
+EXTERN uint64_t state_tick INIT(= 0);
+
 /* Line in which spell checking wasn't highlighted because it touched the
  * cursor position in Insert mode. */
 EXTERN linenr_T spell_redraw_lnum INIT(= 0);
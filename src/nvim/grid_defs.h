@@ -9,8 +9,11 @@
 
 #define MAX_MCO  6  // maximum value for 'maxcombine'
 
-// The characters and attributes drawn on grids.
-typedef char_u schar_T[(MAX_MCO+1) * 4 + 1];
+// Size of a buffer for the text of a cell, see schar_get().
+#define MAX_SCHAR_SIZE ((MAX_MCO + 1) * 4 + 1)
+
+// The characters and attributes drawn on grids.  See schar.c for schar_T.
+typedef uint32_t schar_T;
 typedef int16_t sattr_T;
 
 /// ScreenGrid represents a resizable rectuangular grid displayed by UI clients.
@@ -20,12 +23,12 @@ typedef int16_t sattr_T;
 /// the new state can be compared with the existing state of the grid. This way
 /// we can avoid sending bigger updates than neccessary to the Ul layer.
 ///
-/// Screen cells are stored as NUL-terminated UTF-8 strings, and a cell can
-/// contain up to MAX_MCO composing characters after the base character.
-/// The composing characters are to be drawn on top of the original character.
-/// The content after the NUL is not defined (so comparison must be done a
-/// single cell at a time). Double-width characters are stored in the left cell,
-/// and the right cell should only contain the empty string. When a part of the
+/// Screen cells contain the UTF-8 text of a character, with up to MAX_MCO
+/// composing characters after the base character, as a schar_T.  The
+/// composing characters are to be drawn on top of the original character.
+/// Two cells with the same text have the same schar_T, so cells are compared
+/// as integers. Double-width characters are stored in the left cell, and the
+/// right cell should only contain the empty string (0). When a part of the
 /// screen is cleared, the cells should be filled with a single whitespace char.
 ///
 /// attrs[] contains the highlighting attribute for each cell.
@@ -61,10 +64,11 @@ typedef struct {
   int comp_row;
   int comp_col;
   size_t comp_index;
-  bool comp_disabled;
+  int comp_rows;  // size of the grid in the occlusion map
+  int comp_cols;
 } ScreenGrid;
 
 #define SCREEN_GRID_INIT { 0, NULL, NULL, NULL, NULL, 0, 0, false, 0, 0, \
-                           false, 0, 0, 0,  false }
+                           false, 0, 0, 0, 0, 0 }
 
 #endif  // NVIM_GRID_DEFS_H
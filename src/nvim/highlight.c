@@ -27,6 +27,17 @@ static Map(int, int) *combine_attr_entries;
 static Map(int, int) *blend_attr_entries;
 static Map(int, int) *blendthrough_attr_entries;
 
+/// Recent results of hl_blend_attrs(), looked up before the maps above.
+/// Indexed by "through" and a hash of the attributes.
+#define BLEND_CACHE_SIZE 1024
+typedef struct {
+  int back_attr;
+  int front_attr;
+  int id;             ///< resulting attributes, zero for an unused entry
+  bool through;       ///< resulting "through"
+} BlendCacheEntry;
+static BlendCacheEntry blend_cache[2][BLEND_CACHE_SIZE];
+
 void highlight_init(void)
 {
   attr_entry_ids = map_new(HlEntry, int)();
@@ -251,6 +262,7 @@ void clear_hl_tables(bool reinit)
     map_clear(int, int)(combine_attr_entries);
     map_clear(int, int)(blend_attr_entries);
     map_clear(int, int)(blendthrough_attr_entries);
+    memset(blend_cache, 0, sizeof(blend_cache));
     highlight_attr_set_all();
     highlight_changed();
     screen_invalidate_highlights();
@@ -267,6 +279,7 @@ void hl_invalidate_blends(void)
 {
   map_clear(int, int)(blend_attr_entries);
   map_clear(int, int)(blendthrough_attr_entries);
+  memset(blend_cache, 0, sizeof(blend_cache));
   highlight_changed();
   update_window_hl(curwin, true);
 }
@@ -370,6 +383,24 @@ static HlAttrs get_colors_force(int attr)
 ///
 /// @return the resulting attributes.
 int hl_blend_attrs(int back_attr, int front_attr, bool *through)
+{
+  const uint32_t hash = ((uint32_t)back_attr * 0x9E3779B1u
+                         ^ (uint32_t)front_attr) % BLEND_CACHE_SIZE;
+  BlendCacheEntry *const ce = &blend_cache[*through][hash];
+  if (ce->id > 0 && ce->back_attr == back_attr
+      && ce->front_attr == front_attr) {
+    *through = ce->through;
+    return ce->id;
+  }
+  const int id = hl_blend_attrs_uncached(back_attr, front_attr, through);
+  if (id > 0) {
+    *ce = (BlendCacheEntry) { back_attr, front_attr, id, *through };
+  }
+  return id;
+}
+
+static int hl_blend_attrs_uncached(int back_attr, int front_attr,
+                                   bool *through)
 {
   HlAttrs fattrs = get_colors_force(front_attr);
   int ratio = fattrs.hl_blend;
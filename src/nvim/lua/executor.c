@@ -159,6 +159,7 @@ static int nlua_luv_cfpcall(lua_State *lstate, int nargs, int nresult,
 static void nlua_schedule_event(void **argv)
 {
   LuaRef cb = (LuaRef)(ptrdiff_t)argv[0];
+  state_tick++;
   lua_State *const lstate = nlua_enter();
   nlua_pushref(lstate, cb);
   nlua_unref(lstate, cb);
@@ -154,6 +154,8 @@ void event_init(void)
   remote_ui_init();
   api_vim_init();
   terminal_init();
+  ml_pt_init();
+  screen_frame_init();
   ui_init();
 }
 
@@ -174,6 +176,8 @@ bool event_teardown(void)
   server_teardown();
   signal_teardown();
   terminal_teardown();
+  ml_pt_teardown();
+  screen_frame_teardown();
 
   return loop_close(&main_loop, true);
 }
@@ -20,6 +20,19 @@
 /// as long as it is locked. If it is no longer locked it can be swapped out to
 /// the file. It is only written to the file if it has been changed.
 ///
+/// When the blocks in memory take more than 'swapcache', blocks are swapped
+/// out using the CLOCK algorithm: a hand moves over the used list and removes
+/// the first unlocked block that was not used since the hand passed it
+/// before.  Without 'swapcache' the used list is kept in LRU order, for
+/// mf_release_all().
+///
+/// Syncing while typing (see ml_sync_all()) copies the dirty blocks and lets
+/// a worker thread write them, so that a slow disk doesn't delay typing.  The
+/// copies form a consistent state of the file, written from last to first like
+/// a synchronous sync.  Anything else that uses the file first waits for the
+/// worker to finish.  Only one asynchronous write can be busy per memfile, a
+/// sync while one is busy leaves the blocks dirty for the next sync.
+///
 /// Under normal operation the file is created when opening the memory file and
 /// deleted when closing the memory file. Only with recovery an existing memory
 /// file is opened.
@@ -39,19 +52,26 @@
 /// mf_fullname()     make file name full path (use before first :cd)
 
 #include <assert.h>
+#include <errno.h>
 #include <inttypes.h>
 #include <limits.h>
 #include <string.h>
 #include <stdbool.h>
 #include <fcntl.h>
 
+#include <uv.h>
+
 #include "nvim/vim.h"
 #include "nvim/ascii.h"
 #include "nvim/memfile.h"
 #include "nvim/fileio.h"
 #include "nvim/memline.h"
 #include "nvim/message.h"
+#include "nvim/option.h"
 #include "nvim/memory.h"
+#include "nvim/lib/kvec.h"
+#include "nvim/main.h"
+#include "nvim/event/multiqueue.h"
 #include "nvim/os_unix.h"
 #include "nvim/path.h"
 #include "nvim/assert.h"
@@ -61,6 +81,37 @@
 #define MEMFILE_PAGE_SIZE 4096       /// default page size
 
 
+// pwrite() is used on the worker thread, not available on Windows.
+#ifndef WIN32
+# define MF_ASYNC_WRITE
+# include <unistd.h>
+#endif
+
+/// One write of an asynchronous sync.
+typedef struct {
+  off_T offset;           ///< offset in the file
+  void *data;             ///< copy of the block data
+  unsigned size;          ///< number of bytes
+  blocknr_T bnum;         ///< block number, not used for filler data
+  bool filler;            ///< fills the space of a freed block
+} mf_write_T;
+
+/// An asynchronous sync of a memfile, done by a libuv worker.
+struct mf_async {
+  uv_work_t req;
+  memfile_T *mfp;         ///< NULL when the memfile was closed
+  int fd;
+  bool fsync;             ///< also fsync() the file
+  kvec_t(mf_write_T) writes;
+  bool done;              ///< worker finished, protected by mf_async_mutex
+  bool failed;            ///< a write failed, set by the worker
+  bool finished;          ///< result was handled by mf_async_finish()
+};
+
+static uv_once_t mf_async_once = UV_ONCE_INIT;
+static uv_mutex_t mf_async_mutex;
+static uv_cond_t mf_async_cond;
+
 #ifdef INCLUDE_GENERATED_DECLARATIONS
 # include "memfile.c.generated.h"
 #endif
@@ -96,14 +147,20 @@ memfile_T *mf_open(char_u *fname, int flags)
   mfp->mf_free_first = NULL;         // free list is empty
   mfp->mf_used_first = NULL;         // used list is empty
   mfp->mf_used_last = NULL;
+  mfp->mf_clock_hand = NULL;
+  mfp->mf_used_pages = 0;
   mfp->mf_dirty = false;
+  mfp->mf_async = NULL;
   mf_hash_init(&mfp->mf_hash);
   mf_hash_init(&mfp->mf_trans);
   mfp->mf_page_size = MEMFILE_PAGE_SIZE;
 
-  // Try to set the page size equal to device's block size. Speeds up I/O a lot.
+  // Use 'swappagesize' when set, otherwise try to set the page size equal to
+  // device's block size. Speeds up I/O a lot.
   FileInfo file_info;
-  if (mfp->mf_fd >= 0 && os_fileinfo_fd(mfp->mf_fd, &file_info)) {
+  if (p_swps > 0) {
+    mfp->mf_page_size = (unsigned)p_swps;
+  } else if (mfp->mf_fd >= 0 && os_fileinfo_fd(mfp->mf_fd, &file_info)) {
     uint64_t blocksize = os_fileinfo_blocksize(&file_info);
     if (blocksize >= MIN_SWAP_PAGE_SIZE && blocksize <= MAX_SWAP_PAGE_SIZE) {
       STATIC_ASSERT(MAX_SWAP_PAGE_SIZE <= UINT_MAX,
@@ -167,6 +224,7 @@ void mf_close(memfile_T *mfp, bool del_file)
   if (mfp == NULL) {                    // safety check
     return;
   }
+  mf_sync_wait(mfp);
   if (mfp->mf_fd >= 0 && close(mfp->mf_fd) < 0) {
       EMSG(_(e_swapclose));
   }
@@ -198,13 +256,14 @@ void mf_close_file(buf_T *buf, bool getlines)
     return;
   }
 
-  if (getlines) {
+  if (getlines && buf->b_ml.ml_pt == NULL) {
     // get all blocks in memory by accessing all lines (clumsy!)
     for (linenr_T lnum = 1; lnum <= buf->b_ml.ml_line_count; lnum++) {
       (void)ml_get_buf(buf, lnum, false);
     }
   }
 
+  mf_sync_wait(mfp);
   if (close(mfp->mf_fd) < 0) {           // close the file
     EMSG(_(e_swapclose));
   }
@@ -261,11 +320,12 @@ bhdr_T *mf_new(memfile_T *mfp, bool negative, unsigned page_count)
       mfp->mf_blocknr_max += page_count;
     }
   }
-  hp->bh_flags = BH_LOCKED | BH_DIRTY;    // new block is always dirty
+  hp->bh_flags = BH_LOCKED | BH_DIRTY | BH_USED;  // new block is always dirty
   mfp->mf_dirty = true;
   hp->bh_page_count = page_count;
   mf_ins_used(mfp, hp);
   mf_ins_hash(mfp, hp);
+  mf_release(mfp);
 
   // Init the data to all zero, to avoid reading uninitialized data.
   // This also avoids that the passwd file ends up in the swap file!
@@ -287,29 +347,40 @@ bhdr_T *mf_get(memfile_T *mfp, blocknr_T nr, unsigned page_count)
 
   // see if it is in the cache
   bhdr_T *hp = mf_find_hash(mfp, nr);
-  if (hp == NULL) {                             // not in the hash list
-    if (nr < 0 || nr >= mfp->mf_infile_count)   // can't be in the file
-      return NULL;
+  if (hp != NULL) {
+    g_stats.mf_hit++;
+    hp->bh_flags |= BH_LOCKED | BH_USED;
+    if (p_swc <= 0) {
+      // Without 'swapcache' mf_release_all() frees the blocks from the end
+      // of the used list: keep it in LRU order.  With it, marking the block
+      // used is enough, the CLOCK hand will skip it once.
+      mf_rem_used(mfp, hp);
+      mf_ins_used(mfp, hp);
+    }
+    return hp;
+  }
 
-    // could check here if the block is in the free list
+  if (nr < 0 || nr >= mfp->mf_infile_count) {   // can't be in the file
+    return NULL;
+  }
 
-    hp = mf_alloc_bhdr(mfp, page_count);
+  // could check here if the block is in the free list
 
-    hp->bh_bnum = nr;
-    hp->bh_flags = 0;
-    hp->bh_page_count = page_count;
-    if (mf_read(mfp, hp) == FAIL) {             // cannot read the block
-      mf_free_bhdr(hp);
-      return NULL;
-    }
-  } else {
-    mf_rem_used(mfp, hp);       // remove from list, insert in front below
-    mf_rem_hash(mfp, hp);
+  hp = mf_alloc_bhdr(mfp, page_count);
+
+  hp->bh_bnum = nr;
+  hp->bh_flags = 0;
+  hp->bh_page_count = page_count;
+  if (mf_read(mfp, hp) == FAIL) {               // cannot read the block
+    mf_free_bhdr(hp);
+    return NULL;
   }
+  g_stats.mf_miss++;
 
-  hp->bh_flags |= BH_LOCKED;
+  hp->bh_flags |= BH_LOCKED | BH_USED;
   mf_ins_used(mfp, hp);         // put in front of used list
   mf_ins_hash(mfp, hp);         // put in front of hash list
+  mf_release(mfp);
 
   return hp;
 }
@@ -358,6 +429,7 @@ void mf_free(memfile_T *mfp, bhdr_T *hp)
 ///               MFS_FLUSH  Make sure buffers are flushed to disk, so they will
 ///                          survive a system crash.
 ///               MFS_ZERO   Only write block 0.
+///               MFS_ASYNC  Write on a worker thread, see mf_sync_async().
 ///
 /// @return FAIL  If failure. Possible causes:
 ///               - No file (nothing to do).
@@ -372,6 +444,13 @@ int mf_sync(memfile_T *mfp, int flags)
     return FAIL;
   }
 
+#ifdef MF_ASYNC_WRITE
+  if (flags & MFS_ASYNC) {
+    return mf_sync_async(mfp, flags);
+  }
+#endif
+  mf_sync_wait(mfp);
+
   // Only a CTRL-C while writing will break us here, not one typed previously.
   got_int = false;
 
@@ -419,6 +498,180 @@ int mf_sync(memfile_T *mfp, int flags)
   return status;
 }
 
+#ifdef MF_ASYNC_WRITE
+/// Like mf_sync(), but copy the dirty blocks and write the copies with a libuv
+/// worker.  The blocks are marked clean right away, when a write fails they
+/// are marked dirty again once the worker is done.  Does nothing when the
+/// previous asynchronous sync is still busy.
+///
+/// @return  OK, unless a negative block number could not be translated.
+static int mf_sync_async(memfile_T *mfp, int flags)
+{
+  if (mfp->mf_async != NULL) {
+    if (!mf_async_done(mfp->mf_async)) {
+      return OK;                // still busy, blocks stay dirty
+    }
+    mf_async_finish(mfp->mf_async);
+  }
+
+  uv_once(&mf_async_once, mf_async_init);
+  mf_async_T *job = xcalloc(1, sizeof(mf_async_T));
+  job->req.data = job;
+  job->mfp = mfp;
+  job->fd = mfp->mf_fd;
+  job->fsync = flags & MFS_FLUSH;
+  kv_init(job->writes);
+
+  int status = OK;
+  for (bhdr_T *hp = mfp->mf_used_last; hp != NULL; hp = hp->bh_prev) {
+    if (((flags & MFS_ALL) || hp->bh_bnum >= 0)
+        && (hp->bh_flags & BH_DIRTY)
+        && (!(flags & MFS_ZERO) || hp->bh_bnum == 0)
+        && mf_write_int(mfp, hp, job) == FAIL) {
+      status = FAIL;
+      break;
+    }
+  }
+  mfp->mf_dirty = false;
+
+  if (kv_size(job->writes) == 0 && !job->fsync) {
+    job->finished = true;
+    mf_async_free(job);
+    return status;
+  }
+  mfp->mf_async = job;
+  uv_queue_work(&main_loop.uv, &job->req, mf_async_work, mf_async_after);
+  return status;
+}
+
+static void mf_async_init(void)
+{
+  uv_mutex_init(&mf_async_mutex);
+  uv_cond_init(&mf_async_cond);
+}
+
+/// Write the copied blocks, runs on a worker thread.
+static void mf_async_work(uv_work_t *req)
+{
+  mf_async_T *job = req->data;
+  bool failed = false;
+  for (size_t i = 0; i < kv_size(job->writes) && !failed; i++) {
+    mf_write_T *w = &kv_A(job->writes, i);
+    char *data = w->data;
+    off_T offset = w->offset;
+    for (size_t todo = w->size; todo > 0; ) {
+      ssize_t n = pwrite(job->fd, data, todo, offset);
+      if (n < 0 && errno == EINTR) {
+        continue;
+      }
+      if (n <= 0) {
+        failed = true;
+        break;
+      }
+      data += n;
+      offset += n;
+      todo -= (size_t)n;
+    }
+  }
+  if (!failed && job->fsync && fsync(job->fd) != 0) {
+    failed = true;
+  }
+
+  uv_mutex_lock(&mf_async_mutex);
+  job->failed = failed;
+  job->done = true;
+  uv_cond_broadcast(&mf_async_cond);
+  uv_mutex_unlock(&mf_async_mutex);
+}
+
+/// Called on the main loop when the worker is done.  The result is handled
+/// from the event queue, when it is safe to give a message.
+static void mf_async_after(uv_work_t *req, int status)
+{
+  multiqueue_put(main_loop.events, mf_async_event, 1, req->data);
+}
+
+static void mf_async_event(void **argv)
+{
+  mf_async_T *job = argv[0];
+  mf_async_finish(job);
+  mf_async_free(job);
+}
+
+static bool mf_async_done(mf_async_T *job)
+{
+  uv_mutex_lock(&mf_async_mutex);
+  bool done = job->done;
+  uv_mutex_unlock(&mf_async_mutex);
+  return done;
+}
+
+/// Handle the result of an asynchronous sync, once.  The job itself is freed
+/// by mf_async_event().
+static void mf_async_finish(mf_async_T *job)
+{
+  if (job->finished) {
+    return;
+  }
+  job->finished = true;
+  if (job->fsync) {
+    g_stats.fsync++;
+  }
+  memfile_T *mfp = job->mfp;
+  if (mfp == NULL) {
+    return;
+  }
+  mfp->mf_async = NULL;
+  job->mfp = NULL;
+  if (job->failed) {
+    // Write the blocks again at the next sync.
+    for (size_t i = 0; i < kv_size(job->writes); i++) {
+      if (kv_A(job->writes, i).filler) {
+        continue;
+      }
+      bhdr_T *hp = mf_find_hash(mfp, kv_A(job->writes, i).bnum);
+      if (hp != NULL) {
+        hp->bh_flags |= BH_DIRTY;
+      }
+    }
+    mfp->mf_dirty = true;
+    if (!did_swapwrite_msg) {
+      EMSG(_("E297: Write error in swap file"));
+    }
+    did_swapwrite_msg = true;
+  } else {
+    did_swapwrite_msg = false;
+  }
+}
+
+static void mf_async_free(mf_async_T *job)
+{
+  for (size_t i = 0; i < kv_size(job->writes); i++) {
+    xfree(kv_A(job->writes, i).data);
+  }
+  kv_destroy(job->writes);
+  xfree(job);
+}
+#endif
+
+/// Wait for an asynchronous sync of "mfp" to finish.  Must be done before
+/// using the file in any other way.
+void mf_sync_wait(memfile_T *mfp)
+{
+#ifdef MF_ASYNC_WRITE
+  mf_async_T *job = mfp->mf_async;
+  if (job == NULL) {
+    return;
+  }
+  uv_mutex_lock(&mf_async_mutex);
+  while (!job->done) {
+    uv_cond_wait(&mf_async_cond, &mf_async_mutex);
+  }
+  uv_mutex_unlock(&mf_async_mutex);
+  mf_async_finish(job);
+#endif
+}
+
 /// Set dirty flag for all blocks in memory file with a positive block number.
 /// These are blocks that need to be written to a newly created swapfile.
 void mf_set_dirty(memfile_T *mfp)
@@ -452,6 +705,7 @@ static bhdr_T *mf_find_hash(memfile_T *mfp, blocknr_T nr)
 /// Insert block at the front of memfile's used list.
 static void mf_ins_used(memfile_T *mfp, bhdr_T *hp)
 {
+  mfp->mf_used_pages += hp->bh_page_count;
   hp->bh_next = mfp->mf_used_first;
   mfp->mf_used_first = hp;
   hp->bh_prev = NULL;
@@ -465,6 +719,10 @@ static void mf_ins_used(memfile_T *mfp, bhdr_T *hp)
 /// Remove block from memfile's used list.
 static void mf_rem_used(memfile_T *mfp, bhdr_T *hp)
 {
+  mfp->mf_used_pages -= hp->bh_page_count;
+  if (mfp->mf_clock_hand == hp) {          // move the hand past it
+    mfp->mf_clock_hand = hp->bh_prev;
+  }
   if (hp->bh_next == NULL)                 // last block in used list
     mfp->mf_used_last = hp->bh_prev;
   else
@@ -476,6 +734,66 @@ static void mf_rem_used(memfile_T *mfp, bhdr_T *hp)
     hp->bh_prev->bh_next = hp->bh_next;
 }
 
+/// Swap out blocks until they fit in 'swapcache'.
+///
+/// The CLOCK hand moves from the oldest block towards the newest and starts
+/// over at the oldest.  Locked blocks and blocks that can't be written are
+/// skipped, a block that was used since the hand passed it is skipped once.
+static void mf_release(memfile_T *mfp)
+{
+  if (p_swc <= 0) {
+    return;
+  }
+  blocknr_T max_pages = (blocknr_T)(p_swc * 1024 / mfp->mf_page_size);
+  if (mfp->mf_used_pages <= max_pages) {
+    return;
+  }
+
+  // Need a swap file to write blocks to.  If there is none yet, try to open
+  // one.
+  if (mfp->mf_fd < 0) {
+    FOR_ALL_BUFFERS(buf) {
+      if (buf->b_ml.ml_mfp == mfp) {
+        if (buf->b_may_swap) {
+          ml_open_file(buf);
+        }
+        break;
+      }
+    }
+    if (mfp->mf_fd < 0) {
+      return;
+    }
+  }
+
+  // A block marked clean may still be waiting to be written.
+  mf_sync_wait(mfp);
+
+  // Every block is looked at no more than twice.
+  for (blocknr_T n = 2 * mfp->mf_used_pages;
+       mfp->mf_used_pages > max_pages && n > 0; n--) {
+    bhdr_T *hp = mfp->mf_clock_hand;
+    if (hp == NULL) {
+      hp = mfp->mf_used_last;
+    }
+    mfp->mf_clock_hand = hp->bh_prev;
+    // Block 0 is changed in memory by ml_setflags(), keep it.
+    if ((hp->bh_flags & BH_LOCKED) || hp->bh_bnum == 0) {
+      continue;
+    }
+    if (hp->bh_flags & BH_USED) {
+      hp->bh_flags &= ~BH_USED;
+      continue;
+    }
+    if ((hp->bh_flags & BH_DIRTY) && mf_write(mfp, hp) == FAIL) {
+      continue;
+    }
+    mf_rem_used(mfp, hp);
+    mf_rem_hash(mfp, hp);
+    mf_free_bhdr(hp);
+    g_stats.mf_evict++;
+  }
+}
+
 /// Release as many blocks as possible.
 ///
 /// Used in case of out of memory
@@ -494,14 +812,16 @@ bool mf_release_all(void)
 
       // Flush as many blocks as possible, only if there is a swapfile.
       if (mfp->mf_fd >= 0) {
+        mf_sync_wait(mfp);
         for (bhdr_T *hp = mfp->mf_used_last; hp != NULL; ) {
           if (!(hp->bh_flags & BH_LOCKED)
               && (!(hp->bh_flags & BH_DIRTY)
                   || mf_write(mfp, hp) != FAIL)) {
+            bhdr_T *prev = hp->bh_prev;
             mf_rem_used(mfp, hp);
             mf_rem_hash(mfp, hp);
             mf_free_bhdr(hp);
-            hp = mfp->mf_used_last;    // restart, list was changed
+            hp = prev;
             retval = true;
           } else {
             hp = hp->bh_prev;
@@ -556,6 +876,7 @@ static int mf_read(memfile_T *mfp, bhdr_T *hp)
 {
   if (mfp->mf_fd < 0)       // there is no file, can't read
     return FAIL;
+  mf_sync_wait(mfp);
 
   unsigned page_size = mfp->mf_page_size;
   // TODO(elmart): Check (page_size * hp->bh_bnum) within off_T bounds.
@@ -584,6 +905,14 @@ static int mf_read(memfile_T *mfp, bhdr_T *hp)
 ///                - Seek error in swap file.
 ///                - Write error in swap file.
 static int mf_write(memfile_T *mfp, bhdr_T *hp)
+{
+  mf_sync_wait(mfp);
+  return mf_write_int(mfp, hp, NULL);
+}
+
+/// Write a block to disk or, when "job" is not NULL, add copies of what is
+/// to be written to "job".
+static int mf_write_int(memfile_T *mfp, bhdr_T *hp, mf_async_T *job)
 {
   off_T offset;             // offset in the file
   blocknr_T nr;             // block nr which is being written
@@ -616,17 +945,24 @@ static int mf_write(memfile_T *mfp, bhdr_T *hp)
 
     // TODO(elmart): Check (page_size * nr) within off_T bounds.
     offset = (off_T)(page_size * nr);
-    if (vim_lseek(mfp->mf_fd, offset, SEEK_SET) != offset) {
-      PERROR(_("E296: Seek error in swap file write"));
-      return FAIL;
-    }
     if (hp2 == NULL)                // freed block, fill with dummy data
       page_count = 1;
     else
       page_count = hp2->bh_page_count;
     size = page_size * page_count;
     void *data = (hp2 == NULL) ? hp->bh_data : hp2->bh_data;
-    if ((unsigned)write_eintr(mfp->mf_fd, data, size) != size) {
+    if (job != NULL) {
+      kv_push(job->writes, ((mf_write_T) {
+        .offset = offset,
+        .data = xmemdup(data, size),
+        .size = size,
+        .bnum = hp2 == NULL ? nr : hp2->bh_bnum,
+        .filler = hp2 == NULL,
+      }));
+    } else if (vim_lseek(mfp->mf_fd, offset, SEEK_SET) != offset) {
+      PERROR(_("E296: Seek error in swap file write"));
+      return FAIL;
+    } else if ((unsigned)write_eintr(mfp->mf_fd, data, size) != size) {
       /// Avoid repeating the error message, this mostly happens when the
       /// disk is full. We give the message again only after a successful
       /// write or when hitting a key. We keep on trying, in case some
@@ -635,8 +971,9 @@ static int mf_write(memfile_T *mfp, bhdr_T *hp)
         EMSG(_("E297: Write error in swap file"));
       did_swapwrite_msg = true;
       return FAIL;
+    } else {
+      did_swapwrite_msg = false;
     }
-    did_swapwrite_msg = false;
     if (hp2 != NULL)                               // written a non-dummy block
       hp2->bh_flags &= ~BH_DIRTY;
     if (nr + (blocknr_T)page_count > mfp->mf_infile_count)  // appended to file
@@ -54,7 +54,9 @@ typedef struct mf_hashtab {
 /// The block may be linked in the used list OR in the free list.
 /// The used blocks are also kept in hash lists.
 ///
-/// The used list is a doubly linked list, most recently used block first.
+/// The used list is a doubly linked list, most recently loaded block first.
+/// A CLOCK hand moves over it to find blocks to remove from memory, skipping
+/// blocks that were used since it passed them last, see 'swapcache'.
 /// The blocks in the used list have a block of memory allocated.
 /// The hash lists are used to quickly find a block in the used list.
 /// The free list is a single linked list, not sorted.
@@ -71,7 +73,8 @@ typedef struct bhdr {
 
 #define BH_DIRTY    1U
 #define BH_LOCKED   2U
-  unsigned bh_flags;                 // BH_DIRTY or BH_LOCKED
+#define BH_USED     4U               // used since the CLOCK hand passed it
+  unsigned bh_flags;                 // BH_DIRTY, BH_LOCKED or BH_USED
 } bhdr_T;
 
 /// A block number translation list item.
@@ -86,6 +89,9 @@ typedef struct mf_blocknr_trans_item {
   blocknr_T nt_new_bnum;                 /// new, positive, number
 } mf_blocknr_trans_item_T;
 
+/// An asynchronous sync, defined in memfile.c.
+typedef struct mf_async mf_async_T;
+
 /// A memory file.
 typedef struct memfile {
   char_u *mf_fname;                  /// name of the file
@@ -93,7 +99,9 @@ typedef struct memfile {
   int mf_fd;                         /// file descriptor
   bhdr_T *mf_free_first;             /// first block header in free list
   bhdr_T *mf_used_first;             /// mru block header in used list
-  bhdr_T *mf_used_last;              /// lru block header in used list
+  bhdr_T *mf_used_last;              /// oldest block header in used list
+  bhdr_T *mf_clock_hand;             /// next block to check for removal
+  blocknr_T mf_used_pages;           /// number of pages in used list
   mf_hashtab_T mf_hash;              /// hash lists
   mf_hashtab_T mf_trans;             /// trans lists
   blocknr_T mf_blocknr_max;          /// highest positive block number + 1
@@ -102,6 +110,7 @@ typedef struct memfile {
   blocknr_T mf_infile_count;         /// number of pages in the file
   unsigned mf_page_size;             /// number of bytes in a page
   bool mf_dirty;                      /// TRUE if there are dirty blocks
+  mf_async_T *mf_async;              /// asynchronous sync in progress
 } memfile_T;
 
 #endif  // NVIM_MEMFILE_DEFS_H
@@ -47,6 +47,7 @@
 #include "nvim/vim.h"
 #include "nvim/memline.h"
 #include "nvim/buffer.h"
+#include "nvim/buffer_updates.h"
 #include "nvim/cursor.h"
 #include "nvim/eval.h"
 #include "nvim/getchar.h"
@@ -59,6 +60,7 @@
 #include "nvim/memory.h"
 #include "nvim/message.h"
 #include "nvim/misc1.h"
+#include "nvim/piecetable.h"
 #include "nvim/option.h"
 #include "nvim/os_unix.h"
 #include "nvim/path.h"
@@ -73,6 +75,8 @@
 #include "nvim/os/os.h"
 #include "nvim/os/process.h"
 #include "nvim/os/input.h"
+#include "nvim/event/loop.h"
+#include "nvim/event/time.h"
 
 #ifndef UNIX            /* it's in os/unix_defs.h for Unix */
 # include <time.h>
@@ -222,6 +226,10 @@ struct block0 {
  */
 static linenr_T lowest_marked = 0;
 
+// Timer for indexing files loaded with a piece table in the background.
+static TimeWatcher pt_index_timer;
+static bool pt_index_pending = false;
+
 /*
  * arguments for ml_find_line()
  */
@@ -262,6 +270,7 @@ int ml_open(buf_T *buf)
   buf->b_ml.ml_locked = NULL;   /* no cached block */
   buf->b_ml.ml_line_lnum = 0;   /* no cached line */
   buf->b_ml.ml_chunksize = NULL;
+  buf->b_ml.ml_pt = NULL;
 
   if (cmdmod.noswapfile) {
     buf->b_p_swf = false;
@@ -374,6 +383,186 @@ error:
   return FAIL;
 }
 
+/// Use piece table "pt" for the lines of "buf", replacing all its lines.
+///
+/// The memfile stays open, but holds no lines.  No swap file is used.  When
+/// "pt" has not indexed the whole file the rest is indexed in the background,
+/// lines are added at the end as they are found.
+///
+/// @param pt  Piece table, owned by the memline from now on.
+void ml_open_pt(buf_T *buf, piecetable_T *pt)
+  FUNC_ATTR_NONNULL_ALL
+{
+  assert(buf->b_ml.ml_mfp != NULL);
+  ml_flush_line(buf);
+  pt_free(buf->b_ml.ml_pt);
+  buf->b_ml.ml_pt = pt;
+  buf->b_ml.ml_line_count = pt_line_count(pt);
+  buf->b_ml.ml_pt_unreported = 0;
+  buf->b_ml.ml_line_lnum = 0;
+  buf->b_ml.ml_flags &= ~ML_EMPTY;
+  XFREE_CLEAR(buf->b_ml.ml_chunksize);
+  mf_close_file(buf, false);
+  buf->b_may_swap = false;
+  if (!pt_index_done(pt)) {
+    ml_pt_schedule();
+  }
+}
+
+void ml_pt_init(void)
+{
+  time_watcher_init(&main_loop, &pt_index_timer, NULL);
+  // pt_index_timer_cb sends buffer updates and redraws
+  pt_index_timer.events = multiqueue_new_child(main_loop.events);
+}
+
+void ml_pt_teardown(void)
+{
+  time_watcher_stop(&pt_index_timer);
+  multiqueue_free(pt_index_timer.events);
+  time_watcher_close(&pt_index_timer, NULL);
+}
+
+/// Index the rest of a file that is still being loaded into "buf" and report
+/// the new lines.  Must be done before line numbers are computed for a
+/// command that uses the last line or all lines of the buffer, or changes it.
+///
+/// Only to be called where buffer update callbacks may run: not while the
+/// buffer is being changed.
+void ml_pt_finish(buf_T *buf)
+  FUNC_ATTR_NONNULL_ALL
+{
+  if (textlock != 0) {
+    // In a buffer update callback.
+    ml_pt_finish_silent(buf);
+  } else if (buf->b_ml.ml_pt != NULL) {
+    if (!pt_index_done(buf->b_ml.ml_pt)) {
+      ml_pt_index(buf, SIZE_MAX);
+    }
+    ml_pt_report(buf);
+  }
+}
+
+/// Like ml_pt_finish(), for where the buffer is about to be changed and the
+/// new lines cannot be reported.  That is left to the next ml_pt_finish() or
+/// the indexing timer.
+void ml_pt_finish_silent(buf_T *buf)
+  FUNC_ATTR_NONNULL_ALL
+{
+  if (buf->b_ml.ml_pt != NULL && !pt_index_done(buf->b_ml.ml_pt)) {
+    ml_pt_index(buf, SIZE_MAX);
+    ml_pt_schedule();
+  }
+}
+
+/// Index up to "limit" more bytes of the file in "buf" and make the new lines
+/// visible.  They are reported by ml_pt_report().
+static void ml_pt_index(buf_T *buf, size_t limit)
+{
+  piecetable_T *pt = buf->b_ml.ml_pt;
+  const linenr_T old_count = buf->b_ml.ml_line_count;
+  const bool done = pt_index_more(pt, limit);
+  const linenr_T count = pt_line_count(pt);
+
+  buf->b_ml.ml_line_count = count;
+  buf->b_ml.ml_pt_unreported += count - old_count;
+  if (done && pt_no_eol(pt)) {
+    buf->b_p_eol = false;
+    buf->b_start_eol = false;
+    buf->b_no_eol_lnum = count;
+  }
+  FOR_ALL_TAB_WINDOWS(tp, wp) {
+    if (wp->w_buffer == buf) {
+      if (wp->w_botline > old_count) {
+        redraw_win_later(wp, NOT_VALID);
+      }
+      wp->w_redr_status = true;
+    }
+  }
+}
+
+/// Report the lines indexed at the end of "buf" like lines that were
+/// appended: for buffer updates, b:changedtick and redrawing.
+static void ml_pt_report(buf_T *buf)
+{
+  static bool reporting = false;
+  // A callback may index more, the outer call reports that too.
+  if (reporting) {
+    ml_pt_schedule();
+    return;
+  }
+  reporting = true;
+  while (buf->b_ml.ml_pt != NULL && buf->b_ml.ml_pt_unreported > 0) {
+    const linenr_T count = buf->b_ml.ml_pt_unreported;
+    const linenr_T lnum = buf->b_ml.ml_line_count - count + 1;
+    buf->b_ml.ml_pt_unreported = 0;
+    buf_inc_changedtick(buf);
+    changed_lines_buf(buf, lnum, lnum, count);
+    buf_updates_send_changes(buf, lnum, count, 0, true);
+  }
+  reporting = false;
+}
+
+/// Start the indexing timer, unless it is already pending.
+static void ml_pt_schedule(void)
+{
+  if (!pt_index_pending) {
+    time_watcher_start(&pt_index_timer, pt_index_timer_cb, 0, 0);
+    pt_index_pending = true;
+  }
+}
+
+/// Indexes a step of every file that is still being loaded, see
+/// ml_open_pt().
+static void pt_index_timer_cb(TimeWatcher *watcher, void *data)
+{
+  pt_index_pending = false;
+  if (exiting) {
+    return;
+  }
+  bool more = false;
+  FOR_ALL_BUFFERS(buf) {
+    if (buf->b_ml.ml_pt != NULL) {
+      if (!pt_index_done(buf->b_ml.ml_pt)) {
+        ml_pt_index(buf, PT_INDEX_STEP);
+        more |= !pt_index_done(buf->b_ml.ml_pt);
+      }
+      ml_pt_report(buf);
+    }
+  }
+  if (more) {
+    ml_pt_schedule();
+  }
+}
+
+/// The file "fname" is going to be overwritten: buffers that have it mapped
+/// must stop using the mapping.
+void ml_pt_unshare(const char *fname)
+  FUNC_ATTR_NONNULL_ALL
+{
+  FileID file_id;
+  if (!os_fileid(fname, &file_id)) {
+    return;
+  }
+  FOR_ALL_BUFFERS(buf) {
+    if (buf->b_ml.ml_pt != NULL) {
+      pt_unshare(buf->b_ml.ml_pt, &file_id);
+    }
+  }
+}
+
+/// Called when another program changed the file of "buf".  Stops using the
+/// mapping of the file.
+///
+/// @param size  Size of the file now, UINT64_MAX when it was deleted.
+///
+/// @return  true when the text of "buf" may have been changed with the file.
+bool ml_pt_file_changed(buf_T *buf, uint64_t size)
+  FUNC_ATTR_NONNULL_ALL
+{
+  return buf->b_ml.ml_pt != NULL && pt_file_changed(buf->b_ml.ml_pt, size);
+}
+
 /*
  * ml_setname() is called when the file name of "buf" has been changed.
  * It may rename the swap file.
@@ -480,6 +669,13 @@ void ml_open_file(buf_T *buf)
     return; /* nothing to do */
   }
 
+  // The lines of a piece table are not in the memfile, a swap file would be
+  // useless for recovery.
+  if (buf->b_ml.ml_pt != NULL) {
+    buf->b_may_swap = false;
+    return;
+  }
+
   /* For a spell buffer use a temp file name. */
   if (buf->b_spell) {
     fname = vim_tempname();
@@ -564,6 +760,8 @@ void ml_close(buf_T *buf, int del_file)
     xfree(buf->b_ml.ml_line_ptr);
   xfree(buf->b_ml.ml_stack);
   XFREE_CLEAR(buf->b_ml.ml_chunksize);
+  pt_free(buf->b_ml.ml_pt);
+  buf->b_ml.ml_pt = NULL;
   buf->b_ml.ml_mfp = NULL;
 
   /* Reset the "recovered" flag, give the ATTENTION prompt the next time
@@ -1665,7 +1863,8 @@ static int recov_file_names(char_u **names, char_u *path, int prepend_dot)
  *
  * If 'check_file' is TRUE, check if original file exists and was not changed.
  * If 'check_char' is TRUE, stop syncing when character becomes available, but
- * always sync at least one block.
+ * always sync at least one block.  The blocks are then written on a worker
+ * thread, so that typing isn't delayed by a slow disk.
  */
 void ml_sync_all(int check_file, int check_char, bool do_fsync)
 {
@@ -1692,7 +1891,7 @@ void ml_sync_all(int check_file, int check_char, bool do_fsync)
       }
     }
     if (buf->b_ml.ml_mfp->mf_dirty) {
-      (void)mf_sync(buf->b_ml.ml_mfp, (check_char ? MFS_STOP : 0)
+      (void)mf_sync(buf->b_ml.ml_mfp, (check_char ? MFS_STOP | MFS_ASYNC : 0)
                     | (do_fsync && bufIsChanged(buf) ? MFS_FLUSH : 0));
       if (check_char && os_char_avail()) {      // character available now
         break;
@@ -1845,6 +2044,22 @@ errorret:
    * Don't use the last used line when 'swapfile' is reset, need to load all
    * blocks.
    */
+  if (buf->b_ml.ml_pt != NULL) {
+    if (buf->b_ml.ml_line_lnum != lnum) {
+      ml_flush_line(buf);
+      buf->b_ml.ml_line_ptr = pt_get_line(buf->b_ml.ml_pt, lnum);
+      buf->b_ml.ml_line_lnum = lnum;
+      buf->b_ml.ml_flags &= ~ML_LINE_DIRTY;
+    }
+    // The text of the piece table can't be changed in place: make a copy
+    // that ml_flush_line() stores.
+    if (will_change && !(buf->b_ml.ml_flags & ML_LINE_DIRTY)) {
+      buf->b_ml.ml_line_ptr = vim_strsave(buf->b_ml.ml_line_ptr);
+      buf->b_ml.ml_flags |= ML_LINE_DIRTY;
+    }
+    return buf->b_ml.ml_line_ptr;
+  }
+
   if (buf->b_ml.ml_line_lnum != lnum) {
     ml_flush_line(buf);
 
@@ -1935,6 +2150,146 @@ int ml_append_buf(
   return ml_append_int(buf, lnum, line, len, newfile, FALSE);
 }
 
+/// Append "count" lines after line "lnum" (may be 0) in the current buffer.
+/// Like calling ml_append() for each line, but data blocks are filled with as
+/// many lines as fit at once.
+///
+/// @param lines  Text of the new lines, NUL terminated.
+/// @param lens  Length of each line including the NUL, NULL to use STRLEN().
+/// @param newfile  Flag, see ml_append().
+///
+/// @return  FAIL when not all lines could be appended.
+int ml_append_lines(linenr_T lnum, char_u **lines, const colnr_T *lens,
+                   linenr_T count, bool newfile)
+  FUNC_ATTR_NONNULL_ARG(2)
+{
+  // When starting up, we might still need to create the memfile
+  if (curbuf->b_ml.ml_mfp == NULL && open_buffer(false, NULL, 0) == FAIL) {
+    return FAIL;
+  }
+  return ml_append_lines_buf(curbuf, lnum, lines, lens, count, newfile);
+}
+
+/// Like ml_append_lines() but for an arbitrary buffer.  The buffer must
+/// already have a memline.
+int ml_append_lines_buf(buf_T *buf, linenr_T lnum, char_u **lines,
+                        const colnr_T *lens, linenr_T count, bool newfile)
+  FUNC_ATTR_NONNULL_ARG(1, 3)
+{
+  if (buf->b_ml.ml_mfp == NULL) {
+    return FAIL;
+  }
+  if (buf->b_ml.ml_line_lnum != 0) {
+    ml_flush_line(buf);
+  }
+  ml_pt_finish_silent(buf);
+
+  linenr_T done = 0;
+  while (done < count) {
+    linenr_T n = 0;
+    if (buf->b_ml.ml_pt == NULL) {
+      n = ml_append_block(buf, lnum + done, lines + done,
+                          lens == NULL ? NULL : lens + done, count - done,
+                          newfile);
+    }
+    if (n == 0) {
+      // The line does not fit in the block: ml_append_int() splits it.
+      if (ml_append_int(buf, lnum + done, lines[done],
+                        lens == NULL ? 0 : lens[done], newfile,
+                        false) == FAIL) {
+        return FAIL;
+      }
+      n = 1;
+    }
+    done += n;
+  }
+  return OK;
+}
+
+/// Insert as many of "count" lines after line "lnum" as fit in the data block
+/// where ml_append_int() would insert the first one.
+///
+/// @return  number of lines inserted, zero if not even the first one fits.
+static linenr_T ml_append_block(buf_T *buf, linenr_T lnum, char_u **lines,
+                                const colnr_T *lens, linenr_T count,
+                                bool newfile)
+{
+  if (lnum > buf->b_ml.ml_line_count) {
+    return 0;
+  }
+  bhdr_T *hp = ml_find_line(buf, lnum == 0 ? (linenr_T)1 : lnum, ML_INSERT);
+  if (hp == NULL) {
+    return 0;
+  }
+  DATA_BL *dp = hp->bh_data;
+  // With lnum zero line one was found, db_idx is negative then.
+  const int db_idx = lnum == 0 ? -1 : (int)(lnum - buf->b_ml.ml_locked_low);
+  // line count before the insertion
+  const int line_count = (int)(buf->b_ml.ml_locked_high
+                               - buf->b_ml.ml_locked_low);
+
+  // Find out how many lines fit.
+  linenr_T n = 0;
+  int text_len = 0;
+  int space = 0;
+  while (n < count) {
+    const int len = lens == NULL ? (int)STRLEN(lines[n]) + 1 : lens[n];
+    if (space + len + (int)INDEX_SIZE > (int)dp->db_free) {
+      break;
+    }
+    text_len += len;
+    space += len + (int)INDEX_SIZE;
+    n++;
+  }
+  if (n == 0) {
+    // ml_append_int() will find the line again.
+    buf->b_ml.ml_locked_lineadd--;
+    buf->b_ml.ml_locked_high--;
+    return 0;
+  }
+
+  if (lowest_marked && lowest_marked > lnum) {
+    lowest_marked = lnum + 1;
+  }
+  buf->b_ml.ml_flags &= ~ML_EMPTY;
+  buf->b_ml.ml_line_count += n;
+  // ml_find_line() already counted one line.
+  buf->b_ml.ml_locked_lineadd += n - 1;
+  buf->b_ml.ml_locked_high += n - 1;
+
+  // The new lines go where the text of line "lnum" starts, move the text of
+  // the lines that follow to the front and adjust their indexes.
+  int offset = (int)dp->db_txt_start;
+  dp->db_txt_start -= (unsigned)text_len;
+  dp->db_free -= (unsigned)space;
+  dp->db_line_count += n;
+  if (line_count > db_idx + 1) {
+    offset = db_idx < 0 ? (int)dp->db_txt_end
+                        : (int)(dp->db_index[db_idx] & DB_INDEX_MASK);
+    memmove((char *)dp + dp->db_txt_start,
+            (char *)dp + dp->db_txt_start + text_len,
+            (size_t)offset - (dp->db_txt_start + (unsigned)text_len));
+    for (int i = line_count - 1; i > db_idx; i--) {
+      dp->db_index[i + n] = dp->db_index[i] - (unsigned)text_len;
+    }
+  }
+  for (linenr_T i = 0; i < n; i++) {
+    const int len = lens == NULL ? (int)STRLEN(lines[i]) + 1 : lens[i];
+    offset -= len;
+    dp->db_index[db_idx + 1 + i] = (unsigned)offset;
+    memmove((char *)dp + offset, lines[i], (size_t)len);
+  }
+
+  buf->b_ml.ml_flags |= ML_LOCKED_DIRTY;
+  if (!newfile) {
+    buf->b_ml.ml_flags |= ML_LOCKED_POS;
+  }
+
+  // Updating the chunk sizes may release the block.
+  ml_updatechunk_lines(buf, lnum + 1, n, text_len);
+  return n;
+}
+
 static int ml_append_int(
     buf_T *buf,
     linenr_T lnum,                  // append after this line (can be 0)
@@ -1958,6 +2313,8 @@ static int ml_append_int(
   PTR_BL      *pp;
   infoptr_T   *ip;
 
+  ml_pt_finish_silent(buf);
+
   /* lnum out of range */
   if (lnum > buf->b_ml.ml_line_count || buf->b_ml.ml_mfp == NULL)
     return FAIL;
@@ -1967,6 +2324,14 @@ static int ml_append_int(
 
   if (len == 0)
     len = (colnr_T)STRLEN(line) + 1;            /* space needed for the text */
+
+  if (buf->b_ml.ml_pt != NULL) {
+    pt_append_line(buf->b_ml.ml_pt, lnum, line, (size_t)len - 1, mark);
+    buf->b_ml.ml_flags &= ~ML_EMPTY;
+    buf->b_ml.ml_line_count++;
+    return OK;
+  }
+
   space_needed = len + INDEX_SIZE;      /* space needed for text + index */
 
   mfp = buf->b_ml.ml_mfp;
@@ -2445,6 +2810,8 @@ static int ml_delete_int(buf_T *buf, linenr_T lnum, bool message)
   long line_size;
   int i;
 
+  ml_pt_finish_silent(buf);
+
   if (lnum < 1 || lnum > buf->b_ml.ml_line_count)
     return FAIL;
 
@@ -2465,6 +2832,12 @@ static int ml_delete_int(buf_T *buf, linenr_T lnum, bool message)
     return i;
   }
 
+  if (buf->b_ml.ml_pt != NULL) {
+    pt_delete_line(buf->b_ml.ml_pt, lnum);
+    buf->b_ml.ml_line_count--;
+    return OK;
+  }
+
   /*
    * find the data block containing the line
    * This also fills the stack with the blocks from the root to the data block
@@ -2583,6 +2956,11 @@ void ml_setmarked(linenr_T lnum)
   if (lowest_marked == 0 || lowest_marked > lnum)
     lowest_marked = lnum;
 
+  if (curbuf->b_ml.ml_pt != NULL) {
+    pt_set_mark(curbuf->b_ml.ml_pt, lnum);
+    return;
+  }
+
   /*
    * find the data block containing the line
    * This also fills the stack with the blocks from the root to the data block
@@ -2609,6 +2987,12 @@ linenr_T ml_firstmarked(void)
   if (curbuf->b_ml.ml_mfp == NULL)
     return (linenr_T) 0;
 
+  if (curbuf->b_ml.ml_pt != NULL) {
+    lnum = pt_first_marked(curbuf->b_ml.ml_pt);
+    lowest_marked = lnum + 1;
+    return lnum;
+  }
+
   /*
    * The search starts with lowest_marked line. This is the last line where
    * a mark was found, adjusted by inserting/deleting lines.
@@ -2650,6 +3034,12 @@ void ml_clearmarked(void)
   if (curbuf->b_ml.ml_mfp == NULL)          /* nothing to do */
     return;
 
+  if (curbuf->b_ml.ml_pt != NULL) {
+    pt_clear_marks(curbuf->b_ml.ml_pt);
+    lowest_marked = 0;
+    return;
+  }
+
   /*
    * The search starts with line lowest_marked.
    */
@@ -2707,8 +3097,9 @@ static void ml_flush_line(buf_T *buf)
     lnum = buf->b_ml.ml_line_lnum;
     new_line = buf->b_ml.ml_line_ptr;
 
-    hp = ml_find_line(buf, lnum, ML_FIND);
-    if (hp == NULL) {
+    if (buf->b_ml.ml_pt != NULL) {
+      pt_replace_line(buf->b_ml.ml_pt, lnum, new_line);
+    } else if ((hp = ml_find_line(buf, lnum, ML_FIND)) == NULL) {
       IEMSGN(_("E320: Cannot find line %" PRId64), lnum);
     } else {
       dp = hp->bh_data;
@@ -3723,6 +4114,13 @@ void ml_setflags(buf_T *buf)
 #define MLCS_MAXL 800   /* max no of lines in chunk */
 #define MLCS_MINL 400   /* should be half of MLCS_MAXL */
 
+// The chunk of the line last added by ml_updatechunk(), to quickly find the
+// chunk of the next line when adding lines one by one.
+static buf_T *ml_upd_lastbuf = NULL;
+static linenr_T ml_upd_lastline;
+static linenr_T ml_upd_lastcurline;
+static int ml_upd_lastcurix;
+
 /*
  * Keep information for finding byte offset of a line, updtype may be one of:
  * ML_CHNK_ADDLINE: Add len to parent chunk, possibly splitting it
@@ -3732,11 +4130,6 @@ void ml_setflags(buf_T *buf)
  */
 static void ml_updatechunk(buf_T *buf, linenr_T line, long len, int updtype)
 {
-  static buf_T        *ml_upd_lastbuf = NULL;
-  static linenr_T ml_upd_lastline;
-  static linenr_T ml_upd_lastcurline;
-  static int ml_upd_lastcurix;
-
   linenr_T curline = ml_upd_lastcurline;
   int curix = ml_upd_lastcurix;
   long size;
@@ -3747,13 +4140,7 @@ static void ml_updatechunk(buf_T *buf, linenr_T line, long len, int updtype)
 
   if (buf->b_ml.ml_usedchunks == -1 || len == 0)
     return;
-  if (buf->b_ml.ml_chunksize == NULL) {
-    buf->b_ml.ml_chunksize = xmalloc(sizeof(chunksize_T) * 100);
-    buf->b_ml.ml_numchunks = 100;
-    buf->b_ml.ml_usedchunks = 1;
-    buf->b_ml.ml_chunksize[0].mlcs_numlines = 1;
-    buf->b_ml.ml_chunksize[0].mlcs_totalsize = 1;
-  }
+  ml_init_chunks(buf);
 
   if (updtype == ML_CHNK_UPDLINE && buf->b_ml.ml_line_count == 1) {
     /*
@@ -3763,6 +4150,7 @@ static void ml_updatechunk(buf_T *buf, linenr_T line, long len, int updtype)
     buf->b_ml.ml_chunksize[0].mlcs_numlines = 1;
     buf->b_ml.ml_chunksize[0].mlcs_totalsize =
       (long)STRLEN(buf->b_ml.ml_line_ptr) + 1;
+    buf->b_ml.ml_chunktree_dirty = true;
     return;
   }
 
@@ -3772,13 +4160,7 @@ static void ml_updatechunk(buf_T *buf, linenr_T line, long len, int updtype)
    */
   if (buf != ml_upd_lastbuf || line != ml_upd_lastline + 1
       || updtype != ML_CHNK_ADDLINE) {
-    for (curline = 1, curix = 0;
-         curix < buf->b_ml.ml_usedchunks - 1
-                 && line >= curline +
-                             buf->b_ml.ml_chunksize[curix].mlcs_numlines;
-         curix++) {
-      curline += buf->b_ml.ml_chunksize[curix].mlcs_numlines;
-    }
+    curix = ml_find_chunk(buf, line, 0, false, &curline, &size);
   } else if (curix < buf->b_ml.ml_usedchunks - 1
              && line >= curline + buf->b_ml.ml_chunksize[curix].mlcs_numlines) {
     // Adjust cached curix & curline
@@ -3789,62 +4171,15 @@ static void ml_updatechunk(buf_T *buf, linenr_T line, long len, int updtype)
 
   if (updtype == ML_CHNK_DELLINE)
     len = -len;
-  curchnk->mlcs_totalsize += len;
+  ml_adjust_chunk(buf, curix, (updtype == ML_CHNK_ADDLINE ? 1
+                               : updtype == ML_CHNK_DELLINE ? -1 : 0), len);
   if (updtype == ML_CHNK_ADDLINE) {
-    curchnk->mlcs_numlines++;
 
     /* May resize here so we don't have to do it in both cases below */
-    if (buf->b_ml.ml_usedchunks + 1 >= buf->b_ml.ml_numchunks) {
-      buf->b_ml.ml_numchunks = buf->b_ml.ml_numchunks * 3 / 2;
-      buf->b_ml.ml_chunksize = (chunksize_T *)
-                               xrealloc(buf->b_ml.ml_chunksize,
-          sizeof(chunksize_T) * buf->b_ml.ml_numchunks);
-    }
+    ml_grow_chunks(buf);
 
     if (buf->b_ml.ml_chunksize[curix].mlcs_numlines >= MLCS_MAXL) {
-      int count;                    /* number of entries in block */
-      int idx;
-      int text_end;
-      int linecnt;
-
-      memmove(buf->b_ml.ml_chunksize + curix + 1,
-          buf->b_ml.ml_chunksize + curix,
-          (buf->b_ml.ml_usedchunks - curix) *
-          sizeof(chunksize_T));
-      /* Compute length of first half of lines in the split chunk */
-      size = 0;
-      linecnt = 0;
-      while (curline < buf->b_ml.ml_line_count
-             && linecnt < MLCS_MINL) {
-        if ((hp = ml_find_line(buf, curline, ML_FIND)) == NULL) {
-          buf->b_ml.ml_usedchunks = -1;
-          return;
-        }
-        dp = hp->bh_data;
-        count = (long)(buf->b_ml.ml_locked_high) -
-                (long)(buf->b_ml.ml_locked_low) + 1;
-        idx = curline - buf->b_ml.ml_locked_low;
-        curline = buf->b_ml.ml_locked_high + 1;
-        if (idx == 0)        /* first line in block, text at the end */
-          text_end = dp->db_txt_end;
-        else
-          text_end = ((dp->db_index[idx - 1]) & DB_INDEX_MASK);
-        /* Compute index of last line to use in this MEMLINE */
-        rest = count - idx;
-        if (linecnt + rest > MLCS_MINL) {
-          idx += MLCS_MINL - linecnt - 1;
-          linecnt = MLCS_MINL;
-        } else {
-          idx = count - 1;
-          linecnt += rest;
-        }
-        size += text_end - ((dp->db_index[idx]) & DB_INDEX_MASK);
-      }
-      buf->b_ml.ml_chunksize[curix].mlcs_numlines = linecnt;
-      buf->b_ml.ml_chunksize[curix + 1].mlcs_numlines -= linecnt;
-      buf->b_ml.ml_chunksize[curix].mlcs_totalsize = size;
-      buf->b_ml.ml_chunksize[curix + 1].mlcs_totalsize -= size;
-      buf->b_ml.ml_usedchunks++;
+      ml_split_chunk(buf, curix, curline);
       ml_upd_lastbuf = NULL;         /* Force recalc of curix & curline */
       return;
     } else if (buf->b_ml.ml_chunksize[curix].mlcs_numlines >= MLCS_MINL
@@ -3856,6 +4191,7 @@ static void ml_updatechunk(buf_T *buf, linenr_T line, long len, int updtype)
        */
       curchnk = buf->b_ml.ml_chunksize + curix + 1;
       buf->b_ml.ml_usedchunks++;
+      buf->b_ml.ml_chunktree_dirty = true;
       if (line == buf->b_ml.ml_line_count) {
         curchnk->mlcs_numlines = 0;
         curchnk->mlcs_totalsize = 0;
@@ -3883,7 +4219,6 @@ static void ml_updatechunk(buf_T *buf, linenr_T line, long len, int updtype)
       }
     }
   } else if (updtype == ML_CHNK_DELLINE) {
-    curchnk->mlcs_numlines--;
     ml_upd_lastbuf = NULL;       /* Force recalc of curix & curline */
     if (curix < (buf->b_ml.ml_usedchunks - 1)
         && (curchnk->mlcs_numlines + curchnk[1].mlcs_numlines)
@@ -3894,6 +4229,7 @@ static void ml_updatechunk(buf_T *buf, linenr_T line, long len, int updtype)
       buf->b_ml.ml_usedchunks--;
       memmove(buf->b_ml.ml_chunksize, buf->b_ml.ml_chunksize + 1,
           buf->b_ml.ml_usedchunks * sizeof(chunksize_T));
+      buf->b_ml.ml_chunktree_dirty = true;
       return;
     } else if (curix == 0 || (curchnk->mlcs_numlines > 10
                               && (curchnk->mlcs_numlines +
@@ -3906,6 +4242,7 @@ static void ml_updatechunk(buf_T *buf, linenr_T line, long len, int updtype)
     curchnk[-1].mlcs_numlines += curchnk->mlcs_numlines;
     curchnk[-1].mlcs_totalsize += curchnk->mlcs_totalsize;
     buf->b_ml.ml_usedchunks--;
+    buf->b_ml.ml_chunktree_dirty = true;
     if (curix < buf->b_ml.ml_usedchunks) {
       memmove(buf->b_ml.ml_chunksize + curix,
           buf->b_ml.ml_chunksize + curix + 1,
@@ -3920,6 +4257,189 @@ static void ml_updatechunk(buf_T *buf, linenr_T line, long len, int updtype)
   ml_upd_lastcurix = curix;
 }
 
+/// Add "count" lines with "len" bytes in total, starting at line "line", to the
+/// chunks.  Like using ml_updatechunk() with ML_CHNK_ADDLINE for each line, but
+/// for when the text of all of them is already in the memline: chunks are
+/// split only once the lines are counted, at the real line offsets.
+static void ml_updatechunk_lines(buf_T *buf, linenr_T line, linenr_T count,
+                                 long len)
+{
+  if (buf->b_ml.ml_usedchunks == -1 || len == 0) {
+    return;
+  }
+  ml_init_chunks(buf);
+  ml_upd_lastbuf = NULL;
+
+  linenr_T curline;
+  long size;
+  int curix = ml_find_chunk(buf, line, 0, false, &curline, &size);
+  ml_adjust_chunk(buf, curix, (int)count, len);
+  while (buf->b_ml.ml_usedchunks != -1
+         && buf->b_ml.ml_chunksize[curix].mlcs_numlines >= MLCS_MAXL) {
+    ml_grow_chunks(buf);
+    ml_split_chunk(buf, curix, curline);
+    curline += buf->b_ml.ml_chunksize[curix].mlcs_numlines;
+    curix++;
+  }
+}
+
+/// Allocate the chunks of "buf" if that was not done yet, starting with the
+/// one line of an empty buffer.
+static void ml_init_chunks(buf_T *buf)
+{
+  if (buf->b_ml.ml_chunksize == NULL) {
+    buf->b_ml.ml_chunksize = xmalloc(sizeof(chunksize_T) * 100);
+    buf->b_ml.ml_numchunks = 100;
+    buf->b_ml.ml_usedchunks = 1;
+    buf->b_ml.ml_chunksize[0].mlcs_numlines = 1;
+    buf->b_ml.ml_chunksize[0].mlcs_totalsize = 1;
+    buf->b_ml.ml_chunktree_dirty = true;
+  }
+}
+
+/// Make room for at least one more chunk.
+static void ml_grow_chunks(buf_T *buf)
+{
+  if (buf->b_ml.ml_usedchunks + 1 >= buf->b_ml.ml_numchunks) {
+    buf->b_ml.ml_numchunks = buf->b_ml.ml_numchunks * 3 / 2;
+    buf->b_ml.ml_chunksize = (chunksize_T *)
+                             xrealloc(buf->b_ml.ml_chunksize,
+                                      sizeof(chunksize_T)
+                                      * buf->b_ml.ml_numchunks);
+  }
+}
+
+/// Split chunk "curix", which starts at line "curline", after its first
+/// MLCS_MINL lines.  Uses the text in the memline to find their size.
+/// Sets ml_usedchunks to -1 when a line cannot be found.
+static void ml_split_chunk(buf_T *buf, int curix, linenr_T curline)
+{
+  int count;                    // number of entries in block
+  int idx;
+  int text_end;
+  int linecnt;
+  int rest;
+  long size;
+  bhdr_T *hp;
+  DATA_BL *dp;
+
+  memmove(buf->b_ml.ml_chunksize + curix + 1,
+          buf->b_ml.ml_chunksize + curix,
+          (buf->b_ml.ml_usedchunks - curix) * sizeof(chunksize_T));
+  // Compute length of first half of lines in the split chunk
+  size = 0;
+  linecnt = 0;
+  while (curline < buf->b_ml.ml_line_count
+         && linecnt < MLCS_MINL) {
+    if ((hp = ml_find_line(buf, curline, ML_FIND)) == NULL) {
+      buf->b_ml.ml_usedchunks = -1;
+      return;
+    }
+    dp = hp->bh_data;
+    count = (long)(buf->b_ml.ml_locked_high) -
+            (long)(buf->b_ml.ml_locked_low) + 1;
+    idx = curline - buf->b_ml.ml_locked_low;
+    curline = buf->b_ml.ml_locked_high + 1;
+    if (idx == 0) {   // first line in block, text at the end
+      text_end = dp->db_txt_end;
+    } else {
+      text_end = ((dp->db_index[idx - 1]) & DB_INDEX_MASK);
+    }
+    // Compute index of last line to use in this MEMLINE
+    rest = count - idx;
+    if (linecnt + rest > MLCS_MINL) {
+      idx += MLCS_MINL - linecnt - 1;
+      linecnt = MLCS_MINL;
+    } else {
+      idx = count - 1;
+      linecnt += rest;
+    }
+    size += text_end - ((dp->db_index[idx]) & DB_INDEX_MASK);
+  }
+  buf->b_ml.ml_chunksize[curix].mlcs_numlines = linecnt;
+  buf->b_ml.ml_chunksize[curix + 1].mlcs_numlines -= linecnt;
+  buf->b_ml.ml_chunksize[curix].mlcs_totalsize = size;
+  buf->b_ml.ml_chunksize[curix + 1].mlcs_totalsize -= size;
+  buf->b_ml.ml_usedchunks++;
+  buf->b_ml.ml_chunktree_dirty = true;
+}
+
+/// Add "lines" and "size" to chunk "idx", also in the Fenwick tree.
+static void ml_adjust_chunk(buf_T *buf, int idx, int lines, long size)
+{
+  chunksize_T *cs = buf->b_ml.ml_chunksize;
+  cs[idx].mlcs_numlines += lines;
+  cs[idx].mlcs_totalsize += size;
+  if (!buf->b_ml.ml_chunktree_dirty) {
+    for (int i = idx + 1; i <= buf->b_ml.ml_usedchunks; i += i & -i) {
+      cs[i - 1].mlcs_treelines += lines;
+      cs[i - 1].mlcs_treesize += size;
+    }
+  }
+}
+
+/// Rebuild the Fenwick tree after chunks were split, joined or removed.
+/// Linear in the number of chunks.
+static void ml_build_chunktree(buf_T *buf)
+{
+  chunksize_T *cs = buf->b_ml.ml_chunksize;
+  int n = buf->b_ml.ml_usedchunks;
+  for (int i = 0; i < n; i++) {
+    cs[i].mlcs_treelines = cs[i].mlcs_numlines;
+    cs[i].mlcs_treesize = cs[i].mlcs_totalsize;
+  }
+  for (int i = 1; i <= n; i++) {
+    int parent = i + (i & -i);
+    if (parent <= n) {
+      cs[parent - 1].mlcs_treelines += cs[i - 1].mlcs_treelines;
+      cs[parent - 1].mlcs_treesize += cs[i - 1].mlcs_treesize;
+    }
+  }
+  buf->b_ml.ml_chunktree_dirty = false;
+}
+
+/// Find the chunk that contains line "lnum" (when not zero) or byte "offset"
+/// (when not zero).  The last chunk is used when they are beyond the end.
+///
+/// @param ffdos  count a CR for every line for "offset"
+/// @param[out] curlinep  first line of the chunk
+/// @param[out] sizep  number of bytes before the chunk, without CRs
+///
+/// @return  index of the chunk
+static int ml_find_chunk(buf_T *buf, linenr_T lnum, long offset, int ffdos,
+                         linenr_T *curlinep, long *sizep)
+{
+  if (buf->b_ml.ml_chunktree_dirty) {
+    ml_build_chunktree(buf);
+  }
+  chunksize_T *cs = buf->b_ml.ml_chunksize;
+  int n = buf->b_ml.ml_usedchunks - 1;  // never skip the last chunk
+  int step = 1;
+  while (step <= n / 2) {
+    step *= 2;
+  }
+  // Find the most chunks to skip that all end before "lnum" and "offset".
+  int pos = 0;
+  linenr_T lines = 0;
+  long size = 0;
+  for (; n > 0 && step > 0; step /= 2) {
+    if (pos + step > n) {
+      continue;
+    }
+    const chunksize_T *node = &cs[pos + step - 1];
+    linenr_T l = lines + node->mlcs_treelines;
+    long sz = size + node->mlcs_treesize;
+    if ((lnum != 0 && lnum > l) || (offset != 0 && offset > sz + ffdos * l)) {
+      pos += step;
+      lines = l;
+      size = sz;
+    }
+  }
+  *curlinep = lines + 1;
+  *sizep = size;
+  return pos;
+}
+
 /// Find offset for line or line with offset.
 ///
 /// @param buf buffer to use
@@ -3933,7 +4453,6 @@ static void ml_updatechunk(buf_T *buf, linenr_T line, long len, int updtype)
 long ml_find_line_or_offset(buf_T *buf, linenr_T lnum, long *offp, bool no_ff)
 {
   linenr_T curline;
-  int curix;
   long size;
   bhdr_T      *hp;
   DATA_BL     *dp;
@@ -3946,6 +4465,19 @@ long ml_find_line_or_offset(buf_T *buf, linenr_T lnum, long *offp, bool no_ff)
   int ffdos = !no_ff && (get_fileformat(buf) == EOL_DOS);
   int extra = 0;
 
+  if (buf->b_ml.ml_pt != NULL) {
+    ml_flush_line(buf);
+    if (lnum < 0) {
+      return -1;
+    } else if (lnum > 0) {
+      size = pt_line_offset(buf->b_ml.ml_pt, lnum);
+      return ml_adjust_line_offset(buf, lnum, size, ffdos);
+    } else if (offp == NULL || *offp <= 0) {
+      return 1;
+    }
+    return pt_find_offset(buf->b_ml.ml_pt, offp, ffdos);
+  }
+
   /* take care of cached line first */
   ml_flush_line(curbuf);
 
@@ -3960,24 +4492,10 @@ long ml_find_line_or_offset(buf_T *buf, linenr_T lnum, long *offp, bool no_ff)
     offset = *offp;
   if (lnum == 0 && offset <= 0)
     return 1;       /* Not a "find offset" and offset 0 _must_ be in line 1 */
-  /*
-   * Find the last chunk before the one containing our line. Last chunk is
-   * special because it will never qualify
-   */
-  curline = 1;
-  curix = size = 0;
-  while (curix < buf->b_ml.ml_usedchunks - 1
-         && ((lnum != 0
-              && lnum >= curline + buf->b_ml.ml_chunksize[curix].mlcs_numlines)
-             || (offset != 0
-                 && offset > size +
-                 buf->b_ml.ml_chunksize[curix].mlcs_totalsize
-                 + ffdos * buf->b_ml.ml_chunksize[curix].mlcs_numlines))) {
-    curline += buf->b_ml.ml_chunksize[curix].mlcs_numlines;
-    size += buf->b_ml.ml_chunksize[curix].mlcs_totalsize;
-    if (offset && ffdos)
-      size += buf->b_ml.ml_chunksize[curix].mlcs_numlines;
-    curix++;
+  // Find the chunk containing our line, skipping the ones before it.
+  (void)ml_find_chunk(buf, lnum, offset, ffdos, &curline, &size);
+  if (offset && ffdos) {
+    size += curline - 1;
   }
 
   while ((lnum != 0 && curline < lnum) || (offset != 0 && size < offset)) {
@@ -4031,21 +4549,32 @@ long ml_find_line_or_offset(buf_T *buf, linenr_T lnum, long *offp, bool no_ff)
   }
 
   if (lnum != 0) {
-    /* Count extra CR characters. */
-    if (ffdos)
-      size += lnum - 1;
-
-    /* Don't count the last line break if 'noeol' and ('bin' or
-     * 'nofixeol'). */
-    if ((!buf->b_p_fixeol || buf->b_p_bin) && !buf->b_p_eol
-        && lnum > buf->b_ml.ml_line_count) {
-      size -= ffdos + 1;
-    }
+    size = ml_adjust_line_offset(buf, lnum, size, ffdos);
   }
 
   return size;
 }
 
+/// Adjust the number of bytes before line "lnum" for the line breaks.
+///
+/// @param size  Number of bytes before "lnum", counting one byte for each
+///              line break.
+static long ml_adjust_line_offset(buf_T *buf, linenr_T lnum, long size,
+                                  int ffdos)
+{
+  // Count extra CR characters.
+  if (ffdos) {
+    size += lnum - 1;
+  }
+
+  // Don't count the last line break if 'noeol' and ('bin' or 'nofixeol').
+  if ((!buf->b_p_fixeol || buf->b_p_bin) && !buf->b_p_eol
+      && lnum > buf->b_ml.ml_line_count) {
+    size -= ffdos + 1;
+  }
+  return size;
+}
+
 /// Goto byte in buffer with offset 'cnt'.
 void goto_byte(long cnt)
 {
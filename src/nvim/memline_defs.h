@@ -2,6 +2,7 @@
 #define NVIM_MEMLINE_DEFS_H
 
 #include "nvim/memfile_defs.h"
+#include "nvim/piecetable_defs.h"
 
 ///
 /// When searching for a specific line, we remember what blocks in the tree
@@ -15,9 +16,14 @@ typedef struct info_pointer {
   int ip_index;                 // index for block with current lnum
 } infoptr_T;    // block/index pair
 
+/// A chunk of lines, for finding the byte offset of a line.  The chunks are
+/// also the nodes of a Fenwick tree: chunk "i" holds in mlcs_treelines and
+/// mlcs_treesize the sums for chunks "i - ((i + 1) & -(i + 1)) + 1" to "i".
 typedef struct ml_chunksize {
   int mlcs_numlines;
   long mlcs_totalsize;
+  int mlcs_treelines;
+  long mlcs_treesize;
 } chunksize_T;
 
 // Flags when calling ml_updatechunk()
@@ -32,8 +38,10 @@ typedef struct ml_chunksize {
 ///   pointer_block: internal nodes
 ///   data_block: leaf nodes
 ///
-/// Memline also has "chunks" of 800 lines that are separate from the 128-tree
-/// structure, primarily used to speed up line2byte() and byte2line().
+/// Memline also has "chunks" of 400 to 800 lines that are separate from the
+/// 128-tree structure, primarily used to speed up line2byte() and byte2line().
+/// A Fenwick tree over the chunks finds the chunk of a line or byte offset in
+/// O(log n).
 ///
 /// Motivation: If you have a file that is 10000 lines long, and you insert
 ///             a line at linenr 1000, you don't want to move 9000 lines in
@@ -65,6 +73,11 @@ typedef struct memline {
   chunksize_T *ml_chunksize;
   int ml_numchunks;
   int ml_usedchunks;
+  bool ml_chunktree_dirty;      // Fenwick tree in ml_chunksize must be rebuilt
+
+  piecetable_T *ml_pt;          // lines are in a piece table, not in ml_mfp
+  linenr_T ml_pt_unreported;    // lines at the end that were indexed but
+                                // not reported to buffer updates yet
 } memline_T;
 
 #endif // NVIM_MEMLINE_DEFS_H
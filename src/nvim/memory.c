@@ -541,6 +541,7 @@ void time_to_bytes(time_t time_, uint8_t buf[8])
 #include "nvim/path.h"
 #include "nvim/quickfix.h"
 #include "nvim/regexp.h"
+#include "nvim/schar.h"
 #include "nvim/screen.h"
 #include "nvim/search.h"
 #include "nvim/spell.h"
@@ -688,6 +689,7 @@ void free_all_mem(void)
 
   // free screenlines (can't display anything now!)
   screen_free_all_mem();
+  schar_free_all();
 
   clear_hl_tables(false);
   list_free_log();
@@ -0,0 +1,256 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check
+// it. PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+// memscan.c: fast scanning of text for line breaks, and of screen lines for
+// changes.
+//
+// Reading a file spends most of its time looking for the end of each line.
+// Redrawing spends much of its time comparing a drawn line with the line on
+// the grid, which mostly only differs in a part of it.
+// On x86 this is done 16 (SSE2) or 32 (AVX2) bytes at a time.  SSE2 is
+// always available on x86-64, AVX2 is used when the CPU supports it, checked
+// once at runtime.  Other systems use the plain loops, which are also used
+// for the bytes at the end that don't fill a vector.
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "nvim/ascii.h"
+#include "nvim/memscan.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) \
+                          || (defined(__i386__) && defined(__SSE2__)))
+# define MEMSCAN_X86
+# include <immintrin.h>
+#endif
+
+#ifdef INCLUDE_GENERATED_DECLARATIONS
+# include "memscan.c.generated.h"
+#endif
+
+#ifdef MEMSCAN_X86
+/// Vector width to use: 0 not checked yet, 16 for SSE2, 32 for AVX2.
+static int memscan_width = 0;
+
+static int memscan_get_width(void)
+{
+  if (memscan_width == 0) {
+    __builtin_cpu_init();
+    memscan_width = __builtin_cpu_supports("avx2") ? 32 : 16;
+  }
+  return memscan_width;
+}
+#endif
+
+/// Find the first line break in "p" up to "end": a NL, a NUL (which stands
+/// for a NL in the text) and when "cr" is true a CR.
+///
+/// @return  Pointer to the found byte or "end" when there is none.
+char_u *memscan_eol(char_u *p, const char_u *end, bool cr)
+  FUNC_ATTR_NONNULL_ALL FUNC_ATTR_PURE FUNC_ATTR_NONNULL_RET
+{
+#ifdef MEMSCAN_X86
+  if (end - p >= 16) {
+    p = memscan_get_width() == 32
+        ? memscan_eol_avx2(p, end, cr)
+        : memscan_eol_sse2(p, end, cr);
+  }
+#endif
+  const char_u c = cr ? CAR : NL;
+  while (p < end && *p != NL && *p != NUL && *p != c) {
+    p++;
+  }
+  return p;
+}
+
+/// Count the bytes equal to "c" in "p" up to "end".
+size_t memscan_count(const char_u *p, const char_u *end, char_u c)
+  FUNC_ATTR_NONNULL_ALL FUNC_ATTR_PURE
+{
+  size_t count = 0;
+#ifdef MEMSCAN_X86
+  if (end - p >= 16) {
+    p = memscan_get_width() == 32
+        ? memscan_count_avx2(p, end, c, &count)
+        : memscan_count_sse2(p, end, c, &count);
+  }
+#endif
+  for (; p < end; p++) {
+    if (*p == c) {
+      count++;
+    }
+  }
+  return count;
+}
+
+/// Find the first byte where "a" and "b" of "size" bytes differ.
+///
+/// @return  Offset of the byte or "size" when they are equal.
+size_t memscan_diff(const void *a, const void *b, size_t size)
+  FUNC_ATTR_NONNULL_ALL FUNC_ATTR_PURE
+{
+  const char_u *p = a;
+  const char_u *q = b;
+  size_t off = 0;
+#ifdef MEMSCAN_X86
+  if (size >= 16) {
+    off = memscan_get_width() == 32
+          ? memscan_diff_avx2(p, q, size)
+          : memscan_diff_sse2(p, q, 0, size);
+  }
+#endif
+  while (off < size && p[off] == q[off]) {
+    off++;
+  }
+  return off;
+}
+
+/// Find the last byte where "a" and "b" of "size" bytes differ.
+///
+/// @return  Offset just after the byte or zero when they are equal.
+size_t memscan_rdiff(const void *a, const void *b, size_t size)
+  FUNC_ATTR_NONNULL_ALL FUNC_ATTR_PURE
+{
+  const char_u *p = a;
+  const char_u *q = b;
+  size_t end = size;
+#ifdef MEMSCAN_X86
+  if (size >= 16) {
+    end = memscan_get_width() == 32
+          ? memscan_rdiff_avx2(p, q, size)
+          : memscan_rdiff_sse2(p, q, size);
+  }
+#endif
+  while (end > 0 && p[end - 1] == q[end - 1]) {
+    end--;
+  }
+  return end;
+}
+
+#ifdef MEMSCAN_X86
+// The vector functions stop at a found byte, or before the last bytes that
+// don't fill a vector.
+
+static char_u *memscan_eol_sse2(char_u *p, const char_u *end, bool cr)
+{
+  const __m128i nl = _mm_set1_epi8(NL);
+  const __m128i nul = _mm_setzero_si128();
+  const __m128i c = _mm_set1_epi8(cr ? CAR : NL);
+  for (; end - p >= 16; p += 16) {
+    const __m128i v = _mm_loadu_si128((const __m128i *)p);
+    const int mask = _mm_movemask_epi8(
+        _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, nl),
+                                  _mm_cmpeq_epi8(v, nul)),
+                     _mm_cmpeq_epi8(v, c)));
+    if (mask != 0) {
+      return p + __builtin_ctz((unsigned)mask);
+    }
+  }
+  return p;
+}
+
+__attribute__((target("avx2")))
+static char_u *memscan_eol_avx2(char_u *p, const char_u *end, bool cr)
+{
+  const __m256i nl = _mm256_set1_epi8(NL);
+  const __m256i nul = _mm256_setzero_si256();
+  const __m256i c = _mm256_set1_epi8(cr ? CAR : NL);
+  for (; end - p >= 32; p += 32) {
+    const __m256i v = _mm256_loadu_si256((const __m256i *)p);
+    const int mask = _mm256_movemask_epi8(
+        _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, nl),
+                                        _mm256_cmpeq_epi8(v, nul)),
+                        _mm256_cmpeq_epi8(v, c)));
+    if (mask != 0) {
+      return p + __builtin_ctz((unsigned)mask);
+    }
+  }
+  return memscan_eol_sse2(p, end, cr);
+}
+
+static const char_u *memscan_count_sse2(const char_u *p, const char_u *end,
+                                        char_u c, size_t *countp)
+{
+  const __m128i cv = _mm_set1_epi8((char)c);
+  size_t count = 0;
+  for (; end - p >= 16; p += 16) {
+    const __m128i v = _mm_loadu_si128((const __m128i *)p);
+    count += (size_t)__builtin_popcount(
+        (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(v, cv)));
+  }
+  *countp += count;
+  return p;
+}
+
+__attribute__((target("avx2")))
+static const char_u *memscan_count_avx2(const char_u *p, const char_u *end,
+                                        char_u c, size_t *countp)
+{
+  const __m256i cv = _mm256_set1_epi8((char)c);
+  size_t count = 0;
+  for (; end - p >= 32; p += 32) {
+    const __m256i v = _mm256_loadu_si256((const __m256i *)p);
+    count += (size_t)__builtin_popcount(
+        (unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, cv)));
+  }
+  *countp += count;
+  return memscan_count_sse2(p, end, c, countp);
+}
+
+static size_t memscan_diff_sse2(const char_u *p, const char_u *q, size_t off,
+                                size_t size)
+{
+  for (; size - off >= 16; off += 16) {
+    const unsigned mask = (unsigned)_mm_movemask_epi8(
+        _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(p + off)),
+                       _mm_loadu_si128((const __m128i *)(q + off))));
+    if (mask != 0xFFFF) {
+      return off + (size_t)__builtin_ctz(~mask);
+    }
+  }
+  return off;
+}
+
+__attribute__((target("avx2")))
+static size_t memscan_diff_avx2(const char_u *p, const char_u *q, size_t size)
+{
+  size_t off = 0;
+  for (; size - off >= 32; off += 32) {
+    const unsigned mask = (unsigned)_mm256_movemask_epi8(
+        _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(p + off)),
+                          _mm256_loadu_si256((const __m256i *)(q + off))));
+    if (mask != 0xFFFFFFFF) {
+      return off + (size_t)__builtin_ctz(~mask);
+    }
+  }
+  return memscan_diff_sse2(p, q, off, size);
+}
+
+static size_t memscan_rdiff_sse2(const char_u *p, const char_u *q, size_t end)
+{
+  for (; end >= 16; end -= 16) {
+    const unsigned mask = (unsigned)_mm_movemask_epi8(
+        _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(p + end - 16)),
+                       _mm_loadu_si128((const __m128i *)(q + end - 16))));
+    if (mask != 0xFFFF) {
+      // The highest bit that is not set is the last byte that differs.
+      return end - 16 + 32 - (size_t)__builtin_clz(~mask & 0xFFFF);
+    }
+  }
+  return end;
+}
+
+__attribute__((target("avx2")))
+static size_t memscan_rdiff_avx2(const char_u *p, const char_u *q, size_t end)
+{
+  for (; end >= 32; end -= 32) {
+    const unsigned mask = (unsigned)_mm256_movemask_epi8(
+        _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(p + end - 32)),
+                          _mm256_loadu_si256((const __m256i *)(q + end - 32))));
+    if (mask != 0xFFFFFFFF) {
+      return end - (size_t)__builtin_clz(~mask);
+    }
+  }
+  return memscan_rdiff_sse2(p, q, end);
+}
+#endif
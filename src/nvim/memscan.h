@@ -0,0 +1,12 @@
+#ifndef NVIM_MEMSCAN_H
+#define NVIM_MEMSCAN_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "nvim/types.h"
+
+#ifdef INCLUDE_GENERATED_DECLARATIONS
+# include "memscan.h.generated.h"
+#endif
+#endif  // NVIM_MEMSCAN_H
@@ -1979,6 +1979,23 @@ changed_lines(
   }
 }
 
+/// Like changed_lines(), for lines of the current buffer that were replaced
+/// with the text of its file when reloading it.  The buffer is not marked as
+/// changed: there is no warning for a readonly file, no swap file is created
+/// and the '. mark and the changelist are not set.
+void changed_lines_reload(linenr_T lnum, linenr_T lnume, long xtra)
+{
+  changed_lines_buf(curbuf, lnum, lnume, xtra);
+  if (curwin->w_p_diff && diff_internal()) {
+    curtab->tp_diff_update = true;
+  }
+  buf_inc_changedtick(curbuf);
+  highlight_match = false;
+  changed_windows(lnum, 0, lnume, xtra);
+  buf_updates_send_changes(curbuf, lnum, (int64_t)(lnume + xtra - lnum),
+                           (int64_t)(lnume - lnum), true);
+}
+
 /// Mark line range in buffer as changed.
 ///
 /// @param buf the buffer where lines were changed
@@ -2016,7 +2033,6 @@ void changed_lines_buf(buf_T *buf, linenr_T lnum, linenr_T lnume, long xtra)
  */
 static void changed_common(linenr_T lnum, colnr_T col, linenr_T lnume, long xtra)
 {
-  int i;
   int cols;
   pos_T       *p;
   int add;
@@ -2088,6 +2104,16 @@ static void changed_common(linenr_T lnum, colnr_T col, linenr_T lnume, long xtra
     curwin->w_changelistidx = curbuf->b_changelistlen;
   }
 
+  changed_windows(lnum, col, lnume, xtra);
+}
+
+/// Lines "lnum" to "lnume" of the current buffer changed: update the windows
+/// on it and get them redrawn later.  See changed_lines() for the arguments.
+static void changed_windows(linenr_T lnum, colnr_T col, linenr_T lnume,
+                            long xtra)
+{
+  int i;
+
   FOR_ALL_TAB_WINDOWS(tp, wp) {
     if (wp->w_buffer == curbuf) {
       /* Mark this window to be redrawn later. */
@@ -9,6 +9,7 @@
 #include "nvim/window.h"
 #include "nvim/state.h"
 #include "nvim/strings.h"
+#include "nvim/schar.h"
 #include "nvim/screen.h"
 #include "nvim/syntax.h"
 #include "nvim/ui.h"
@@ -113,8 +114,10 @@ retnomove:
   // fold column. NB: only works for ASCII chars!
   if (row >= 0 && row < Rows && col >= 0 && col <= Columns
       && default_grid.chars != NULL) {
-    mouse_char = default_grid.chars[default_grid.line_offset[row]
-                                    + (unsigned)col][0];
+    char text[MAX_SCHAR_SIZE];
+    schar_get(text, default_grid.chars[default_grid.line_offset[row]
+                                       + (unsigned)col]);
+    mouse_char = (uint8_t)text[0];
   } else {
     mouse_char = ' ';
   }
@@ -369,6 +369,9 @@ static void request_event(void **argv)
   Channel *channel = e->channel;
   MsgpackRpcRequestHandler handler = e->handler;
   Error error = ERROR_INIT;
+  if (!handler.fast) {
+    state_tick++;
+  }
   Object result = handler.fn(channel->id, e->args, &error);
   if (e->type == kMessageTypeRequest || ERROR_SET(&error)) {
     // Send the response.
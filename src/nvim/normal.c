@@ -1320,7 +1320,10 @@ static int normal_check(VimState *state)
     }
 
     normal_check_folds(s);
-    normal_redraw(s);
+    // With 'redrawrate' the redraw may wait for the next frame.
+    if (do_redraw || !update_screen_defer()) {
+      normal_redraw(s);
+    }
     do_redraw = false;
 
     // Now that we have drawn the first screen all the startup stuff
@@ -7397,6 +7400,9 @@ static void nv_goto(cmdarg_T *cap)
 {
   linenr_T lnum;
 
+  if (cap->arg || cap->count0 != 0) {
+    ml_pt_finish(curbuf);
+  }
   if (cap->arg)
     lnum = curbuf->b_ml.ml_line_count;
   else
@@ -122,6 +122,7 @@ static int p_ai;
 static int p_bin;
 static int p_bomb;
 static char_u   *p_bh;
+static char_u   *p_bst;
 static char_u   *p_bt;
 static int p_bl;
 static long p_channel;
@@ -137,6 +138,7 @@ static char_u   *p_cfu;
 static char_u   *p_ofu;
 static int p_eol;
 static int p_fixeol;
+static int p_fof;
 static int p_et;
 static char_u   *p_fenc;
 static char_u   *p_ff;
@@ -300,6 +302,7 @@ static char *(p_buftype_values[]) =   { "nofile", "nowrite", "quickfix",
 
 static char *(p_bufhidden_values[]) = { "hide", "unload", "delete",
                                         "wipe", NULL };
+static char *(p_bst_values[]) =       { "memline", "piecetable", NULL };
 static char *(p_bs_values[]) =        { "indent", "eol", "start", NULL };
 static char *(p_fdm_values[]) =       { "manual", "expr", "marker", "indent",
                                         "syntax",  "diff", NULL };
@@ -2245,6 +2248,7 @@ void check_options(void)
 void check_buf_options(buf_T *buf)
 {
   check_string_option(&buf->b_p_bh);
+  check_string_option(&buf->b_p_bst);
   check_string_option(&buf->b_p_bt);
   check_string_option(&buf->b_p_fenc);
   check_string_option(&buf->b_p_ff);
@@ -2664,6 +2668,7 @@ did_set_string_option(
     if (check_opt_strings(p_ambw, p_ambw_values, false) != OK) {
       errmsg = e_invarg;
     } else {
+      vcol_index_invalidate();
       FOR_ALL_TAB_WINDOWS(tp, wp) {
         if (set_chars_option(wp, &wp->w_p_lcs) != NULL) {
           errmsg = (char_u *)_("E834: Conflicts with value of 'listchars'");
@@ -3029,6 +3034,11 @@ ambw_end:
     if (check_opt_strings(curbuf->b_p_bh, p_bufhidden_values, false) != OK) {
       errmsg = e_invarg;
     }
+  } else if (gvarp == &p_bst) {
+    // 'bufstorage': only used when the buffer is loaded.
+    if (check_opt_strings(*varp, p_bst_values, false) != OK) {
+      errmsg = e_invarg;
+    }
   } else if (gvarp == &p_bt) {
     // When 'buftype' is set, check for valid value.
     if ((curbuf->terminal && curbuf->b_p_bt[0] != 't')
@@ -3909,6 +3919,8 @@ static char *set_bool_option(const int opt_idx, char_u *const varp,
   } else if ((int *)varp == &curbuf->b_p_fixeol) {
     // when 'fixeol' is changed, redraw the window title
     redraw_titles();
+  } else if ((int *)varp == &curbuf->b_p_fof) {
+    buf_follow_update(curbuf);
   } else if ((int *)varp == &curbuf->b_p_bomb) {
     // when 'bomb' is changed, redraw the window title and tab page text
     redraw_titles();
@@ -4218,6 +4230,19 @@ static char *set_num_option(int opt_idx, char_u *varp, long value,
     if (value < 0) {
       errmsg = e_positive;
     }
+  } else if (pp == &p_swc) {
+    if (value < 0) {
+      errmsg = e_positive;
+    }
+  } else if (pp == &p_rdr) {
+    if (value < 0) {
+      errmsg = e_positive;
+    }
+  } else if (pp == &p_swps) {
+    if (value != 0
+        && (value < MIN_OPT_SWAP_PAGE_SIZE || value > MAX_SWAP_PAGE_SIZE)) {
+      errmsg = e_invarg;
+    }
   } else if (pp == &p_ch) {
     int minval = ui_has(kUIMessages) ? 0 : 1;
     if (value < minval) {
@@ -5665,6 +5690,7 @@ static char_u *get_varp(vimoption_T *p)
   case PV_BIN:    return (char_u *)&(curbuf->b_p_bin);
   case PV_BOMB:   return (char_u *)&(curbuf->b_p_bomb);
   case PV_BH:     return (char_u *)&(curbuf->b_p_bh);
+  case PV_BST:    return (char_u *)&(curbuf->b_p_bst);
   case PV_BT:     return (char_u *)&(curbuf->b_p_bt);
   case PV_BL:     return (char_u *)&(curbuf->b_p_bl);
   case PV_CHANNEL:return (char_u *)&(curbuf->b_p_channel);
@@ -5680,6 +5706,7 @@ static char_u *get_varp(vimoption_T *p)
   case PV_OFU:    return (char_u *)&(curbuf->b_p_ofu);
   case PV_EOL:    return (char_u *)&(curbuf->b_p_eol);
   case PV_FIXEOL: return (char_u *)&(curbuf->b_p_fixeol);
+  case PV_FOF:    return (char_u *)&(curbuf->b_p_fof);
   case PV_ET:     return (char_u *)&(curbuf->b_p_et);
   case PV_FENC:   return (char_u *)&(curbuf->b_p_fenc);
   case PV_FF:     return (char_u *)&(curbuf->b_p_ff);
@@ -5967,6 +5994,7 @@ void buf_copy_options(buf_T *buf, int flags)
       buf->b_p_bomb = p_bomb;
       buf->b_p_et = p_et;
       buf->b_p_fixeol = p_fixeol;
+      buf->b_p_fof = p_fof;
       buf->b_p_et_nobin = p_et_nobin;
       buf->b_p_et_nopaste = p_et_nopaste;
       buf->b_p_ml = p_ml;
@@ -5983,6 +6011,7 @@ void buf_copy_options(buf_T *buf, int flags)
       buf->b_p_fo = vim_strsave(p_fo);
       buf->b_p_flp = vim_strsave(p_flp);
       buf->b_p_nf = vim_strsave(p_nf);
+      buf->b_p_bst = vim_strsave(p_bst);
       buf->b_p_mps = vim_strsave(p_mps);
       buf->b_p_si = p_si;
       buf->b_p_channel = 0;
@@ -518,6 +518,7 @@ static char *(p_rdb_values[]) = { "compositor", NULL };
 # endif
 # define RDB_COMPOSITOR         0x001
 
+EXTERN long p_rdr;              // 'redrawrate'
 EXTERN long p_rdt;              // 'redrawtime'
 EXTERN int p_remap;             // 'remap'
 EXTERN long p_re;               // 'regexpengine'
@@ -594,6 +595,8 @@ EXTERN char_u   *p_sps;         // 'spellsuggest'
 EXTERN int p_spr;               // 'splitright'
 EXTERN int p_sol;               // 'startofline'
 EXTERN char_u   *p_su;          // 'suffixes'
+EXTERN long p_swc;              // 'swapcache'
+EXTERN long p_swps;             // 'swappagesize'
 EXTERN char_u   *p_swb;         // 'switchbuf'
 EXTERN unsigned swb_flags;
 #ifdef IN_OPTION_C
@@ -700,6 +703,7 @@ enum {
   , BV_AR
   , BV_BH
   , BV_BKC
+  , BV_BST
   , BV_BT
   , BV_EFM
   , BV_GP
@@ -724,6 +728,7 @@ enum {
   , BV_INC
   , BV_EOL
   , BV_FIXEOL
+  , BV_FOF
   , BV_EP
   , BV_ET
   , BV_FENC
@@ -260,6 +260,14 @@ return {
       varname='p_bl',
       defaults={if_true={vi=1}}
     },
+    {
+      full_name='bufstorage', abbreviation='bst',
+      type='string', scope={'buffer'},
+      vi_def=true,
+      alloced=true,
+      varname='p_bst',
+      defaults={if_true={vi="memline"}}
+    },
     {
       full_name='buftype', abbreviation='bt',
       type='string', scope={'buffer'},
@@ -929,6 +937,13 @@ return {
       redraw={'current_window'},
       defaults={if_true={vi="foldtext()"}}
     },
+    {
+      full_name='followfile', abbreviation='fof',
+      type='bool', scope={'buffer'},
+      vi_def=true,
+      varname='p_fof',
+      defaults={if_true={vi=false}}
+    },
     {
       full_name='formatexpr', abbreviation='fex',
       type='string', scope={'buffer'},
@@ -1854,6 +1869,13 @@ return {
       varname='p_rdb',
       defaults={if_true={vi=''}}
     },
+    {
+      full_name='redrawrate', abbreviation='rdr',
+      type='number', scope={'global'},
+      vi_def=true,
+      varname='p_rdr',
+      defaults={if_true={vi=0}}
+    },
     {
       full_name='redrawtime', abbreviation='rdt',
       type='number', scope={'global'},
@@ -2356,6 +2378,13 @@ return {
       varname='p_sua',
       defaults={if_true={vi=""}}
     },
+    {
+      full_name='swapcache', abbreviation='swc',
+      type='number', scope={'global'},
+      vi_def=true,
+      varname='p_swc',
+      defaults={if_true={vi=0}}
+    },
     {
       full_name='swapfile', abbreviation='swf',
       type='bool', scope={'buffer'},
@@ -2364,6 +2393,13 @@ return {
       varname='p_swf',
       defaults={if_true={vi=true}}
     },
+    {
+      full_name='swappagesize', abbreviation='swps',
+      type='number', scope={'global'},
+      vi_def=true,
+      varname='p_swps',
+      defaults={if_true={vi=0}}
+    },
     {
       full_name='switchbuf', abbreviation='swb',
       type='string', list='onecomma', scope={'global'},
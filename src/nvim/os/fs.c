@@ -15,6 +15,11 @@
 # include <sys/uio.h>
 #endif
 
+#ifdef HAVE_SYS_MMAN_H
+# include <sys/mman.h>
+# include <signal.h>
+#endif
+
 #include <uv.h>
 
 #include "nvim/os/os.h"
@@ -27,15 +32,32 @@
 #include "nvim/option.h"
 #include "nvim/path.h"
 #include "nvim/strings.h"
+#include "nvim/lib/kvec.h"
 
 #ifdef WIN32
 #include "nvim/mbyte.h"  // for utf8_to_utf16, utf16_to_utf8
 #endif
 
+#ifdef HAVE_SYS_MMAN_H
+/// A file mapped by os_map_file().
+typedef struct {
+  char *start;
+  size_t size;
+  volatile sig_atomic_t damaged;  ///< pages were replaced after a SIGBUS
+} MappedFile;
+#endif
+
 #ifdef INCLUDE_GENERATED_DECLARATIONS
 # include "os/fs.c.generated.h"
 #endif
 
+#ifdef HAVE_SYS_MMAN_H
+static kvec_t(MappedFile) mapped_files = KV_INITIAL_VALUE;
+static struct sigaction old_sigbus;
+static bool sigbus_installed = false;
+static uintptr_t map_pagesize;
+#endif
+
 #define RUN_UV_FS_FUNC(ret, func, ...) \
     do { \
       bool did_try_to_free = false; \
@@ -649,6 +671,120 @@ ptrdiff_t os_write(const int fd, const char *const buf, const size_t size,
   return (ptrdiff_t)written_bytes;
 }
 
+/// Map the contents of a file into memory, read-only.
+///
+/// Where mmap() is not available the file is read into allocated memory
+/// instead, starting at the current position of `fd`.  Either way the result
+/// must be released with os_unmap_file().
+///
+/// @param[in]  fd  File descriptor opened for reading.
+/// @param[in]  size  Number of bytes to map, must not be zero.
+///
+/// @return Pointer to the file contents or NULL on failure.
+char *os_map_file(const int fd, const size_t size)
+  FUNC_ATTR_WARN_UNUSED_RESULT
+{
+  assert(size > 0);
+#ifdef HAVE_SYS_MMAN_H
+  void *const ptr = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (ptr == MAP_FAILED) {
+    errno = 0;
+    return NULL;
+  }
+  if (!sigbus_installed) {
+    map_pagesize = (uintptr_t)sysconf(_SC_PAGESIZE);
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_sigaction = map_sigbus_handler;
+    sa.sa_flags = SA_SIGINFO;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGBUS, &sa, &old_sigbus);
+    sigbus_installed = true;
+  }
+  kv_push(mapped_files, ((MappedFile) { .start = ptr, .size = size }));
+  return ptr;
+#else
+  char *const ptr = try_malloc(size);
+  if (ptr == NULL) {
+    return NULL;
+  }
+  bool eof;
+  if (os_read(fd, &eof, ptr, size, false) != (ptrdiff_t)size) {
+    xfree(ptr);
+    return NULL;
+  }
+  return ptr;
+#endif
+}
+
+/// Release memory returned by os_map_file().
+///
+/// @param  ptr  Pointer returned by os_map_file().
+/// @param[in]  size  Size passed to os_map_file().
+void os_unmap_file(char *const ptr, const size_t size)
+  FUNC_ATTR_NONNULL_ALL
+{
+#ifdef HAVE_SYS_MMAN_H
+  for (size_t i = 0; i < kv_size(mapped_files); i++) {
+    if (kv_A(mapped_files, i).start == ptr) {
+      kv_A(mapped_files, i) = kv_last(mapped_files);
+      kv_size(mapped_files)--;
+      break;
+    }
+  }
+  munmap(ptr, size);
+#else
+  (void)size;
+  xfree(ptr);
+#endif
+}
+
+/// Check whether a file mapped with os_map_file() was truncated while mapped:
+/// the part after the new end reads as NUL bytes then.
+///
+/// @param  ptr  Pointer returned by os_map_file().
+bool os_map_file_damaged(const char *const ptr)
+  FUNC_ATTR_NONNULL_ALL
+{
+#ifdef HAVE_SYS_MMAN_H
+  for (size_t i = 0; i < kv_size(mapped_files); i++) {
+    if (kv_A(mapped_files, i).start == ptr) {
+      return kv_A(mapped_files, i).damaged;
+    }
+  }
+#endif
+  return false;
+}
+
+#ifdef HAVE_SYS_MMAN_H
+/// Reading a mapped file after another program truncated it raises SIGBUS.
+/// Map a page of zeros where the text was, so that reading continues.  Other
+/// faults get the previous handler.
+static void map_sigbus_handler(int sig, siginfo_t *info, void *context)
+{
+  const int saved_errno = errno;
+  char *const addr = info->si_addr;
+  for (size_t i = 0; i < kv_size(mapped_files); i++) {
+    MappedFile *const mf = &kv_A(mapped_files, i);
+    if (addr >= mf->start && addr < mf->start + mf->size) {
+      void *const page = (void *)((uintptr_t)addr & ~(map_pagesize - 1));
+      if (mmap(page, map_pagesize, PROT_READ,
+               MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0)
+          != MAP_FAILED) {
+        mf->damaged = 1;
+        errno = saved_errno;
+        return;
+      }
+      break;
+    }
+  }
+  // Not a mapped file: fault again with the previous handler.
+  sigaction(SIGBUS, &old_sigbus, NULL);
+  sigbus_installed = false;
+  errno = saved_errno;
+}
+#endif
+
 /// Copies a file from `path` to `new_path`.
 ///
 /// @see http://docs.libuv.org/en/v1.x/fs.html#c.uv_fs_copyfile
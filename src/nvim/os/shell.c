@@ -651,12 +651,14 @@ static size_t write_output(char *output, size_t remaining, bool eof)
 
   char *start = output;
   size_t off = 0;
+  // Complete lines, inserted at once.
+  kvec_t(char_u *) lines = KV_INITIAL_VALUE;
+  kvec_t(colnr_T) lens = KV_INITIAL_VALUE;
   while (off < remaining) {
     if (output[off] == NL) {
-      // Insert the line
       output[off] = NUL;
-      ml_append(curwin->w_cursor.lnum++, (char_u *)output, (int)off + 1,
-                false);
+      kv_push(lines, (char_u *)output);
+      kv_push(lens, (colnr_T)off + 1);
       size_t skip = off + 1;
       output += skip;
       remaining -= skip;
@@ -671,6 +673,15 @@ static size_t write_output(char *output, size_t remaining, bool eof)
     off++;
   }
 
+  if (kv_size(lines) > 0) {
+    // Insert the lines
+    ml_append_lines(curwin->w_cursor.lnum, lines.items, lens.items,
+                    (linenr_T)kv_size(lines), false);
+    curwin->w_cursor.lnum += (linenr_T)kv_size(lines);
+  }
+  kv_destroy(lines);
+  kv_destroy(lens);
+
   if (eof) {
     if (remaining) {
       // append unfinished line
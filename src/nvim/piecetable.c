@@ -0,0 +1,697 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check
+// it. PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+// piecetable.c: line storage on top of a mapped file, for huge files.
+//
+// A buffer with 'bufstorage' set to "piecetable" does not copy the file it
+// edits into memline data blocks.  Instead the file is mapped read-only (the
+// "original") and only a sparse index of line starts is kept for it.  Lines
+// that are added or changed are appended to the "add" buffer, which only
+// ever grows.  The text of the buffer is a sequence of pieces, each a run of
+// consecutive lines of one of the two sources:
+//
+//   original:  l0 l1 l2 l3 l4 l5 ...        add:  a0 a1
+//   pieces:    [orig 0-2] [add 0-1] [orig 4-...]
+//
+// is the buffer "l0 l1 l2 a0 a1 l4 l5 ...", line l3 was changed or deleted.
+//
+// memline.c calls these functions instead of walking the block tree when
+// buf->b_ml.ml_pt is set, see ml_get_buf() and friends.  Line numbers passed
+// in are 1-based, like elsewhere; indexes into the sources are 0-based.
+//
+// Byte counts use the memline convention: every line counts its text plus one
+// byte for the line break, a CR that was removed for 'fileformat' "dos" is not
+// counted.
+//
+// The index of the original is built in steps, see pt_index_more().  Lines of
+// the original that have been indexed are added at the end of the text, the
+// lines after them don't exist yet.
+
+#include <assert.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "nvim/vim.h"
+#include "nvim/ascii.h"
+#include "nvim/memory.h"
+#include "nvim/piecetable.h"
+#include "nvim/lib/kvec.h"
+#include "nvim/os/os.h"
+
+/// Number of lines between two entries in the sparse index of the original.
+#define PT_MARK_STEP 64
+
+/// Entry in the sparse line index of the original.
+typedef struct {
+  size_t pm_off;        ///< byte offset of the line in the original
+  linenr_T pm_crs;      ///< number of lines before it that end in CR-NL
+} ptmark_T;
+
+/// A run of consecutive lines from one source.
+typedef struct {
+  linenr_T pc_start;    ///< index of the first line in its source
+  linenr_T pc_count;    ///< number of lines
+  long pc_bytes;        ///< number of bytes, memline convention
+  bool pc_add;          ///< lines are in the add buffer, not the original
+  bool pc_marked;       ///< line is marked for ":global", pc_count is 1
+} piece_T;
+
+struct piecetable {
+  char *pt_map;                 ///< file contents, see os_map_file()
+  size_t pt_map_size;           ///< size of "pt_map"
+  bool pt_mapped;               ///< "pt_map" is mapped, not allocated
+  FileID pt_file_id;            ///< file that "pt_map" came from
+  const char *pt_orig;          ///< original text: "pt_map" after a BOM
+  size_t pt_orig_len;           ///< number of bytes in "pt_orig"
+  size_t pt_orig_end;           ///< offset just after the last indexed line
+  linenr_T pt_orig_count;       ///< number of indexed lines in the original
+  linenr_T pt_orig_crs;         ///< indexed lines ending in CR-NL
+  bool pt_indexed;              ///< the whole original has been indexed
+  bool pt_dos;                  ///< remove a CR before a NL
+  kvec_t(ptmark_T) pt_marks;    ///< start of every PT_MARK_STEP'th line
+
+  kvec_t(char) pt_add;          ///< add buffer: NUL terminated lines
+  kvec_t(size_t) pt_add_lines;  ///< offset of each line in "pt_add"
+
+  kvec_t(piece_T) pt_pieces;    ///< the text, in order
+  kvec_t(linenr_T) pt_lnum;     ///< number of lines before each piece
+  kvec_t(long) pt_bytes;        ///< number of bytes before each piece
+  size_t pt_valid;              ///< "pt_lnum" and "pt_bytes" are valid up to
+                                ///< and including this index
+  size_t pt_last;               ///< piece found by the last lookup
+
+  char *pt_line;                ///< copy of a line of the original
+  size_t pt_line_size;          ///< allocated size of "pt_line"
+};
+
+#ifdef INCLUDE_GENERATED_DECLARATIONS
+# include "piecetable.c.generated.h"
+#endif
+
+/// Create a piece table for a file mapped with os_map_file().
+///
+/// The text is empty until pt_index_more() is called.
+///
+/// @param map  Contents of the file, owned by the piece table from now on.
+/// @param map_size  Size of "map".
+/// @param skip  Number of bytes to ignore at the start, for a BOM.  Must be
+///              less than "map_size".
+/// @param dos  Remove a CR before each NL, for 'fileformat' "dos".
+/// @param file_info  Information about the mapped file.
+piecetable_T *pt_new(char *map, size_t map_size, size_t skip, bool dos,
+                     const FileInfo *file_info)
+  FUNC_ATTR_NONNULL_ALL FUNC_ATTR_NONNULL_RET
+{
+  assert(skip < map_size);
+  piecetable_T *pt = xcalloc(1, sizeof(piecetable_T));
+  pt->pt_map = map;
+  pt->pt_map_size = map_size;
+  pt->pt_mapped = true;
+  os_fileinfo_id(file_info, &pt->pt_file_id);
+  pt->pt_orig = map + skip;
+  pt->pt_orig_len = map_size - skip;
+  pt->pt_dos = dos;
+  kv_push(pt->pt_lnum, 0);
+  kv_push(pt->pt_bytes, 0);
+  pt->pt_valid = 0;
+  return pt;
+}
+
+/// Free a piece table and release the mapped file.
+void pt_free(piecetable_T *pt)
+{
+  if (pt == NULL) {
+    return;
+  }
+  if (pt->pt_mapped) {
+    os_unmap_file(pt->pt_map, pt->pt_map_size);
+  } else {
+    xfree(pt->pt_map);
+  }
+  kv_destroy(pt->pt_marks);
+  kv_destroy(pt->pt_add);
+  kv_destroy(pt->pt_add_lines);
+  kv_destroy(pt->pt_pieces);
+  kv_destroy(pt->pt_lnum);
+  kv_destroy(pt->pt_bytes);
+  xfree(pt->pt_line);
+  xfree(pt);
+}
+
+/// Index more lines of the original and add them at the end of the text.
+///
+/// @param limit  Stop at the first line that starts "limit" bytes after where
+///               the previous call stopped.  At least one line is indexed.
+///
+/// @return  true when the whole original has been indexed.
+bool pt_index_more(piecetable_T *pt, size_t limit)
+  FUNC_ATTR_NONNULL_ALL
+{
+  if (pt->pt_indexed) {
+    return true;
+  }
+  const char *const orig = pt->pt_orig;
+  const size_t len = pt->pt_orig_len;
+  const linenr_T old_count = pt->pt_orig_count;
+  size_t off = pt->pt_orig_end;
+  const size_t stop = limit < len - off ? off + limit : len;
+  linenr_T count = old_count;
+  linenr_T crs = pt->pt_orig_crs;
+
+  while (off < len) {
+    if (count > old_count && off >= stop) {
+      break;
+    }
+    if (count % PT_MARK_STEP == 0) {
+      kv_push(pt->pt_marks, ((ptmark_T) { .pm_off = off, .pm_crs = crs }));
+    }
+    count++;
+    const char *nl = memchr(orig + off, NL, len - off);
+    if (nl == NULL) {
+      // Last line without a line break, it still counts one byte for it.
+      off = len + 1;
+      break;
+    }
+    if (pt->pt_dos && nl > orig + off && nl[-1] == CAR) {
+      crs++;
+    }
+    off = (size_t)(nl - orig) + 1;
+  }
+  pt->pt_orig_end = off;
+  pt->pt_orig_count = count;
+  pt->pt_orig_crs = crs;
+  pt->pt_indexed = (off >= len);
+  if (count > old_count) {
+    pt_add_orig(pt, old_count, count);
+  }
+  return pt->pt_indexed;
+}
+
+/// Check whether the whole original has been indexed.
+bool pt_index_done(const piecetable_T *pt)
+  FUNC_ATTR_NONNULL_ALL FUNC_ATTR_PURE
+{
+  return pt->pt_indexed;
+}
+
+/// Check whether the last line of the original has no line break.  Only
+/// valid when the whole original has been indexed.
+bool pt_no_eol(const piecetable_T *pt)
+  FUNC_ATTR_NONNULL_ALL FUNC_ATTR_PURE
+{
+  return pt->pt_orig_end > pt->pt_orig_len;
+}
+
+/// Stop using the mapping when it is of the file "file_id".
+///
+/// Must be called before the file is overwritten or truncated: the text would
+/// change below the buffer.  The original is copied into allocated memory.
+void pt_unshare(piecetable_T *pt, const FileID *file_id)
+  FUNC_ATTR_NONNULL_ALL
+{
+  if (pt->pt_mapped && os_fileid_equal(&pt->pt_file_id, file_id)) {
+    pt_copy_map(pt);
+  }
+}
+
+/// Stop using the mapping, because another program changed the file.
+///
+/// @param size  Size of the file now, UINT64_MAX when it was deleted.
+///
+/// @return  true when the text may be different from what was read: the file
+///          was truncated.
+bool pt_file_changed(piecetable_T *pt, uint64_t size)
+  FUNC_ATTR_NONNULL_ALL
+{
+  if (!pt->pt_mapped) {
+    return false;
+  }
+  // Pages after the new end of the file are read as NULs.
+  pt_copy_map(pt);
+  return size < pt->pt_map_size || os_map_file_damaged(pt->pt_map);
+}
+
+/// Replace the mapping by a copy in allocated memory.
+static void pt_copy_map(piecetable_T *pt)
+{
+  const size_t skip = (size_t)(pt->pt_orig - pt->pt_map);
+  char *copy = xmemdup(pt->pt_map, pt->pt_map_size);
+  os_unmap_file(pt->pt_map, pt->pt_map_size);
+  pt->pt_map = copy;
+  pt->pt_mapped = false;
+  pt->pt_orig = copy + skip;
+}
+
+/// Number of lines in the text of a piece table.
+linenr_T pt_line_count(piecetable_T *pt)
+  FUNC_ATTR_NONNULL_ALL
+{
+  pt_update(pt);
+  return kv_last(pt->pt_lnum);
+}
+
+/// Get line "lnum".
+///
+/// @return  NUL terminated text, valid until the next call to a pt_ function.
+char_u *pt_get_line(piecetable_T *pt, linenr_T lnum)
+  FUNC_ATTR_NONNULL_ALL FUNC_ATTR_NONNULL_RET
+{
+  linenr_T off;
+  const piece_T *p = &kv_A(pt->pt_pieces, pt_find(pt, lnum, &off));
+  if (p->pc_add) {
+    return (char_u *)pt->pt_add.items + pt_add_start(pt, p->pc_start + off);
+  }
+  return pt_orig_line(pt, p->pc_start + off);
+}
+
+/// Insert a line below line "lnum", which may be zero.
+///
+/// @param len  Length of "line", without the NUL.
+/// @param mark  Mark the line, like ml_setmarked().
+void pt_append_line(piecetable_T *pt, linenr_T lnum, const char_u *line,
+                    size_t len, bool mark)
+  FUNC_ATTR_NONNULL_ALL
+{
+  const linenr_T idx = pt_add_text(pt, line, len);
+  size_t i = 0;
+  if (lnum > 0) {
+    linenr_T off;
+    i = pt_find(pt, lnum, &off);
+    i = pt_split(pt, i, off + 1);
+  }
+
+  // Lines appended one after the other extend the same piece.
+  if (!mark && i > 0) {
+    piece_T *prev = &kv_A(pt->pt_pieces, i - 1);
+    if (prev->pc_add && !prev->pc_marked
+        && prev->pc_start + prev->pc_count == idx) {
+      prev->pc_count++;
+      prev->pc_bytes += (long)len + 1;
+      pt_invalidate(pt, i - 1);
+      return;
+    }
+  }
+  pt_insert_piece(pt, i, (piece_T) {
+    .pc_start = idx,
+    .pc_count = 1,
+    .pc_bytes = (long)len + 1,
+    .pc_add = true,
+    .pc_marked = mark,
+  });
+}
+
+/// Replace the text of line "lnum", keeping its mark.
+void pt_replace_line(piecetable_T *pt, linenr_T lnum, const char_u *line)
+  FUNC_ATTR_NONNULL_ALL
+{
+  const size_t len = STRLEN(line);
+  const linenr_T idx = pt_add_text(pt, line, len);
+  linenr_T off;
+  size_t i = pt_find(pt, lnum, &off);
+  i = pt_split(pt, i, off);
+  pt_split(pt, i, 1);
+
+  piece_T *p = &kv_A(pt->pt_pieces, i);
+  p->pc_start = idx;
+  p->pc_bytes = (long)len + 1;
+  p->pc_add = true;
+  pt_invalidate(pt, i);
+  if (i > 0) {
+    pt_merge(pt, i - 1);
+  }
+}
+
+/// Delete line "lnum".  The caller must not delete the last line.
+void pt_delete_line(piecetable_T *pt, linenr_T lnum)
+  FUNC_ATTR_NONNULL_ALL
+{
+  linenr_T off;
+  size_t i = pt_find(pt, lnum, &off);
+  i = pt_split(pt, i, off);
+
+  piece_T *p = &kv_A(pt->pt_pieces, i);
+  if (p->pc_count == 1) {
+    pt_remove_piece(pt, i);
+    if (i > 0) {
+      pt_merge(pt, i - 1);
+    }
+    return;
+  }
+  p->pc_bytes -= pt_piece_bytes(pt, p, 1);
+  p->pc_start++;
+  p->pc_count--;
+  pt_invalidate(pt, i);
+}
+
+/// Mark line "lnum" for ":global".
+void pt_set_mark(piecetable_T *pt, linenr_T lnum)
+  FUNC_ATTR_NONNULL_ALL
+{
+  linenr_T off;
+  size_t i = pt_find(pt, lnum, &off);
+  i = pt_split(pt, i, off);
+  pt_split(pt, i, 1);
+  kv_A(pt->pt_pieces, i).pc_marked = true;
+}
+
+/// Find the first marked line and clear its mark.
+///
+/// @return  line number or zero when there is no marked line.
+linenr_T pt_first_marked(piecetable_T *pt)
+  FUNC_ATTR_NONNULL_ALL
+{
+  pt_update(pt);
+  for (size_t i = 0; i < kv_size(pt->pt_pieces); i++) {
+    if (kv_A(pt->pt_pieces, i).pc_marked) {
+      const linenr_T lnum = kv_A(pt->pt_lnum, i) + 1;
+      kv_A(pt->pt_pieces, i).pc_marked = false;
+      pt_merge(pt, i);
+      if (i > 0) {
+        pt_merge(pt, i - 1);
+      }
+      return lnum;
+    }
+  }
+  return 0;
+}
+
+/// Clear the marks of all lines.
+void pt_clear_marks(piecetable_T *pt)
+  FUNC_ATTR_NONNULL_ALL
+{
+  for (size_t i = kv_size(pt->pt_pieces); i > 0; i--) {
+    if (kv_A(pt->pt_pieces, i - 1).pc_marked) {
+      kv_A(pt->pt_pieces, i - 1).pc_marked = false;
+      pt_merge(pt, i - 1);
+      if (i > 1) {
+        pt_merge(pt, i - 2);
+      }
+    }
+  }
+}
+
+/// Get the number of bytes before line "lnum".
+///
+/// @param lnum  Line number, may be one more than the number of lines to get
+///              the size of the whole text.
+long pt_line_offset(piecetable_T *pt, linenr_T lnum)
+  FUNC_ATTR_NONNULL_ALL
+{
+  pt_update(pt);
+  if (lnum > kv_last(pt->pt_lnum)) {
+    return kv_last(pt->pt_bytes);
+  }
+  linenr_T off;
+  const size_t i = pt_find(pt, lnum, &off);
+  return kv_A(pt->pt_bytes, i)
+         + pt_piece_bytes(pt, &kv_A(pt->pt_pieces, i), off);
+}
+
+/// Find the line that contains byte "*offp".
+///
+/// @param[in,out] offp  Byte offset in the text, zero-based.  Set to the
+///                      offset in the found line.
+/// @param ffdos  Count an extra byte for the line break of every line.
+///
+/// @return  line number or -1 when "*offp" is beyond the end of the text.
+linenr_T pt_find_offset(piecetable_T *pt, long *offp, int ffdos)
+  FUNC_ATTR_NONNULL_ALL
+{
+  pt_update(pt);
+  const long offset = *offp;
+  const size_t n = kv_size(pt->pt_pieces);
+  if (offset >= kv_A(pt->pt_bytes, n) + ffdos * kv_A(pt->pt_lnum, n)) {
+    return -1;
+  }
+
+  // Last piece that starts at or before "offset".
+  size_t lo = 0;
+  size_t hi = n - 1;
+  while (lo < hi) {
+    const size_t mid = (lo + hi + 1) / 2;
+    if (kv_A(pt->pt_bytes, mid) + ffdos * kv_A(pt->pt_lnum, mid) <= offset) {
+      lo = mid;
+    } else {
+      hi = mid - 1;
+    }
+  }
+  const piece_T *p = &kv_A(pt->pt_pieces, lo);
+  const long rest = offset - kv_A(pt->pt_bytes, lo)
+                    - ffdos * kv_A(pt->pt_lnum, lo);
+
+  // Last line in the piece that starts at or before "rest".
+  linenr_T klo = 0;
+  linenr_T khi = p->pc_count - 1;
+  while (klo < khi) {
+    const linenr_T mid = (klo + khi + 1) / 2;
+    if (pt_piece_bytes(pt, p, mid) + ffdos * mid <= rest) {
+      klo = mid;
+    } else {
+      khi = mid - 1;
+    }
+  }
+  *offp = rest - pt_piece_bytes(pt, p, klo) - ffdos * klo;
+  return kv_A(pt->pt_lnum, lo) + klo + 1;
+}
+
+/// Add lines "start" to "end" (exclusive) of the original at the end of the
+/// text.
+static void pt_add_orig(piecetable_T *pt, linenr_T start, linenr_T end)
+{
+  const long bytes = pt_orig_size(pt, end) - pt_orig_size(pt, start);
+  const size_t n = kv_size(pt->pt_pieces);
+  if (n > 0) {
+    piece_T *last = &kv_last(pt->pt_pieces);
+    if (!last->pc_add && !last->pc_marked
+        && last->pc_start + last->pc_count == start) {
+      last->pc_count += end - start;
+      last->pc_bytes += bytes;
+      pt_invalidate(pt, n - 1);
+      return;
+    }
+  }
+  pt_insert_piece(pt, n, (piece_T) {
+    .pc_start = start,
+    .pc_count = end - start,
+    .pc_bytes = bytes,
+    .pc_add = false,
+    .pc_marked = false,
+  });
+}
+
+/// Get the byte offset of line "idx" of the original.
+///
+/// @param idx  Index of the line, may be equal to the number of lines.
+/// @param[out] crsp  Number of lines before it that end in CR-NL.
+static size_t pt_orig_start(const piecetable_T *pt, linenr_T idx,
+                            linenr_T *crsp)
+{
+  if (idx >= pt->pt_orig_count) {
+    *crsp = pt->pt_orig_crs;
+    return pt->pt_orig_end;
+  }
+  const ptmark_T *m = &kv_A(pt->pt_marks, (size_t)(idx / PT_MARK_STEP));
+  size_t off = m->pm_off;
+  linenr_T crs = m->pm_crs;
+  for (linenr_T n = idx % PT_MARK_STEP; n > 0; n--) {
+    const char *nl = memchr(pt->pt_orig + off, NL, pt->pt_orig_len - off);
+    assert(nl != NULL);
+    if (pt->pt_dos && nl > pt->pt_orig + off && nl[-1] == CAR) {
+      crs++;
+    }
+    off = (size_t)(nl - pt->pt_orig) + 1;
+  }
+  *crsp = crs;
+  return off;
+}
+
+/// Number of bytes in the original before line "idx", memline convention.
+static long pt_orig_size(const piecetable_T *pt, linenr_T idx)
+{
+  linenr_T crs;
+  const size_t off = pt_orig_start(pt, idx, &crs);
+  return (long)off - (long)crs;
+}
+
+/// Copy line "idx" of the original to "pt_line".
+static char_u *pt_orig_line(piecetable_T *pt, linenr_T idx)
+{
+  linenr_T crs;
+  const size_t start = pt_orig_start(pt, idx, &crs);
+  const char *text = pt->pt_orig + start;
+  const char *nl = memchr(text, NL, pt->pt_orig_len - start);
+  size_t len = (nl == NULL ? pt->pt_orig_len - start : (size_t)(nl - text));
+  if (nl != NULL && pt->pt_dos && len > 0 && text[len - 1] == CAR) {
+    len--;
+  }
+
+  if (pt->pt_line_size < len + 1) {
+    pt->pt_line_size = MAX(len + 1, 2 * pt->pt_line_size);
+    pt->pt_line = xrealloc(pt->pt_line, pt->pt_line_size);
+  }
+  memcpy(pt->pt_line, text, len);
+  pt->pt_line[len] = NUL;
+  // NULs are replaced by newlines, like readfile() does.
+  for (char *p = memchr(pt->pt_line, NUL, len); p != NULL;
+       p = memchr(p, NUL, len - (size_t)(p - pt->pt_line))) {
+    *p++ = NL;
+  }
+  return (char_u *)pt->pt_line;
+}
+
+/// Get the offset of line "idx" of the add buffer.
+///
+/// @param idx  Index of the line, may be equal to the number of lines.
+static size_t pt_add_start(const piecetable_T *pt, linenr_T idx)
+{
+  return (size_t)idx < kv_size(pt->pt_add_lines)
+         ? kv_A(pt->pt_add_lines, idx)
+         : kv_size(pt->pt_add);
+}
+
+/// Append a line to the add buffer.
+///
+/// @return  index of the new line.
+static linenr_T pt_add_text(piecetable_T *pt, const char_u *line, size_t len)
+{
+  const size_t start = kv_size(pt->pt_add);
+  if (kv_max(pt->pt_add) < start + len + 1) {
+    kv_resize(pt->pt_add, MAX(start + len + 1, 2 * kv_max(pt->pt_add)));
+  }
+  memcpy(pt->pt_add.items + start, line, len);
+  pt->pt_add.items[start + len] = NUL;
+  pt->pt_add.size = start + len + 1;
+  kv_push(pt->pt_add_lines, start);
+  return (linenr_T)kv_size(pt->pt_add_lines) - 1;
+}
+
+/// Number of bytes in the first "count" lines of piece "p".
+static long pt_piece_bytes(const piecetable_T *pt, const piece_T *p,
+                           linenr_T count)
+{
+  if (count == 0) {
+    return 0;
+  } else if (count == p->pc_count) {
+    return p->pc_bytes;
+  } else if (p->pc_add) {
+    return (long)(pt_add_start(pt, p->pc_start + count)
+                  - pt_add_start(pt, p->pc_start));
+  }
+  return pt_orig_size(pt, p->pc_start + count)
+         - pt_orig_size(pt, p->pc_start);
+}
+
+/// Make the line and byte counts before each piece valid.
+static void pt_update(piecetable_T *pt)
+{
+  const size_t n = kv_size(pt->pt_pieces);
+  if (kv_max(pt->pt_lnum) < n + 1) {
+    const size_t size = MAX(n + 1, 2 * kv_max(pt->pt_lnum));
+    kv_resize(pt->pt_lnum, size);
+    kv_resize(pt->pt_bytes, size);
+  }
+  pt->pt_lnum.size = n + 1;
+  pt->pt_bytes.size = n + 1;
+  for (size_t i = pt->pt_valid; i < n; i++) {
+    const piece_T *p = &kv_A(pt->pt_pieces, i);
+    kv_A(pt->pt_lnum, i + 1) = kv_A(pt->pt_lnum, i) + p->pc_count;
+    kv_A(pt->pt_bytes, i + 1) = kv_A(pt->pt_bytes, i) + p->pc_bytes;
+  }
+  pt->pt_valid = n;
+}
+
+/// Piece "i" changed: the counts of the pieces after it are invalid.
+static inline void pt_invalidate(piecetable_T *pt, size_t i)
+{
+  pt->pt_valid = MIN(pt->pt_valid, i);
+}
+
+/// Find the piece containing line "lnum".
+///
+/// @param[out] offp  Index of the line in the piece.
+///
+/// @return  index of the piece.
+static size_t pt_find(piecetable_T *pt, linenr_T lnum, linenr_T *offp)
+{
+  pt_update(pt);
+  const size_t n = kv_size(pt->pt_pieces);
+  assert(lnum >= 1 && lnum <= kv_A(pt->pt_lnum, n));
+
+  // Lines are mostly accessed in sequence: try the last piece first.
+  size_t i = pt->pt_last;
+  if (i >= n || lnum <= kv_A(pt->pt_lnum, i)
+      || lnum > kv_A(pt->pt_lnum, i + 1)) {
+    size_t lo = 0;
+    size_t hi = n - 1;
+    while (lo < hi) {
+      const size_t mid = (lo + hi + 1) / 2;
+      if (kv_A(pt->pt_lnum, mid) < lnum) {
+        lo = mid;
+      } else {
+        hi = mid - 1;
+      }
+    }
+    i = lo;
+    pt->pt_last = i;
+  }
+  *offp = lnum - kv_A(pt->pt_lnum, i) - 1;
+  return i;
+}
+
+/// Split piece "i" before its line "off".
+///
+/// @return  index of the piece that starts with that line.
+static size_t pt_split(piecetable_T *pt, size_t i, linenr_T off)
+{
+  piece_T *p = &kv_A(pt->pt_pieces, i);
+  if (off == 0) {
+    return i;
+  } else if (off >= p->pc_count) {
+    return i + 1;
+  }
+  const long bytes = pt_piece_bytes(pt, p, off);
+  piece_T right = *p;
+  right.pc_start += off;
+  right.pc_count -= off;
+  right.pc_bytes -= bytes;
+  p->pc_count = off;
+  p->pc_bytes = bytes;
+  pt_insert_piece(pt, i + 1, right);
+  return i + 1;
+}
+
+/// Join piece "i" with the next one when they are consecutive lines of the
+/// same source.
+static void pt_merge(piecetable_T *pt, size_t i)
+{
+  if (i + 1 >= kv_size(pt->pt_pieces)) {
+    return;
+  }
+  piece_T *p = &kv_A(pt->pt_pieces, i);
+  const piece_T *next = &kv_A(pt->pt_pieces, i + 1);
+  if (p->pc_add != next->pc_add || p->pc_marked || next->pc_marked
+      || p->pc_start + p->pc_count != next->pc_start) {
+    return;
+  }
+  p->pc_count += next->pc_count;
+  p->pc_bytes += next->pc_bytes;
+  pt_remove_piece(pt, i + 1);
+}
+
+static void pt_insert_piece(piecetable_T *pt, size_t i, piece_T p)
+{
+  (void)kv_pushp(pt->pt_pieces);
+  memmove(&kv_A(pt->pt_pieces, i + 1), &kv_A(pt->pt_pieces, i),
+          (kv_size(pt->pt_pieces) - i - 1) * sizeof(piece_T));
+  kv_A(pt->pt_pieces, i) = p;
+  pt_invalidate(pt, i);
+}
+
+static void pt_remove_piece(piecetable_T *pt, size_t i)
+{
+  memmove(&kv_A(pt->pt_pieces, i), &kv_A(pt->pt_pieces, i + 1),
+          (kv_size(pt->pt_pieces) - i - 1) * sizeof(piece_T));
+  kv_drop(pt->pt_pieces, 1);
+  pt_invalidate(pt, i);
+}
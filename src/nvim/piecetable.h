@@ -0,0 +1,18 @@
+#ifndef NVIM_PIECETABLE_H
+#define NVIM_PIECETABLE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "nvim/types.h"
+#include "nvim/pos.h"
+#include "nvim/piecetable_defs.h"
+#include "nvim/os/fs_defs.h"
+
+/// Number of bytes of a file indexed at a time, see pt_index_more().
+#define PT_INDEX_STEP (8 * 1024 * 1024)
+
+#ifdef INCLUDE_GENERATED_DECLARATIONS
+# include "piecetable.h.generated.h"
+#endif
+#endif  // NVIM_PIECETABLE_H
@@ -0,0 +1,10 @@
+#ifndef NVIM_PIECETABLE_DEFS_H
+#define NVIM_PIECETABLE_DEFS_H
+
+/// Line storage of a buffer with 'bufstorage' set to "piecetable".
+///
+/// The text is a mapped file plus an append-only buffer of added and changed
+/// lines, see piecetable.c.  The structure is private to piecetable.c.
+typedef struct piecetable piecetable_T;
+
+#endif  // NVIM_PIECETABLE_DEFS_H
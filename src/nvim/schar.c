@@ -0,0 +1,175 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check
+// it. PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+// schar.c: the text of a screen cell as a 32-bit value.
+//
+// A text of up to four bytes, which is any single character, is stored in the
+// schar_T itself, in the byte order of the string.  A longer text, a character
+// with composing characters, is stored once in the glyph table and the schar_T
+// holds the byte 0xFF, which is never used in UTF-8, followed by the 24-bit
+// index of the text in the table.  An illegal byte 0xFF is stored in the table
+// as well.  The same text always gives the same schar_T,
+// thus cells can be compared as integers.  The empty text, used for the right
+// half of a double-width character, is 0.
+//
+// The table is only added to, by the main thread.  It is kept in blocks that
+// are never moved, so that the TUI thread can get the text of a cell it
+// received through the UI bridge.  When the table is full a new text is shown
+// as its first character only.
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "nvim/vim.h"
+#include "nvim/ascii.h"
+#include "nvim/map.h"
+#include "nvim/mbyte.h"
+#include "nvim/memory.h"
+#include "nvim/schar.h"
+
+#define GLYPH_BLOCK_SIZE 0x10000
+#define GLYPH_BLOCKS 0x100  // index of 24 bits
+
+/// Blocks of NUL-terminated texts, allocated when needed.
+static char *glyph_blocks[GLYPH_BLOCKS];
+/// Index in the table for the next text.
+static size_t glyph_next = 0;
+/// Texts in the table and their schar_T.
+static Map(cstr_t, ptr_t) *glyph_map = NULL;
+
+#ifdef INCLUDE_GENERATED_DECLARATIONS
+# include "schar.c.generated.h"
+#endif
+
+/// Get the schar_T for the text "buf[len]", which must not contain a NUL.
+schar_T schar_from_buf(const char *buf, size_t len)
+  FUNC_ATTR_NONNULL_ALL
+{
+  assert(len < MAX_SCHAR_SIZE);
+  if (len <= sizeof(schar_T) && (uint8_t)buf[0] != 0xFF) {
+    schar_T sc = 0;
+    memcpy(&sc, buf, len);
+    return sc;
+  }
+
+  char text[MAX_SCHAR_SIZE];
+  memcpy(text, buf, len);
+  text[len] = NUL;
+  if (glyph_map == NULL) {
+    glyph_map = pmap_new(cstr_t)();
+  }
+  uintptr_t found = (uintptr_t)pmap_get(cstr_t)(glyph_map, text);
+  if (found != 0) {
+    return (schar_T)found;
+  }
+
+  size_t idx = glyph_next;
+  if (idx % GLYPH_BLOCK_SIZE + len + 1 > GLYPH_BLOCK_SIZE) {
+    idx += GLYPH_BLOCK_SIZE - idx % GLYPH_BLOCK_SIZE;
+  }
+  if (idx / GLYPH_BLOCK_SIZE >= GLYPH_BLOCKS) {
+    size_t clen = (size_t)utf_ptr2len((char_u *)text);
+    if (clen > sizeof(schar_T) || (uint8_t)text[0] == 0xFF) {
+      return schar_from_ascii('?');
+    }
+    return schar_from_buf(text, clen);
+  }
+  char **block = &glyph_blocks[idx / GLYPH_BLOCK_SIZE];
+  if (*block == NULL) {
+    *block = xmalloc(GLYPH_BLOCK_SIZE);
+  }
+  char *p = *block + idx % GLYPH_BLOCK_SIZE;
+  memcpy(p, text, len + 1);
+  glyph_next = idx + len + 1;
+
+  const uint8_t bytes[4] = { 0xFF, (uint8_t)(idx >> 16), (uint8_t)(idx >> 8),
+                             (uint8_t)idx };
+  schar_T sc;
+  memcpy(&sc, bytes, sizeof(sc));
+  pmap_put(cstr_t)(glyph_map, p, (ptr_t)(uintptr_t)sc);
+  return sc;
+}
+
+/// Get the schar_T for the NUL-terminated text "str".
+schar_T schar_from_str(const char *str)
+  FUNC_ATTR_NONNULL_ALL
+{
+  return schar_from_buf(str, strlen(str));
+}
+
+/// Get the schar_T for an ASCII character.
+schar_T schar_from_ascii(char c)
+{
+  return schar_from_buf(&c, 1);
+}
+
+/// Get the schar_T for a unicode character.
+schar_T schar_from_char(int c)
+{
+  char buf[MB_MAXBYTES + 1];
+  int len = utf_char2bytes(c, (char_u *)buf);
+  return schar_from_buf(buf, (size_t)len);
+}
+
+/// Get the schar_T for a unicode char and up to MAX_MCO composing chars.
+schar_T schar_from_cc(int c, int u8cc[MAX_MCO])
+{
+  char buf[MAX_SCHAR_SIZE];
+  int len = utf_char2bytes(c, (char_u *)buf);
+  for (int i = 0; i < MAX_MCO; i++) {
+    if (u8cc[i] == 0) {
+      break;
+    }
+    len += utf_char2bytes(u8cc[i], (char_u *)buf + len);
+  }
+  return schar_from_buf(buf, (size_t)len);
+}
+
+/// Get the text of a cell into "buf", which must be MAX_SCHAR_SIZE bytes.
+///
+/// @return  The length of the text.
+size_t schar_get(char *buf, schar_T sc)
+  FUNC_ATTR_NONNULL_ALL
+{
+  uint8_t bytes[4];
+  memcpy(bytes, &sc, sizeof(sc));
+  if (bytes[0] == 0xFF) {
+    size_t idx = ((size_t)bytes[1] << 16) | ((size_t)bytes[2] << 8) | bytes[3];
+    const char *text = glyph_blocks[idx / GLYPH_BLOCK_SIZE]
+                       + idx % GLYPH_BLOCK_SIZE;
+    size_t len = strlen(text);
+    memcpy(buf, text, len + 1);
+    return len;
+  }
+  size_t len = 0;
+  while (len < sizeof(sc) && bytes[len] != NUL) {
+    buf[len] = (char)bytes[len];
+    len++;
+  }
+  buf[len] = NUL;
+  return len;
+}
+
+/// Check if a cell holds a single byte: an ASCII character, or an illegal
+/// byte.
+bool schar_is_single_byte(schar_T sc)
+{
+  uint8_t bytes[4];
+  memcpy(bytes, &sc, sizeof(sc));
+  return bytes[0] != NUL && bytes[0] != 0xFF && bytes[1] == NUL;
+}
+
+/// Free the glyph table.
+void schar_free_all(void)
+{
+  for (size_t i = 0; i < GLYPH_BLOCKS; i++) {
+    XFREE_CLEAR(glyph_blocks[i]);
+  }
+  if (glyph_map != NULL) {
+    pmap_free(cstr_t)(glyph_map);
+    glyph_map = NULL;
+  }
+  glyph_next = 0;
+}
@@ -0,0 +1,20 @@
+#ifndef NVIM_SCHAR_H
+#define NVIM_SCHAR_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "auto/config.h"
+#include "nvim/grid_defs.h"
+
+/// The schar_T of a space, which cleared cells contain.
+#ifdef ORDER_BIG_ENDIAN
+# define SCHAR_SPACE ((schar_T)' ' << 24)
+#else
+# define SCHAR_SPACE ((schar_T)' ')
+#endif
+
+#ifdef INCLUDE_GENERATED_DECLARATIONS
+# include "schar.h.generated.h"
+#endif
+#endif  // NVIM_SCHAR_H
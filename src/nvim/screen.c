@@ -58,6 +58,13 @@
 // Things that are handled indirectly:
 // - When messages scroll the screen up, msg_scrolled will be set and
 //   update_screen() called to redraw.
+//
+// All windows are drawn on the main thread, one after the other.  win_line()
+// cannot run for several windows at the same time: it uses the syntax, spell,
+// 'hlsearch' and match state, the line buffers that are put on the grid and
+// the memline, where getting one line may free the line gotten before.
+// Redrawing is kept cheap instead by not drawing what did not change, see
+// win_linecache_put(), stl_cache_get() and vcol_index_skip().
 ///
 
 #include <assert.h>
@@ -69,6 +76,7 @@
 #include "nvim/vim.h"
 #include "nvim/ascii.h"
 #include "nvim/arabic.h"
+#include "nvim/lib/kvec.h"
 #include "nvim/screen.h"
 #include "nvim/buffer.h"
 #include "nvim/charset.h"
@@ -90,6 +98,7 @@
 #include "nvim/mbyte.h"
 #include "nvim/memline.h"
 #include "nvim/memory.h"
+#include "nvim/memscan.h"
 #include "nvim/menu.h"
 #include "nvim/message.h"
 #include "nvim/misc1.h"
@@ -102,6 +111,7 @@
 #include "nvim/popupmnu.h"
 #include "nvim/quickfix.h"
 #include "nvim/regexp.h"
+#include "nvim/schar.h"
 #include "nvim/search.h"
 #include "nvim/sign.h"
 #include "nvim/spell.h"
@@ -115,6 +125,10 @@
 #include "nvim/version.h"
 #include "nvim/window.h"
 #include "nvim/os/time.h"
+#include "nvim/os/input.h"
+#include "nvim/event/time.h"
+#include "nvim/event/multiqueue.h"
+#include "nvim/api/private/handle.h"
 #include "nvim/api/private/helpers.h"
 
 #define MB_FILLER_CHAR '<'  /* character used when a double-width character
@@ -130,6 +144,8 @@ static schar_T *linebuf_char = NULL;
 static sattr_T *linebuf_attr = NULL;
 
 static match_T search_hl;       /* used for 'hlsearch' highlight matching */
+static search_hl_cache_T *search_hl_cache = NULL;  // matches of search_hl
+                                                   // in the window drawn
 
 static foldinfo_T win_foldinfo; /* info for 'foldcolumn' */
 
@@ -155,11 +171,68 @@ static bool redraw_popupmenu = false;
 
 static bool resizing = false;
 
+/// What a status line depends on, compared as a whole.
+typedef struct {
+  uint64_t state_tick;
+  varnumber_T changedtick;
+  handle_T buf;
+  handle_T curbuf;
+  int changed;
+  bool is_curwin;
+  bool visual_active;
+  int visual_mode;
+  int reg_recording;
+  int maxwidth;
+  int fillchar;
+  int state;
+  pos_T cursor;
+  linenr_T topline;
+  linenr_T botline;
+  uint64_t tabs;        // tab pages and their windows, for the tabline
+} StlKey;
+
+struct stl_cache {
+  char_u *fmt;                  // format it was built from
+  StlKey key;
+  int deps;                     // STL_DEP_ flags
+  int width;
+  char_u *out;                  // the built status line
+  struct stl_hlrec *hltab;      // highlight records, pointing into "out"
+  StlClickRecord *tabtab;       // click records, pointing into "out"
+};
+
+// Number of lines in the cache of 'hlsearch' matches of a window.
+#define SEARCH_HL_CACHE_SIZE 256
+
+/// Matches of the 'hlsearch' pattern in a line, as found by searching from
+/// the start of the line: start and end column of each.
+typedef struct {
+  linenr_T lnum;                // buffer line, zero when not used
+  bool done;                    // all matches in the line were found
+  kvec_t(colnr_T) cols;
+} SearchHLLine;
+
+struct search_hl_cache {
+  handle_T buf;
+  varnumber_T changedtick;
+  char_u *pat;                  // the pattern, NULL when not used
+  int ic;                       // 'ignorecase' and 'smartcase'
+  int magic;                    // 'magic'
+  linenr_T timeout_lnum;        // where searching last timed out
+  colnr_T timeout_col;
+  bool redraw_pending;          // search_hl_continue_event() was scheduled
+  bool progress;                // a line was searched in this redraw
+  SearchHLLine lines[SEARCH_HL_CACHE_SIZE];
+};
+
 #ifdef INCLUDE_GENERATED_DECLARATIONS
 # include "screen.c.generated.h"
 #endif
 #define SEARCH_HL_PRIORITY 0
 
+// Number of lines in the cache of drawn lines of a window.
+#define LINECACHE_SIZE 256
+
 /*
  * Redraw the current window later, with update_screen(type).
  * Set must_redraw only if not already set to a higher value.
@@ -172,6 +245,9 @@ void redraw_later(int type)
 
 void redraw_win_later(win_T *wp, int type)
 {
+  if (type >= SOME_VALID) {
+    win_linecache_clear(wp, 0, 0);
+  }
   if (!exiting && wp->w_redr_type < type) {
     wp->w_redr_type = type;
     if (type >= NOT_VALID)
@@ -223,9 +299,12 @@ void redraw_buf_later(buf_T *buf, int type)
 void redraw_buf_line_later(buf_T *buf,  linenr_T line)
 {
   FOR_ALL_WINDOWS_IN_TAB(wp, curtab) {
-    if (wp->w_buffer == buf
-        && line >= wp->w_topline && line < wp->w_botline) {
-      redrawWinline(wp, line);
+    if (wp->w_buffer == buf) {
+      // Also when the line is not displayed now.
+      win_linecache_clear(wp, line, line + 1);
+      if (line >= wp->w_topline && line < wp->w_botline) {
+        redrawWinline(wp, line);
+      }
     }
   }
 }
@@ -244,6 +323,7 @@ redrawWinline(
     linenr_T lnum
 )
 {
+  win_linecache_clear(wp, lnum, lnum + 1);
   if (lnum >= wp->w_topline
       && lnum < wp->w_botline) {
     if (wp->w_redraw_top == 0 || wp->w_redraw_top > lnum) {
@@ -265,6 +345,70 @@ void update_curbuf(int type)
   update_screen(type);
 }
 
+// Frame pacing for 'redrawrate'.
+static uint64_t frame_start = 0;     // when the last screen update started
+static uint64_t frame_deferred = 0;  // when an update was first postponed
+static TimeWatcher frame_timer;
+static bool frame_timer_pending = false;
+
+void screen_frame_init(void)
+{
+  time_watcher_init(&main_loop, &frame_timer, NULL);
+  // frame_timer_cb only wakes up the main loop, which does the redraw
+  frame_timer.events = multiqueue_new_child(main_loop.events);
+}
+
+void screen_frame_teardown(void)
+{
+  time_watcher_stop(&frame_timer);
+  multiqueue_free(frame_timer.events);
+  time_watcher_close(&frame_timer, NULL);
+}
+
+static void frame_timer_cb(TimeWatcher *watcher, void *data)
+{
+  frame_timer_pending = false;
+}
+
+/// Check if a screen update from the main loop should wait for the next
+/// frame, so that the changes made until then are drawn together.
+///
+/// With 'redrawrate' set an update waits until a frame after the previous
+/// one.  It also waits while events or typed keys are pending, but not more
+/// than one frame.  A timer triggers the update when it is due.
+///
+/// @return true when the update must be skipped for now.
+bool update_screen_defer(void)
+{
+  if (p_rdr <= 0 || must_redraw == 0 || !default_grid.chars) {
+    frame_deferred = 0;
+    return false;
+  }
+
+  const uint64_t now = os_hrtime();
+  const uint64_t interval = 1000000000 / (uint64_t)p_rdr;
+  if (frame_deferred == 0) {
+    frame_deferred = now;
+  }
+  if ((!multiqueue_empty(main_loop.events) || input_available())
+      && now - frame_deferred < interval) {
+    // The main loop comes back here after handling what is pending.
+    g_stats.redraw_deferred++;
+    return true;
+  }
+  if (now >= frame_start + interval) {
+    frame_deferred = 0;
+    return false;
+  }
+  if (!frame_timer_pending) {
+    frame_timer_pending = true;
+    time_watcher_start(&frame_timer, frame_timer_cb,
+                       (frame_start + interval - now + 999999) / 1000000, 0);
+  }
+  g_stats.redraw_deferred++;
+  return true;
+}
+
 /// Redraw the parts of the screen that is marked for redraw.
 ///
 /// Most code shouldn't call this directly, rather use redraw_later() and
@@ -312,6 +456,7 @@ int update_screen(int type)
   updating_screen = TRUE;
   ++display_tick;           /* let syntax code know we're in a next round of
                              * display updating */
+  frame_start = os_hrtime();
 
   // Tricky: vim code can reset msg_scrolled behind our back, so need
   // separate bookkeeping for now.
@@ -446,6 +591,9 @@ int update_screen(int type)
     if (wp->w_buffer->b_mod_set) {
       win_T       *wwp;
 
+      win_linecache_clear(wp, wp->w_buffer->b_mod_top,
+                          wp->w_buffer->b_mod_bot);
+
       // Check if we already did this buffer.
       for (wwp = firstwin; wwp != wp; wwp = wwp->w_next) {
         if (wwp->w_buffer == wp->w_buffer) {
@@ -465,24 +613,11 @@ int update_screen(int type)
   did_one = FALSE;
   search_hl.rm.regprog = NULL;
 
-
+  // The cursor window goes first, it is where the user is looking.
+  update_screen_win(curwin, &did_one);
   FOR_ALL_WINDOWS_IN_TAB(wp, curtab) {
-    if (wp->w_redr_type == CLEAR && wp->w_floating && wp->w_grid.chars) {
-      grid_invalidate(&wp->w_grid);
-      wp->w_redr_type = NOT_VALID;
-    }
-
-    if (wp->w_redr_type != 0) {
-      if (!did_one) {
-        did_one = TRUE;
-        start_search_hl();
-      }
-      win_update(wp);
-    }
-
-    /* redraw status line after the window to minimize cursor movement */
-    if (wp->w_redr_status) {
-      win_redr_status(wp);
+    if (wp != curwin) {
+      update_screen_win(wp, &did_one);
     }
   }
 
@@ -516,9 +651,38 @@ int update_screen(int type)
 
   // either cmdline is cleared, not drawn or mode is last drawn
   cmdline_was_last_drawn = false;
+
+  const int64_t frame_time = (int64_t)(os_hrtime() - frame_start) / 1000;
+  g_stats.redraw++;
+  g_stats.redraw_time = frame_time;
+  if (frame_time > g_stats.redraw_time_max) {
+    g_stats.redraw_time_max = frame_time;
+  }
   return OK;
 }
 
+/// Redraw window "wp" and its status line if needed, for update_screen().
+static void update_screen_win(win_T *wp, int *did_one)
+{
+  if (wp->w_redr_type == CLEAR && wp->w_floating && wp->w_grid.chars) {
+    grid_invalidate(&wp->w_grid);
+    wp->w_redr_type = NOT_VALID;
+  }
+
+  if (wp->w_redr_type != 0) {
+    if (!*did_one) {
+      *did_one = TRUE;
+      start_search_hl();
+    }
+    win_update(wp);
+  }
+
+  /* redraw status line after the window to minimize cursor movement */
+  if (wp->w_redr_status) {
+    win_redr_status(wp);
+  }
+}
+
 /*
  * Return TRUE if the cursor line in window "wp" may be concealed, according
  * to the 'concealcursor' option.
@@ -786,6 +950,9 @@ static void win_update(win_T *wp)
   }
   wp->w_redraw_top = 0;  // reset for next time
   wp->w_redraw_bot = 0;
+  if (type >= SOME_VALID) {
+    win_linecache_clear(wp, 0, 0);
+  }
 
   /*
    * When only displaying the lines at the top, set top_end.  Used when
@@ -1365,6 +1532,11 @@ static void win_update(win_T *wp)
         /* This line is not going to fit.  Don't draw anything here,
          * will draw "@  " lines below. */
         row = wp->w_grid.Rows + 1;
+      } else if (win_linecache_put(wp, lnum, srow)) {
+        row = srow + 1;
+        wp->w_lines[idx].wl_folded = false;
+        wp->w_lines[idx].wl_lastlnum = lnum;
+        did_update = DID_NONE;
       } else {
         prepare_search_hl(wp, lnum);
         /* Let the syntax stuff know we skipped a few lines. */
@@ -1376,6 +1548,10 @@ static void win_update(win_T *wp)
          * Display one line.
          */
         row = win_line(wp, lnum, srow, wp->w_grid.Rows, mod_top == 0, false);
+        // When the line ends on the last row it might have been cut off.
+        if (row == srow + 1 && row < wp->w_grid.Rows) {
+          win_linecache_store(wp, lnum, srow);
+        }
 
         wp->w_lines[idx].wl_folded = FALSE;
         wp->w_lines[idx].wl_lastlnum = lnum;
@@ -1548,6 +1724,110 @@ static void win_update(win_T *wp)
     got_int = save_got_int;
 }
 
+// Lines drawn by win_line() are kept per window, so that a line that is shown
+// again, after scrolling back or when the window is redrawn, is copied to the
+// grid instead of drawn again.  An entry is used when the text of the buffer
+// did not change (b:changedtick) and the window was not redrawn with
+// SOME_VALID or more since then, which is done when options, highlighting or
+// matches change.  Signs and highlights added to a line remove its entry.
+// Lines that look different depending on the cursor are not cached.
+
+/// Check if line "lnum" of window "wp" can be drawn from the cache.
+static bool win_linecache_usable(win_T *wp, linenr_T lnum)
+{
+  return !wp->w_p_rnu && !wp->w_p_cuc && !wp->w_p_diff
+         && wp->w_buffer->terminal == NULL
+         && lnum != wp->w_cursor.lnum
+         && !(VIsual_active && wp->w_buffer == curbuf)
+         && !(lnum == wp->w_topline
+              && (wp->w_skipcol != 0 || wp->w_topfill != 0))
+         && dollar_vcol == -1;
+}
+
+/// Put line "lnum" of window "wp" on row "row" from the cache.
+///
+/// @return  false when the cache does not have the line.
+static bool win_linecache_put(win_T *wp, linenr_T lnum, int row)
+{
+  if (wp->w_linecache == NULL || wp->w_linecache_buf != wp->w_buffer->handle
+      || !win_linecache_usable(wp, lnum)) {
+    return false;
+  }
+  linecache_entry_T *e = &wp->w_linecache[lnum % LINECACHE_SIZE];
+  if (e->lce_lnum != lnum
+      || e->lce_changedtick != buf_get_changedtick(wp->w_buffer)
+      || e->lce_leftcol != wp->w_leftcol
+      || e->lce_width != wp->w_grid.Columns) {
+    return false;
+  }
+  memcpy(linebuf_char, e->lce_chars, (size_t)e->lce_width * sizeof(schar_T));
+  memcpy(linebuf_attr, e->lce_attrs, (size_t)e->lce_width * sizeof(sattr_T));
+  grid_put_linebuf(&wp->w_grid, row, 0, e->lce_width, e->lce_width, false, wp,
+                   0, false);
+  return true;
+}
+
+/// Remember line "lnum" of window "wp", which win_line() drew on row "row".
+static void win_linecache_store(win_T *wp, linenr_T lnum, int row)
+{
+  if (!win_linecache_usable(wp, lnum)) {
+    return;
+  }
+  if (wp->w_linecache == NULL) {
+    wp->w_linecache = xcalloc(LINECACHE_SIZE, sizeof(linecache_entry_T));
+  } else if (wp->w_linecache_buf != wp->w_buffer->handle) {
+    win_linecache_clear(wp, 0, 0);
+  }
+  wp->w_linecache_buf = wp->w_buffer->handle;
+
+  linecache_entry_T *e = &wp->w_linecache[lnum % LINECACHE_SIZE];
+  const int width = wp->w_grid.Columns;
+  if (e->lce_width != width) {
+    xfree(e->lce_chars);
+    xfree(e->lce_attrs);
+    e->lce_chars = xmalloc((size_t)width * sizeof(schar_T));
+    e->lce_attrs = xmalloc((size_t)width * sizeof(sattr_T));
+    e->lce_width = width;
+  }
+  ScreenGrid *grid = &wp->w_grid;
+  int col = 0;
+  screen_adjust_grid(&grid, &row, &col);
+  size_t off = grid->line_offset[row] + (size_t)col;
+  memcpy(e->lce_chars, grid->chars + off, (size_t)width * sizeof(schar_T));
+  memcpy(e->lce_attrs, grid->attrs + off, (size_t)width * sizeof(sattr_T));
+  e->lce_lnum = lnum;
+  e->lce_changedtick = buf_get_changedtick(wp->w_buffer);
+  e->lce_leftcol = wp->w_leftcol;
+}
+
+/// Forget the drawn lines "lnum" to "lnume" (exclusive) of window "wp", all
+/// lines when "lnum" is zero.
+void win_linecache_clear(win_T *wp, linenr_T lnum, linenr_T lnume)
+{
+  if (wp->w_linecache == NULL) {
+    return;
+  }
+  for (size_t i = 0; i < LINECACHE_SIZE; i++) {
+    linecache_entry_T *e = &wp->w_linecache[i];
+    if (lnum == 0 || (e->lce_lnum >= lnum && e->lce_lnum < lnume)) {
+      e->lce_lnum = 0;
+    }
+  }
+}
+
+/// Free the drawn lines of window "wp".
+void win_linecache_free(win_T *wp)
+{
+  if (wp->w_linecache == NULL) {
+    return;
+  }
+  for (size_t i = 0; i < LINECACHE_SIZE; i++) {
+    xfree(wp->w_linecache[i].lce_chars);
+    xfree(wp->w_linecache[i].lce_attrs);
+  }
+  XFREE_CLEAR(wp->w_linecache);
+}
+
 /// Returns width of the signcolumn that should be used for the whole window
 ///
 /// @param wp window we want signcolumn width from
@@ -1666,7 +1946,7 @@ static int line_putchar(LineState *s, schar_T *dest, int maxcells, bool rl)
   }
   u8c = utfc_ptr2char(p, u8cc);
   if (*p < 0x80 && u8cc[0] == 0) {
-    schar_from_ascii(dest[0], *p);
+    dest[0] = schar_from_ascii(*p);
     s->prev_c = u8c;
   } else {
     if (p_arshape && !p_tbidi && arabic_char(u8c)) {
@@ -1693,10 +1973,10 @@ static int line_putchar(LineState *s, schar_T *dest, int maxcells, bool rl)
     } else {
       s->prev_c = u8c;
     }
-    schar_from_cc(dest[0], u8c, u8cc);
+    dest[0] = schar_from_cc(u8c, u8cc);
   }
   if (cells > 1) {
-    dest[1][0] = 0;
+    dest[1] = 0;
   }
   s->p += c_len;
   return cells;
@@ -1733,7 +2013,7 @@ static void fold_line(win_T *wp, long fold_count, foldinfo_T *foldinfo, linenr_T
    * Ignores 'rightleft', this window is never right-left.
    */
   if (cmdwin_type != 0 && wp == curwin) {
-    schar_from_ascii(linebuf_char[off], cmdwin_type);
+    linebuf_char[off] = schar_from_ascii(cmdwin_type);
     linebuf_attr[off] = win_hl_attr(wp, HLF_AT);
     col++;
   }
@@ -1750,8 +2030,8 @@ static void fold_line(win_T *wp, long fold_count, foldinfo_T *foldinfo, linenr_T
                      win_hl_attr(wp, HLF_FC));
       // reverse the fold column
       for (i = 0; i < fdc; i++) {
-        schar_from_ascii(linebuf_char[off + wp->w_grid.Columns - i - 1 - col],
-                         buf[i]);
+        linebuf_char[off + wp->w_grid.Columns - i - 1 - col] =
+          schar_from_ascii(buf[i]);
       }
     } else {
       copy_text_attr(off + col, buf, fdc, win_hl_attr(wp, HLF_FC));
@@ -1869,12 +2149,11 @@ static void fold_line(win_T *wp, long fold_count, foldinfo_T *foldinfo, linenr_T
   if (wp->w_p_rl)
     col -= txtcol;
 
-  schar_T sc;
-  schar_from_char(sc, wp->w_p_fcs_chars.fold);
+  schar_T sc = schar_from_char(wp->w_p_fcs_chars.fold);
   while (col < wp->w_grid.Columns
          - (wp->w_p_rl ? txtcol : 0)
          ) {
-    schar_copy(linebuf_char[off+col++], sc);
+    linebuf_char[off+col++] = sc;
   }
 
   if (text != buf)
@@ -1987,7 +2266,7 @@ static void copy_text_attr(int off, char_u *buf, int len, int attr)
   int i;
 
   for (i = 0; i < len; i++) {
-    schar_from_ascii(linebuf_char[off + i], buf[i]);
+    linebuf_char[off + i] = schar_from_ascii(buf[i]);
     linebuf_attr[off + i] = attr;
   }
 }
@@ -2485,6 +2764,10 @@ win_line (
   else
     v = wp->w_leftcol;
   if (v > 0 && !number_only) {
+    // In a long line start at the checkpoint before "v".
+    colnr_T skip_vcol;
+    ptr = vcol_index_skip(wp, lnum, line, (colnr_T)v, &skip_vcol);
+    vcol = skip_vcol;
     char_u  *prev_ptr = ptr;
     while (vcol < v && *ptr != NUL) {
       c = win_lbr_chartabsize(wp, line, ptr, (colnr_T)vcol, NULL);
@@ -3826,7 +4109,7 @@ win_line (
           col += n;
         } else {
           // Add a blank character to highlight.
-          schar_from_ascii(linebuf_char[off], ' ');
+          linebuf_char[off] = SCHAR_SPACE;
         }
         if (area_attr == 0) {
           /* Use attributes from match with highest priority among
@@ -3959,7 +4242,7 @@ win_line (
           delay_virttext = false;
 
           if (cells == -1) {
-            schar_from_ascii(linebuf_char[off], ' ');
+            linebuf_char[off] = SCHAR_SPACE;
             cells = 1;
           }
           col += cells * col_stride;
@@ -4001,7 +4284,7 @@ win_line (
         // terminal buffers may need to highlight beyond the end of the
         // logical line
         while (col < grid->Columns) {
-          schar_from_ascii(linebuf_char[off], ' ');
+          linebuf_char[off] = SCHAR_SPACE;
           linebuf_attr[off++] = term_attrs[vcol++];
           col++;
         }
@@ -4088,9 +4371,9 @@ win_line (
         col--;
       }
       if (mb_utf8) {
-        schar_from_cc(linebuf_char[off], mb_c, u8cc);
+        linebuf_char[off] = schar_from_cc(mb_c, u8cc);
       } else {
-        schar_from_ascii(linebuf_char[off], c);
+        linebuf_char[off] = schar_from_ascii(c);
       }
       if (multi_attr) {
         linebuf_attr[off] = multi_attr;
@@ -4104,7 +4387,7 @@ win_line (
         off++;
         col++;
         // UTF-8: Put a 0 in the second screen char.
-        linebuf_char[off][0] = 0;
+        linebuf_char[off] = 0;
         if (draw_state > WL_NR && filler_todo <= 0) {
           vcol++;
         }
@@ -4321,20 +4604,18 @@ void screen_adjust_grid(ScreenGrid **grid, int *row_off, int *col_off)
 
 /*
  * Check whether the given character needs redrawing:
- * - the (first byte of the) character is different
+ * - the character is different
  * - the attributes are different
- * - the character is multi-byte and the next byte is different
  * - the character is two cells wide and the second cell differs.
  */
 static int grid_char_needs_redraw(ScreenGrid *grid, int off_from, int off_to,
                                   int cols)
 {
   return (cols > 0
-          && ((schar_cmp(linebuf_char[off_from], grid->chars[off_to])
+          && ((linebuf_char[off_from] != grid->chars[off_to]
                || linebuf_attr[off_from] != grid->attrs[off_to]
                || (line_off2cells(linebuf_char, off_from, off_from + cols) > 1
-                   && schar_cmp(linebuf_char[off_from + 1],
-                                grid->chars[off_to + 1])))
+                   && linebuf_char[off_from + 1] != grid->chars[off_to + 1]))
               || p_wd < 0));
 }
 
@@ -4364,6 +4645,7 @@ static void grid_put_linebuf(ScreenGrid *grid, int row, int coloff, int endcol,
   int char_cells;                           // 1: normal char
                                             // 2: occupies two display cells
   int start_dirty = -1, end_dirty = 0;
+  int diff_end;                             // end of the changed cells
 
   // TODO(bfredl): check all callsites and eliminate
   // Check for illegal row and col, just in case
@@ -4384,8 +4666,7 @@ static void grid_put_linebuf(ScreenGrid *grid, int row, int coloff, int endcol,
   if (rlflag) {
     /* Clear rest first, because it's left of the text. */
     if (clear_width > 0) {
-      while (col <= endcol && grid->chars[off_to][0] == ' '
-             && grid->chars[off_to][1] == NUL
+      while (col <= endcol && grid->chars[off_to] == SCHAR_SPACE
              && grid->attrs[off_to] == bg_attr
              ) {
         ++off_to;
@@ -4409,9 +4690,45 @@ static void grid_put_linebuf(ScreenGrid *grid, int row, int coloff, int endcol,
     }
   }
 
+  // Skip the cells at the start and at the end that did not change.  When
+  // scrolling a window most lines were drawn at another row before and only
+  // differ in a few cells, if at all.
+  diff_end = endcol;
+  if (p_wd >= 0 && col < endcol) {
+    size_t n = (size_t)(endcol - col);
+    size_t first = MIN(memscan_diff(linebuf_char + off_from,
+                                    grid->chars + off_to,
+                                    n * sizeof(schar_T)) / sizeof(schar_T),
+                       memscan_diff(linebuf_attr + off_from,
+                                    grid->attrs + off_to,
+                                    n * sizeof(sattr_T)) / sizeof(sattr_T));
+    size_t last = 0;
+    if (first < n) {
+      last = MAX((memscan_rdiff(linebuf_char + off_from, grid->chars + off_to,
+                                n * sizeof(schar_T)) + sizeof(schar_T) - 1)
+                 / sizeof(schar_T),
+                 (memscan_rdiff(linebuf_attr + off_from, grid->attrs + off_to,
+                                n * sizeof(sattr_T)) + sizeof(sattr_T) - 1)
+                 / sizeof(sattr_T));
+      // Don't start or end in the middle of a double-width character.
+      if (first > 0 && linebuf_char[off_from + first] == 0) {
+        first--;
+      }
+      if (last < n && linebuf_char[off_from + last] == 0) {
+        last++;
+      }
+    } else {
+      first = last = n;
+    }
+    diff_end = col + (int)last;
+    off_from += (unsigned)first;
+    off_to += (unsigned)first;
+    col += (int)first;
+  }
+
   redraw_next = grid_char_needs_redraw(grid, off_from, off_to, endcol - col);
 
-  while (col < endcol) {
+  while (col < diff_end) {
     char_cells = 1;
     if (col + 1 < endcol) {
       char_cells = line_off2cells(linebuf_char, off_from, max_off_from);
@@ -4440,9 +4757,9 @@ static void grid_put_linebuf(ScreenGrid *grid, int row, int coloff, int endcol,
         clear_next = true;
       }
 
-      schar_copy(grid->chars[off_to], linebuf_char[off_from]);
+      grid->chars[off_to] = linebuf_char[off_from];
       if (char_cells == 2) {
-        schar_copy(grid->chars[off_to+1], linebuf_char[off_from+1]);
+        grid->chars[off_to+1] = linebuf_char[off_from+1];
       }
 
       grid->attrs[off_to] = linebuf_attr[off_from];
@@ -4457,11 +4774,15 @@ static void grid_put_linebuf(ScreenGrid *grid, int row, int coloff, int endcol,
     off_from += char_cells;
     col += char_cells;
   }
+  if (col < endcol) {
+    off_to += (unsigned)(endcol - col);
+    col = endcol;
+  }
 
   if (clear_next) {
     /* Clear the second half of a double-wide character of which the left
      * half was overwritten with a single-wide character. */
-    schar_from_ascii(grid->chars[off_to], ' ');
+    grid->chars[off_to] = SCHAR_SPACE;
     end_dirty++;
   }
 
@@ -4470,11 +4791,9 @@ static void grid_put_linebuf(ScreenGrid *grid, int row, int coloff, int endcol,
     // blank out the rest of the line
     // TODO(bfredl): we could cache winline widths
     while (col < clear_width) {
-      if (grid->chars[off_to][0] != ' '
-          || grid->chars[off_to][1] != NUL
+      if (grid->chars[off_to] != SCHAR_SPACE
           || grid->attrs[off_to] != bg_attr) {
-        grid->chars[off_to][0] = ' ';
-        grid->chars[off_to][1] = NUL;
+        grid->chars[off_to] = SCHAR_SPACE;
         grid->attrs[off_to] = bg_attr;
         if (start_dirty == -1) {
           start_dirty = col;
@@ -5041,6 +5360,156 @@ get_keymap_str (
   return buf[0] != NUL;
 }
 
+// A status line or tab pages line is built again only when something it
+// depends on changed.  The items of the format tell which state they use, see
+// the STL_DEP_ flags.  Options and names shown by other items can only be
+// changed by an Ex command, an API call or a Lua callback, counted by
+// "state_tick".  An expression may use anything: it is evaluated again also
+// when the window, its cursor, the mode, Visual mode or recording changed.
+
+static stl_cache_T *tabline_cache = NULL;
+
+/// Get what the status line of "wp" with dependencies "deps" depends on now.
+/// "wp" is NULL for the tab pages line.
+static void stl_get_key(StlKey *key, win_T *wp, int deps, int fillchar,
+                        int maxwidth)
+{
+  win_T *ewp = wp == NULL ? curwin : wp;
+
+  memset(key, 0, sizeof(*key));  // padding is compared too
+  key->state_tick = state_tick;
+  if (deps & STL_DEP_ANY) {
+    key->curbuf = curbuf->handle;
+    key->visual_active = VIsual_active;
+    key->visual_mode = VIsual_mode;
+    key->reg_recording = reg_recording;
+  }
+  key->changedtick = buf_get_changedtick(ewp->w_buffer);
+  key->buf = ewp->w_buffer->handle;
+  key->changed = ewp->w_buffer->b_changed;
+  key->is_curwin = ewp == curwin;
+  key->maxwidth = maxwidth;
+  key->fillchar = fillchar;
+  if (deps & (STL_DEP_CURSOR | STL_DEP_ANY)) {
+    key->state = State;
+    key->cursor = ewp->w_cursor;
+  }
+  if (deps & (STL_DEP_VIEW | STL_DEP_ANY)) {
+    key->topline = ewp->w_topline;
+    key->botline = ewp->w_botline;
+  }
+  if (wp == NULL) {
+    FOR_ALL_TABS(tp) {
+      win_T *const cwp = tp == curtab ? curwin : tp->tp_curwin;
+      key->tabs = key->tabs * 31 + (uint64_t)cwp->handle;
+      key->tabs = key->tabs * 31 + (uint64_t)cwp->w_buffer->handle;
+      key->tabs = key->tabs * 31 + (uint64_t)cwp->w_buffer->b_changed;
+      key->tabs = key->tabs * 31 + (uint64_t)(tp == curtab);
+    }
+  }
+}
+
+/// Get the status line of "wp" built from "fmt" when nothing it depends on
+/// changed since it was built.  "wp" is NULL for the tab pages line.
+///
+/// @return  The width of the status line, -1 when it must be built.
+static int stl_cache_get(win_T *wp, char_u *fmt, int fillchar, int maxwidth,
+                         char_u *out, struct stl_hlrec *hltab,
+                         StlClickRecord *tabtab)
+{
+  stl_cache_T *const c = wp == NULL ? tabline_cache : wp->w_stl_cache;
+  if (c == NULL || STRCMP(c->fmt, fmt) != 0) {
+    return -1;
+  }
+  StlKey key;
+  stl_get_key(&key, wp, c->deps, fillchar, maxwidth);
+  if (memcmp(&key, &c->key, sizeof(key)) != 0) {
+    return -1;
+  }
+
+  STRCPY(out, c->out);
+  for (int n = 0;; n++) {
+    hltab[n] = c->hltab[n];
+    if (hltab[n].start == NULL) {
+      break;
+    }
+    hltab[n].start = out + (c->hltab[n].start - c->out);
+  }
+  for (int n = 0;; n++) {
+    tabtab[n] = c->tabtab[n];
+    if (tabtab[n].start == NULL) {
+      break;
+    }
+    tabtab[n].start = (char *)out + (c->tabtab[n].start - (char *)c->out);
+    if (tabtab[n].def.func != NULL) {
+      tabtab[n].def.func = xstrdup(tabtab[n].def.func);
+    }
+  }
+  return c->width;
+}
+
+/// Store the status line of "wp" in "out", built from "fmt", in the cache.
+static void stl_cache_put(win_T *wp, char_u *fmt, int deps, int fillchar,
+                          int maxwidth, char_u *out, int width,
+                          struct stl_hlrec *hltab, StlClickRecord *tabtab)
+{
+  stl_cache_T **const cp = wp == NULL ? &tabline_cache : &wp->w_stl_cache;
+  stl_cache_free(cp);
+  stl_cache_T *const c = xmalloc(sizeof(*c));
+  c->fmt = vim_strsave(fmt);
+  stl_get_key(&c->key, wp, deps, fillchar, maxwidth);
+  c->deps = deps;
+  c->width = width;
+  c->out = vim_strsave(out);
+
+  int n = 0;
+  while (hltab[n].start != NULL) {
+    n++;
+  }
+  c->hltab = xmemdup(hltab, (size_t)(n + 1) * sizeof(*hltab));
+  for (int i = 0; i < n; i++) {
+    c->hltab[i].start = c->out + (hltab[i].start - out);
+  }
+
+  // Only the tab pages line uses the clicks.
+  n = 0;
+  while (wp == NULL && tabtab[n].start != NULL) {
+    n++;
+  }
+  c->tabtab = xmalloc((size_t)(n + 1) * sizeof(*tabtab));
+  for (int i = 0; i < n; i++) {
+    c->tabtab[i] = tabtab[i];
+    c->tabtab[i].start = (char *)c->out + (tabtab[i].start - (char *)out);
+    if (tabtab[i].def.func != NULL) {
+      c->tabtab[i].def.func = xstrdup(tabtab[i].def.func);
+    }
+  }
+  c->tabtab[n] = (StlClickRecord){ .start = NULL };
+  *cp = c;
+}
+
+static void stl_cache_free(stl_cache_T **cp)
+{
+  stl_cache_T *const c = *cp;
+  if (c == NULL) {
+    return;
+  }
+  for (int n = 0; c->tabtab[n].start != NULL; n++) {
+    xfree(c->tabtab[n].def.func);
+  }
+  xfree(c->tabtab);
+  xfree(c->hltab);
+  xfree(c->out);
+  xfree(c->fmt);
+  XFREE_CLEAR(*cp);
+}
+
+/// Free the status line cached for window "wp".
+void win_stl_cache_free(win_T *wp)
+{
+  stl_cache_free(&wp->w_stl_cache);
+}
+
 /*
  * Redraw the status line or ruler of window "wp".
  * When "wp" is NULL redraw the tab pages line from 'tabline'.
@@ -5137,13 +5606,27 @@ win_redr_custom (
   p_crb_save = ewp->w_p_crb;
   ewp->w_p_crb = FALSE;
 
-  /* Make a copy, because the statusline may include a function call that
-   * might change the option value and free the memory. */
-  stl = vim_strsave(stl);
-  width = build_stl_str_hl(ewp, buf, sizeof(buf),
-      stl, use_sandbox,
-      fillchar, maxwidth, hltab, tabtab);
-  xfree(stl);
+  // The ruler changes with the cursor, it is always built.
+  width = draw_ruler ? -1 : stl_cache_get(wp, stl, fillchar, maxwidth, buf,
+                                          hltab, tabtab);
+  if (width < 0) {
+    int deps;
+    // Commands executed by an expression don't change what it depends on.
+    const uint64_t save_state_tick = state_tick;
+
+    /* Make a copy, because the statusline may include a function call that
+     * might change the option value and free the memory. */
+    stl = vim_strsave(stl);
+    width = build_stl_str_hl(ewp, buf, sizeof(buf),
+        stl, use_sandbox,
+        fillchar, maxwidth, hltab, tabtab, &deps);
+    state_tick = save_state_tick;
+    if (!draw_ruler) {
+      stl_cache_put(wp, stl, deps, fillchar, maxwidth, buf, width,
+                    hltab, tabtab);
+    }
+    xfree(stl);
+  }
   ewp->w_p_crb = p_crb_save;
 
   // Make all characters printable.
@@ -5215,50 +5698,9 @@ theend:
 // Low-level functions to manipulate invidual character cells on the
 // screen grid.
 
-/// Put a ASCII character in a screen cell.
-static void schar_from_ascii(char_u *p, const char c)
-{
-  p[0] = c;
-  p[1] = 0;
-}
-
-/// Put a unicode character in a screen cell.
-static int schar_from_char(char_u *p, int c)
-{
-  int len = utf_char2bytes(c, p);
-  p[len] = NUL;
-  return len;
-}
-
-/// Put a unicode char, and up to MAX_MCO composing chars, in a screen cell.
-static int schar_from_cc(char_u *p, int c, int u8cc[MAX_MCO])
-{
-  int len = utf_char2bytes(c, p);
-  for (int i = 0; i < MAX_MCO; i++) {
-    if (u8cc[i] == 0) {
-      break;
-    }
-    len += utf_char2bytes(u8cc[i], p + len);
-  }
-  p[len] = 0;
-  return len;
-}
-
-/// compare the contents of two screen cells.
-static int schar_cmp(char_u *sc1, char_u *sc2)
-{
-  return STRNCMP(sc1, sc2, sizeof(schar_T));
-}
-
-/// copy the contents of screen cell `sc2` into cell `sc1`
-static void schar_copy(char_u *sc1, char_u *sc2)
-{
-  STRLCPY(sc1, sc2, sizeof(schar_T));
-}
-
 static int line_off2cells(schar_T *line, size_t off, size_t max_off)
 {
-  return (off + 1 < max_off && line[off + 1][0] == 0) ? 2 : 1;
+  return (off + 1 < max_off && line[off + 1] == 0) ? 2 : 1;
 }
 
 /// Return number of display cells for char at grid->chars[off].
@@ -5289,7 +5731,7 @@ int grid_fix_col(ScreenGrid *grid, int col, int row)
 
   col += coloff;
   if (grid->chars != NULL && col > 0
-      && grid->chars[grid->line_offset[row] + col][0] == 0) {
+      && grid->chars[grid->line_offset[row] + col] == 0) {
     return col - 1 - coloff;
   }
   return col - coloff;
@@ -5317,7 +5759,7 @@ void grid_getbytes(ScreenGrid *grid, int row, int col, char_u *bytes,
   if (grid->chars != NULL && row < grid->Rows && col < grid->Columns) {
     off = grid->line_offset[row] + col;
     *attrp = grid->attrs[off];
-    schar_copy(bytes, grid->chars[off]);
+    schar_get((char *)bytes, grid->chars[off]);
   }
 }
 
@@ -5434,12 +5876,11 @@ void grid_puts_len(ScreenGrid *grid, char_u *text, int textlen, int row,
       mbyte_cells = 1;
     }
 
-    schar_T buf;
-    schar_from_cc(buf, u8c, u8cc);
+    schar_T buf = schar_from_cc(u8c, u8cc);
 
 
-    need_redraw = schar_cmp(grid->chars[off], buf)
-                  || (mbyte_cells == 2 && grid->chars[off + 1][0] != 0)
+    need_redraw = grid->chars[off] != buf
+                  || (mbyte_cells == 2 && grid->chars[off + 1] != 0)
                   || grid->attrs[off] != attr
                   || exmode_active;
 
@@ -5461,10 +5902,10 @@ void grid_puts_len(ScreenGrid *grid, char_u *text, int textlen, int row,
         clear_next_cell = true;
       }
 
-      schar_copy(grid->chars[off], buf);
+      grid->chars[off] = buf;
       grid->attrs[off] = attr;
       if (mbyte_cells == 2) {
-        grid->chars[off + 1][0] = 0;
+        grid->chars[off + 1] = 0;
         grid->attrs[off + 1] = attr;
       }
       put_dirty_first = MIN(put_dirty_first, col);
@@ -5526,6 +5967,7 @@ static void start_search_hl(void)
  */
 static void end_search_hl(void)
 {
+  search_hl_cache = NULL;
   if (search_hl.rm.regprog != NULL) {
     vim_regfree(search_hl.rm.regprog);
     search_hl.rm.regprog = NULL;
@@ -5560,10 +6002,217 @@ static void init_search_hl(win_T *wp)
   search_hl.lnum = 0;
   search_hl.first_lnum = 0;
   search_hl.attr = win_hl_attr(wp, HLF_L);
+  search_hl_cache = search_hl_cache_init(wp);
 
   // time limit is set at the toplevel, for all windows
 }
 
+// 'hlsearch' matches are kept per window, so that a line that is drawn again
+// is not searched again, and on a long line the matches before the shown part
+// are not searched for on every redraw.  Searching continues where it
+// stopped.  When 'redrawtime' passed, 'hlsearch' stays on and another redraw
+// is scheduled to continue, see search_hl_continue().  The matches are
+// dropped when the buffer or the pattern changes.  Not used for
+// a pattern that may match more than one line, or that depends on the
+// cursor, the Visual area or marks, or when 'cpoptions' does not include 'c',
+// then matches may overlap.
+
+/// Check if the 'hlsearch' pattern "pat" only depends on the text.
+static bool search_hl_cacheable(const char_u *pat)
+{
+  for (const char_u *p = pat; *p != NUL; p++) {
+    if (*p == '%') {
+      const char_u *q = p + 1;
+      if (*q == '<' || *q == '>') {
+        q++;
+      }
+      while (ascii_isdigit(*q)) {
+        q++;
+      }
+      if (*q == '#' || *q == 'V' || *q == '\'' || *q == 'v') {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+/// Get the cache of 'hlsearch' matches for drawing window "wp".
+///
+/// @return  NULL when it cannot be used.
+static search_hl_cache_T *search_hl_cache_init(win_T *wp)
+{
+  char_u *const pat = last_search_pat();
+  if (search_hl.rm.regprog == NULL || pat == NULL
+      || re_multiline(search_hl.rm.regprog)
+      || vim_strchr(p_cpo, CPO_SEARCH) == NULL
+      || !search_hl_cacheable(pat)) {
+    win_search_hl_free(wp);
+    return NULL;
+  }
+
+  search_hl_cache_T *c = wp->w_search_hl_cache;
+  const int ic = ignorecase(pat);
+  if (c != NULL
+      && c->buf == wp->w_buffer->handle
+      && c->changedtick == buf_get_changedtick(wp->w_buffer)
+      && c->ic == ic && c->magic == p_magic
+      && STRCMP(c->pat, pat) == 0) {
+    c->progress = false;
+    return c;
+  }
+
+  if (c == NULL) {
+    c = xcalloc(1, sizeof(*c));
+    wp->w_search_hl_cache = c;
+  }
+  for (size_t i = 0; i < SEARCH_HL_CACHE_SIZE; i++) {
+    c->lines[i].lnum = 0;
+  }
+  xfree(c->pat);
+  c->pat = vim_strsave(pat);
+  c->buf = wp->w_buffer->handle;
+  c->changedtick = buf_get_changedtick(wp->w_buffer);
+  c->ic = ic;
+  c->magic = p_magic;
+  c->timeout_lnum = 0;
+  c->progress = false;
+  return c;
+}
+
+/// Free the 'hlsearch' matches kept for window "wp".
+void win_search_hl_free(win_T *wp)
+{
+  search_hl_cache_T *const c = wp->w_search_hl_cache;
+  if (c == NULL) {
+    return;
+  }
+  if (search_hl_cache == c) {
+    search_hl_cache = NULL;
+  }
+  for (size_t i = 0; i < SEARCH_HL_CACHE_SIZE; i++) {
+    kv_destroy(c->lines[i].cols);
+  }
+  xfree(c->pat);
+  XFREE_CLEAR(wp->w_search_hl_cache);
+}
+
+/// Find the first 'hlsearch' match in line "lnum" that includes or is after
+/// "mincol", like next_search_hl() does, using and adding to the matches in
+/// "search_hl_cache".
+static void search_hl_cached(win_T *wp, match_T *shl, linenr_T lnum,
+                             colnr_T mincol)
+{
+  SearchHLLine *const sl =
+    &search_hl_cache->lines[lnum % SEARCH_HL_CACHE_SIZE];
+  if (sl->lnum != lnum) {
+    sl->lnum = lnum;
+    sl->done = false;
+    kv_size(sl->cols) = 0;
+  }
+
+  size_t i = 0;
+  for (;;) {
+    // Matches don't overlap, the first one that ends after "mincol" is the
+    // one searching from the start of the line stops at.
+    for (; i < kv_size(sl->cols); i += 2) {
+      if (kv_A(sl->cols, i) >= mincol || kv_A(sl->cols, i + 1) > mincol) {
+        shl->lnum = lnum;
+        shl->rm.startpos[0].lnum = 0;
+        shl->rm.startpos[0].col = kv_A(sl->cols, i);
+        shl->rm.endpos[0].lnum = 0;
+        shl->rm.endpos[0].col = kv_A(sl->cols, i + 1);
+        return;
+      }
+    }
+    if (sl->done || shl->rm.regprog == NULL) {
+      shl->lnum = 0;  // no match
+      return;
+    }
+    if (profile_passed_limit(shl->tm)) {
+      // No match found in time.  Continue later, unless other drawing
+      // took all the time.
+      shl->lnum = 0;
+      if (search_hl_cache->progress) {
+        search_hl_continue(wp);
+      }
+      return;
+    }
+
+    // Continue after the last match found, at the next character for an
+    // empty match.
+    colnr_T matchcol = 0;
+    if (kv_size(sl->cols) > 0) {
+      const colnr_T start = kv_A(sl->cols, kv_size(sl->cols) - 2);
+      matchcol = kv_last(sl->cols);
+      if (matchcol <= start) {
+        const char_u *const ml = ml_get_buf(shl->buf, lnum, false) + start;
+        if (*ml == NUL) {
+          sl->done = true;
+          continue;
+        }
+        matchcol = start + mb_ptr2len(ml);
+      }
+    }
+
+    const int save_called_emsg = called_emsg;
+    int timed_out = false;
+    called_emsg = false;
+    const long nmatched = vim_regexec_multi(&shl->rm, wp, shl->buf, lnum,
+                                            matchcol, &shl->tm, &timed_out);
+    if (timed_out && !called_emsg && !got_int
+        && (lnum != search_hl_cache->timeout_lnum
+            || matchcol != search_hl_cache->timeout_col)) {
+      // Keep the matches found so far and continue in the next redraw.
+      // Give up when it times out at the same place again.
+      search_hl_cache->timeout_lnum = lnum;
+      search_hl_cache->timeout_col = matchcol;
+      shl->lnum = 0;
+      search_hl_continue(wp);
+      return;
+    }
+    if (called_emsg || got_int || timed_out) {
+      // Error while handling regexp: stop using this regexp.
+      vim_regfree(shl->rm.regprog);
+      SET_NO_HLSEARCH(true);
+      shl->rm.regprog = NULL;
+      shl->lnum = 0;
+      got_int = false;  // avoid the "Type :quit to exit Vim" message
+      called_emsg = save_called_emsg;
+      return;
+    }
+    called_emsg = save_called_emsg;
+    search_hl_cache->progress = true;
+    if (nmatched == 0) {
+      sl->done = true;
+    } else {
+      kv_push(sl->cols, shl->rm.startpos[0].col);
+      kv_push(sl->cols, shl->rm.endpos[0].col);
+    }
+  }
+}
+
+/// Draw window "wp" again after this redraw, to show the 'hlsearch' matches
+/// that were not found within 'redrawtime'.
+static void search_hl_continue(win_T *wp)
+{
+  search_hl_cache_T *const c = wp->w_search_hl_cache;
+  if (!c->redraw_pending) {
+    c->redraw_pending = true;
+    multiqueue_put(main_loop.events, search_hl_continue_event, 1,
+                   (void *)(intptr_t)wp->handle);
+  }
+}
+
+static void search_hl_continue_event(void **argv)
+{
+  win_T *const wp = handle_get_window((handle_T)(intptr_t)argv[0]);
+  if (wp != NULL && wp->w_search_hl_cache != NULL) {
+    wp->w_search_hl_cache->redraw_pending = false;
+    redraw_win_later(wp, NOT_VALID);
+  }
+}
+
 /*
  * Advance to the match in window "wp" line "lnum" or past it.
  */
@@ -5663,6 +6312,12 @@ next_search_hl (
       return;
   }
 
+  if (shl == &search_hl && search_hl_cache != NULL
+      && win->w_search_hl_cache == search_hl_cache) {
+    search_hl_cached(win, shl, lnum, mincol);
+    return;
+  }
+
   /*
    * Repeat searching for a match until one is found that includes "mincol"
    * or none is found in this line.
@@ -5853,13 +6508,13 @@ void grid_fill(ScreenGrid *grid, int start_row, int end_row, int start_col,
     int dirty_last = 0;
 
     int col = start_col;
-    schar_from_char(sc, c1);
+    sc = schar_from_char(c1);
     int lineoff = grid->line_offset[row];
     for (col = start_col; col < end_col; col++) {
       int off = lineoff + col;
-      if (schar_cmp(grid->chars[off], sc)
+      if (grid->chars[off] != sc
           || grid->attrs[off] != attr) {
-        schar_copy(grid->chars[off], sc);
+        grid->chars[off] = sc;
         grid->attrs[off] = attr;
         if (dirty_first == INT_MAX) {
           dirty_first = col;
@@ -5867,7 +6522,7 @@ void grid_fill(ScreenGrid *grid, int start_row, int end_row, int start_col,
         dirty_last = col+1;
       }
       if (col == start_col) {
-        schar_from_char(sc, c2);
+        sc = schar_from_char(c2);
       }
     }
     if (dirty_last > dirty_first) {
@@ -6141,6 +6796,7 @@ void grid_free(ScreenGrid *grid)
 /// Doesn't allow reinit, so must only be called by free_all_mem!
 void screen_free_all_mem(void)
 {
+  stl_cache_free(&tabline_cache);
   grid_free(&default_grid);
   xfree(linebuf_char);
   xfree(linebuf_attr);
@@ -6214,7 +6870,7 @@ static void grid_clear_line(ScreenGrid *grid, unsigned off, int width,
                             bool valid)
 {
   for (int col = 0; col < width; col++) {
-    schar_from_ascii(grid->chars[off + col], ' ');
+    grid->chars[off + col] = SCHAR_SPACE;
   }
   int fill = valid ? 0 : -1;
   (void)memset(grid->attrs + off, fill, (size_t)width * sizeof(sattr_T));
@@ -1018,6 +1018,8 @@ int do_search(
   old_off = spats[0].off;
 
   pos = curwin->w_cursor;       /* start searching at the cursor position */
+  // Search all lines of a file that is still being loaded.
+  ml_pt_finish(curbuf);
 
   /*
    * Find out the direction of the search.
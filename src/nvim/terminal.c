@@ -1245,21 +1245,47 @@ static void refresh_scrollback(Terminal *term, buf_T *buf)
   int width, height;
   vterm_get_size(term->vt, &height, &width);
 
-  while (term->sb_pending > 0) {
+  if (term->sb_pending > 0) {
     // This means that either the window height has decreased or the screen
-    // became full and libvterm had to push all rows up. Convert the first
-    // pending scrollback row into a string and append it just above the visible
-    // section of the buffer
-    if (((int)buf->b_ml.ml_line_count - height) >= (int)term->sb_size) {
-      // scrollback full, delete lines at the top
-      ml_delete(1, false);
-      deleted_lines(1, 1);
+    // became full and libvterm had to push all rows up. Convert the pending
+    // scrollback rows into strings and append them at once just above the
+    // visible section of the buffer.
+    int count = term->sb_pending;
+    int avail = MAX((int)buf->b_ml.ml_line_count - height, 0);
+    // When the scrollback is full, lines at the top are deleted for each
+    // appended row.  Rows that would be deleted again are not appended.
+    int to_delete = 0;
+    for (int i = 0, n = avail; i < count; i++, n++) {
+      if (n >= (int)term->sb_size) {
+        to_delete++;
+        n--;
+      }
+    }
+    int skip = MAX(to_delete - avail, 0);
+    to_delete -= skip;
+    if (to_delete > 0) {
+      for (int i = 0; i < to_delete; i++) {
+        ml_delete(1, false);
+      }
+      deleted_lines(1, to_delete);
+    }
+
+    int added = count - skip;
+    char_u **rows = xmalloc(sizeof(char_u *) * (size_t)MAX(added, 1));
+    for (int i = 0; i < added; i++) {
+      fetch_row(term, i + skip - count, width);
+      rows[i] = (char_u *)xstrdup(term->textbuf);
     }
-    fetch_row(term, -term->sb_pending, width);
     int buf_index = (int)buf->b_ml.ml_line_count - height;
-    ml_append(buf_index, (uint8_t *)term->textbuf, 0, false);
-    appended_lines(buf_index, 1);
-    term->sb_pending--;
+    if (added > 0) {
+      ml_append_lines(buf_index, rows, NULL, added, false);
+      appended_lines(buf_index, added);
+    }
+    for (int i = 0; i < added; i++) {
+      xfree(rows[i]);
+    }
+    xfree(rows);
+    term->sb_pending = 0;
   }
 
   // Remove extra lines at the bottom
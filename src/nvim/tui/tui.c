@@ -25,10 +25,12 @@
 #include "nvim/main.h"
 #include "nvim/memory.h"
 #include "nvim/option.h"
+#include "nvim/schar.h"
 #include "nvim/api/vim.h"
 #include "nvim/api/private/helpers.h"
 #include "nvim/event/loop.h"
 #include "nvim/event/signal.h"
+#include "nvim/event/time.h"
 #include "nvim/os/input.h"
 #include "nvim/os/os.h"
 #include "nvim/os/tty.h"
@@ -48,6 +50,9 @@
 #define OUTBUF_SIZE 0xffff
 
 #define TOO_MANY_EVENTS 1000000
+// Cost of a cursor motion the terminal cannot do, see cursor_goto().  Small
+// enough that adding a few of them does not overflow.
+#define MOVE_NONE (INT_MAX / 8)
 #define STARTS_WITH(str, prefix) (strlen(str) >= (sizeof(prefix) - 1) \
     && 0 == memcmp((str), (prefix), sizeof(prefix) - 1))
 #define TMUX_WRAP(is_tmux, seq) ((is_tmux) \
@@ -68,15 +73,41 @@ typedef struct {
   int top, bot, left, right;
 } Rect;
 
+// Attributes as sent to the terminal: colors are -1 for the default color,
+// "attr" has HL_UNDERCURL only if the terminal can show it.
+typedef struct {
+  int fg, bg, sp;
+  int attr;
+} TermAttrs;
+
 typedef struct {
   UIBridgeData *bridge;
   Loop *loop;
   unibi_var_t params[9];
   char buf[OUTBUF_SIZE];
   size_t bufpos;
+  // Bytes being written to the terminal, while "buf" is filled with the
+  // next frame.  See flush_buf_start().
+  char wbuf[OUTBUF_SIZE + 4 * CNORM_COMMAND_MAX_SIZE];
+  uv_write_t write_req;
+  bool writing;
+  // The terminal did not take the previous frame when this one was done:
+  // lines are not drawn but invalidated, to be drawn by write_continue().
+  bool lagging;
+  // Readable when "write_loop" has work to do, to continue the write as
+  // soon as the terminal takes more.  Not used when "write_loop" has no
+  // backend fd (Windows), then "write_timer" checks every few ms.
+  uv_poll_t write_poll;
+  bool write_poll_init;
+  TimeWatcher write_timer;
   char norm[CNORM_COMMAND_MAX_SIZE];
   char invis[CNORM_COMMAND_MAX_SIZE];
   size_t normlen, invislen;
+  // Begin and end of a synchronized update, see flush_buf_start().
+  char sync_begin[CNORM_COMMAND_MAX_SIZE];
+  char sync_end[CNORM_COMMAND_MAX_SIZE];
+  size_t sync_beginlen, sync_endlen;
+  bool frame_open;  // "sync_begin" was written, "sync_end" not yet
   TermInput input;
   uv_loop_t write_loop;
   unibi_term *ut;
@@ -88,6 +119,9 @@ typedef struct {
   SignalWatcher winch_handle, cont_handle;
   bool cont_received;
   UGrid grid;
+  // What the terminal shows, to leave out cells that are drawn again with
+  // the same text and attributes.  "attr" is -1 where it is not known.
+  UGrid shown;
   kvec_t(Rect) invalid_regions;
   int row, col;
   int out_fd;
@@ -107,6 +141,7 @@ typedef struct {
   HlAttrs clear_attrs;
   kvec_t(HlAttrs) attrs;
   int print_attr_id;
+  TermAttrs print_attrs;  // what "print_attr_id" was sent as
   bool default_attr;
   bool can_clear_attr;
   ModeShape showing_mode;
@@ -124,8 +159,17 @@ typedef struct {
     int save_title, restore_title;
     int enter_undercurl_mode, exit_undercurl_mode, set_underline_color;
     int get_bg;
+    int sync;
   } unibi_ext;
   char *space_buf;
+  // Bytes of the cursor motions without parameters, MOVE_NONE when the
+  // terminal doesn't have them.  See cursor_goto().
+  struct {
+    int left, right, up, down, cr, home;
+  } move_cost;
+  // out() counts the bytes in "measured" instead of writing them.
+  bool measuring;
+  size_t measured;
 } TUIData;
 
 static bool volatile got_winch = false;
@@ -180,6 +224,19 @@ static size_t unibi_pre_fmt_str(TUIData *data, unsigned int unibi_index,
   return unibi_run(str, data->params, buf, len);
 }
 
+static size_t unibi_pre_fmt_ext_str(TUIData *data, int unibi_index,
+                                    char *buf, size_t len)
+{
+  const char *str = NULL;
+  if (unibi_index >= 0) {
+    str = unibi_get_ext_str(data->ut, (unsigned)unibi_index);
+  }
+  if (!str) {
+    return 0U;
+  }
+  return unibi_run(str, data->params, buf, len);
+}
+
 static void termname_set_event(void **argv)
 {
   char *termname = argv[0];
@@ -215,6 +272,7 @@ static void terminfo_start(UI *ui)
   data->unibi_ext.set_cursor_style = -1;
   data->unibi_ext.reset_cursor_style = -1;
   data->unibi_ext.get_bg = -1;
+  data->unibi_ext.sync = -1;
   data->out_fd = 1;
   data->out_isatty = os_isatty(data->out_fd);
 
@@ -276,6 +334,20 @@ static void terminfo_start(UI *ui)
                                     data->norm, sizeof data->norm);
   data->invislen = unibi_pre_fmt_str(data, unibi_cursor_invisible,
                                      data->invis, sizeof data->invis);
+  UNIBI_SET_NUM_VAR(data->params[0], 1);
+  data->sync_beginlen = unibi_pre_fmt_ext_str(data, data->unibi_ext.sync,
+                                              data->sync_begin,
+                                              sizeof data->sync_begin);
+  UNIBI_SET_NUM_VAR(data->params[0], 2);
+  data->sync_endlen = unibi_pre_fmt_ext_str(data, data->unibi_ext.sync,
+                                            data->sync_end,
+                                            sizeof data->sync_end);
+  data->move_cost.left = cap_cost(ui, unibi_cursor_left);
+  data->move_cost.right = cap_cost(ui, unibi_cursor_right);
+  data->move_cost.up = cap_cost(ui, unibi_cursor_up);
+  data->move_cost.down = cap_cost(ui, unibi_cursor_down);
+  data->move_cost.cr = cap_cost(ui, unibi_carriage_return);
+  data->move_cost.home = cap_cost(ui, unibi_cursor_home);
   // Set 't_Co' from the result of unibilium & fix_terminfo.
   t_colors = unibi_get_num(data->ut, unibi_max_colors);
   // Enter alternate screen, save title, and clear.
@@ -302,6 +374,10 @@ static void terminfo_start(UI *ui)
     uv_pipe_init(&data->write_loop, &data->output_handle.pipe, 0);
     uv_pipe_open(&data->output_handle.pipe, data->out_fd);
   }
+  int backend_fd = uv_backend_fd(&data->write_loop);
+  data->write_poll_init = backend_fd >= 0
+    && uv_poll_init(&data->loop->uv, &data->write_poll, backend_fd) == 0;
+  data->write_poll.data = ui;
 }
 
 static void terminfo_stop(UI *ui)
@@ -324,8 +400,12 @@ static void terminfo_stop(UI *ui)
   unibi_out_ext(ui, data->unibi_ext.disable_bracketed_paste);
   // Disable focus reporting
   unibi_out_ext(ui, data->unibi_ext.disable_focus_reporting);
-  flush_buf(ui);
+  flush_buf(ui, true);
   uv_tty_reset_mode();
+  if (data->write_poll_init) {
+    uv_close((uv_handle_t *)&data->write_poll, NULL);
+    data->write_poll_init = false;
+  }
   uv_close((uv_handle_t *)&data->output_handle, NULL);
   uv_run(&data->write_loop, UV_RUN_DEFAULT);
   if (uv_loop_close(&data->write_loop)) {
@@ -339,6 +419,7 @@ static void tui_terminal_start(UI *ui)
   TUIData *data = ui->data;
   data->print_attr_id = -1;
   ugrid_init(&data->grid);
+  ugrid_init(&data->shown);
   terminfo_start(ui);
   tui_guess_size(ui);
   signal_watcher_start(&data->winch_handle, sigwinch_cb, SIGWINCH);
@@ -366,8 +447,14 @@ static void tui_terminal_stop(UI *ui)
   }
   tinput_stop(&data->input);
   signal_watcher_stop(&data->winch_handle);
+  if (data->write_poll_init) {
+    uv_poll_stop(&data->write_poll);
+  }
+  time_watcher_stop(&data->write_timer);
+  data->lagging = false;
   terminfo_stop(ui);
   ugrid_free(&data->grid);
+  ugrid_free(&data->shown);
 }
 
 static void tui_stop(UI *ui)
@@ -394,6 +481,7 @@ static void tui_main(UIBridgeData *bridge, UI *ui)
   kv_init(data->invalid_regions);
   signal_watcher_init(data->loop, &data->winch_handle, ui);
   signal_watcher_init(data->loop, &data->cont_handle, data);
+  time_watcher_init(data->loop, &data->write_timer, ui);
 #ifdef UNIX
   signal_watcher_start(&data->cont_handle, sigcont_cb, SIGCONT);
 #endif
@@ -433,6 +521,7 @@ static void tui_main(UIBridgeData *bridge, UI *ui)
   signal_watcher_stop(&data->cont_handle);
   signal_watcher_close(&data->cont_handle, NULL);
   signal_watcher_close(&data->winch_handle, NULL);
+  time_watcher_close(&data->write_timer, NULL);
   loop_close(&tui_loop, false);
   kv_destroy(data->invalid_regions);
   kv_destroy(data->attrs);
@@ -496,6 +585,10 @@ static bool attrs_differ(UI *ui, int id1, int id2, bool rgb)
   }
 }
 
+/// Set the terminal attributes to those of "attr_id".
+///
+/// When the terminal attributes are known, only what changed is sent if that
+/// is shorter than resetting the attributes and setting all of them again.
 static void update_attrs(UI *ui, int attr_id)
 {
   TUIData *data = ui->data;
@@ -504,36 +597,90 @@ static void update_attrs(UI *ui, int attr_id)
     data->print_attr_id = attr_id;
     return;
   }
+  bool known = data->print_attr_id != -1;
   data->print_attr_id = attr_id;
+  TermAttrs from = data->print_attrs;
+  TermAttrs to = term_attrs(ui, attr_id);
+
+  bool delta = false;
+  if (known && attrs_delta_possible(ui, from, to)) {
+    data->measuring = true;
+    data->measured = 0;
+    attrs_out_delta(ui, from, to);
+    size_t delta_len = data->measured;
+    data->measured = 0;
+    attrs_out_full(ui, to);
+    data->measuring = false;
+    delta = delta_len < data->measured;
+  }
+  if (delta) {
+    attrs_out_delta(ui, from, to);
+    if (!(to.attr & (HL_UNDERLINE|HL_UNDERCURL))) {
+      // The underline color was left as it was.
+      to.sp = from.sp;
+    }
+  } else {
+    attrs_out_full(ui, to);
+    if (!(to.attr & (HL_UNDERLINE|HL_UNDERCURL))) {
+      to.sp = -1;
+    }
+  }
+  data->print_attrs = to;
+
+  int attr = to.attr;
+  data->default_attr = to.fg == -1 && to.bg == -1 && to.sp == -1 && !attr;
+
+  // Non-BCE terminals can't clear with non-default background color. Some BCE
+  // terminals don't support attributes either, so don't rely on it. But assume
+  // italic and bold has no effect if there is no text.
+  data->can_clear_attr =
+    !(attr & (HL_INVERSE|HL_STANDOUT|HL_UNDERLINE|HL_UNDERCURL))
+    && (data->bce || to.bg == -1);
+}
+
+/// Attributes of "attr_id" as they are sent to the terminal.
+static TermAttrs term_attrs(UI *ui, int attr_id)
+{
+  TUIData *data = ui->data;
   HlAttrs attrs = kv_A(data->attrs, (size_t)attr_id);
+  TermAttrs ta;
 
-  int fg = ui->rgb ? attrs.rgb_fg_color : (attrs.cterm_fg_color - 1);
-  if (fg == -1) {
-    fg = ui->rgb ? data->clear_attrs.rgb_fg_color
-                 : (data->clear_attrs.cterm_fg_color - 1);
+  ta.fg = ui->rgb ? attrs.rgb_fg_color : (attrs.cterm_fg_color - 1);
+  if (ta.fg == -1) {
+    ta.fg = ui->rgb ? data->clear_attrs.rgb_fg_color
+                    : (data->clear_attrs.cterm_fg_color - 1);
   }
 
-  int bg = ui->rgb ? attrs.rgb_bg_color : (attrs.cterm_bg_color - 1);
-  if (bg == -1) {
-    bg = ui->rgb ? data->clear_attrs.rgb_bg_color
-                 : (data->clear_attrs.cterm_bg_color - 1);
+  ta.bg = ui->rgb ? attrs.rgb_bg_color : (attrs.cterm_bg_color - 1);
+  if (ta.bg == -1) {
+    ta.bg = ui->rgb ? data->clear_attrs.rgb_bg_color
+                    : (data->clear_attrs.cterm_bg_color - 1);
   }
 
-  int attr = ui->rgb ? attrs.rgb_ae_attr : attrs.cterm_ae_attr;
-  bool bold = attr & HL_BOLD;
-  bool italic = attr & HL_ITALIC;
-  bool reverse = attr & HL_INVERSE;
-  bool standout = attr & HL_STANDOUT;
+  ta.attr = (ui->rgb ? attrs.rgb_ae_attr : attrs.cterm_ae_attr)
+    & (HL_BOLD|HL_ITALIC|HL_INVERSE|HL_STANDOUT|HL_UNDERLINE|HL_UNDERCURL);
+  if (!data->unibi_ext.enter_undercurl_mode && (ta.attr & HL_UNDERCURL)) {
+    ta.attr = (ta.attr & ~HL_UNDERCURL) | HL_UNDERLINE;
+  }
 
-  bool underline;
-  bool undercurl;
-  if (data->unibi_ext.enter_undercurl_mode) {
-    underline = attr & HL_UNDERLINE;
-    undercurl = attr & HL_UNDERCURL;
-  } else {
-    underline = (attr & HL_UNDERLINE) || (attr & HL_UNDERCURL);
-    undercurl = false;
+  ta.sp = -1;
+  if ((ta.attr & (HL_UNDERLINE|HL_UNDERCURL))
+      && data->unibi_ext.set_underline_color) {
+    ta.sp = attrs.rgb_sp_color;
   }
+  return ta;
+}
+
+/// Reset the terminal attributes and set all of "to".
+static void attrs_out_full(UI *ui, TermAttrs to)
+{
+  TUIData *data = ui->data;
+  bool bold = to.attr & HL_BOLD;
+  bool italic = to.attr & HL_ITALIC;
+  bool reverse = to.attr & HL_INVERSE;
+  bool standout = to.attr & HL_STANDOUT;
+  bool underline = to.attr & HL_UNDERLINE;
+  bool undercurl = to.attr & HL_UNDERCURL;
 
   if (unibi_get_str(data->ut, unibi_set_attributes)) {
     if (bold || reverse || underline || standout) {
@@ -570,52 +717,138 @@ static void update_attrs(UI *ui, int attr_id)
   if (italic) {
     unibi_out(ui, unibi_enter_italics_mode);
   }
-  if (undercurl && data->unibi_ext.enter_undercurl_mode) {
+  if (undercurl) {
     unibi_out_ext(ui, data->unibi_ext.enter_undercurl_mode);
   }
-  if ((undercurl || underline) && data->unibi_ext.set_underline_color) {
-    int color = attrs.rgb_sp_color;
-    if (color != -1) {
-        UNIBI_SET_NUM_VAR(data->params[0], (color >> 16) & 0xff);  // red
-        UNIBI_SET_NUM_VAR(data->params[1], (color >> 8) & 0xff);   // green
-        UNIBI_SET_NUM_VAR(data->params[2], color & 0xff);          // blue
-        unibi_out_ext(ui, data->unibi_ext.set_underline_color);
-    }
+  if (to.sp != -1) {
+    sp_color_out(ui, to.sp);
   }
-  if (ui->rgb) {
-    if (fg != -1) {
-      UNIBI_SET_NUM_VAR(data->params[0], (fg >> 16) & 0xff);  // red
-      UNIBI_SET_NUM_VAR(data->params[1], (fg >> 8) & 0xff);   // green
-      UNIBI_SET_NUM_VAR(data->params[2], fg & 0xff);          // blue
-      unibi_out_ext(ui, data->unibi_ext.set_rgb_foreground);
-    }
+  if (to.fg != -1) {
+    color_out(ui, to.fg, true);
+  }
+  if (to.bg != -1) {
+    color_out(ui, to.bg, false);
+  }
+}
 
-    if (bg != -1) {
-      UNIBI_SET_NUM_VAR(data->params[0], (bg >> 16) & 0xff);  // red
-      UNIBI_SET_NUM_VAR(data->params[1], (bg >> 8) & 0xff);   // green
-      UNIBI_SET_NUM_VAR(data->params[2], bg & 0xff);          // blue
-      unibi_out_ext(ui, data->unibi_ext.set_rgb_background);
-    }
-  } else {
-    if (fg != -1) {
-      UNIBI_SET_NUM_VAR(data->params[0], fg);
-      unibi_out(ui, unibi_set_a_foreground);
-    }
+/// Whether attrs_out_delta() can change the terminal attributes from "from"
+/// to "to": modes can only be turned off when the terminal has a sequence
+/// for that mode alone, and colors cannot go back to the default.
+static bool attrs_delta_possible(UI *ui, TermAttrs from, TermAttrs to)
+{
+  TUIData *data = ui->data;
+  int off = from.attr & ~to.attr;
+  if ((to.fg == -1 && from.fg != -1) || (to.bg == -1 && from.bg != -1)
+      || (to.sp == -1 && from.sp != -1
+          && (to.attr & (HL_UNDERLINE|HL_UNDERCURL)))) {
+    return false;
+  }
+  // Bold and reverse have no sequence to turn them off.
+  if (off & (HL_BOLD|HL_INVERSE)) {
+    return false;
+  }
+  if ((off & HL_ITALIC)
+      && !unibi_get_str(data->ut, unibi_exit_italics_mode)) {
+    return false;
+  }
+  // Standout is reverse on most terminals and turning it off also turns
+  // off reverse.
+  if ((off & HL_STANDOUT)
+      && ((to.attr & HL_INVERSE)
+          || !unibi_get_str(data->ut, unibi_exit_standout_mode))) {
+    return false;
+  }
+  // Turning off underline also turns off undercurl, and the other way round.
+  if ((off & (HL_UNDERLINE|HL_UNDERCURL))
+      && ((to.attr & (HL_UNDERLINE|HL_UNDERCURL))
+          || !(unibi_get_str(data->ut, unibi_exit_underline_mode)
+               || data->unibi_ext.exit_undercurl_mode))) {
+    return false;
+  }
+  // set_attributes may be the only way to turn modes on.
+  int on = to.attr & ~from.attr;
+  return !(((on & HL_BOLD) && !unibi_get_str(data->ut, unibi_enter_bold_mode))
+           || ((on & HL_UNDERLINE)
+               && !unibi_get_str(data->ut, unibi_enter_underline_mode))
+           || ((on & HL_STANDOUT)
+               && !unibi_get_str(data->ut, unibi_enter_standout_mode))
+           || ((on & HL_INVERSE)
+               && !unibi_get_str(data->ut, unibi_enter_reverse_mode)));
+}
 
-    if (bg != -1) {
-      UNIBI_SET_NUM_VAR(data->params[0], bg);
-      unibi_out(ui, unibi_set_a_background);
+/// Change the terminal attributes from "from" to "to", sending only what
+/// changed.  Only when attrs_delta_possible() says so.
+static void attrs_out_delta(UI *ui, TermAttrs from, TermAttrs to)
+{
+  TUIData *data = ui->data;
+  int off = from.attr & ~to.attr;
+  int on = to.attr & ~from.attr;
+
+  if (off & HL_ITALIC) {
+    unibi_out(ui, unibi_exit_italics_mode);
+  }
+  if (off & HL_STANDOUT) {
+    unibi_out(ui, unibi_exit_standout_mode);
+  }
+  if (off & (HL_UNDERLINE|HL_UNDERCURL)) {
+    if (unibi_get_str(data->ut, unibi_exit_underline_mode)) {
+      unibi_out(ui, unibi_exit_underline_mode);
+    } else {
+      unibi_out_ext(ui, data->unibi_ext.exit_undercurl_mode);
     }
   }
 
-  data->default_attr = fg == -1 && bg == -1
-    && !bold && !italic && !underline && !undercurl && !reverse && !standout;
+  if (on & HL_BOLD) {
+    unibi_out(ui, unibi_enter_bold_mode);
+  }
+  if (on & HL_UNDERLINE) {
+    unibi_out(ui, unibi_enter_underline_mode);
+  }
+  if (on & HL_STANDOUT) {
+    unibi_out(ui, unibi_enter_standout_mode);
+  }
+  if (on & HL_INVERSE) {
+    unibi_out(ui, unibi_enter_reverse_mode);
+  }
+  if (on & HL_ITALIC) {
+    unibi_out(ui, unibi_enter_italics_mode);
+  }
+  if (on & HL_UNDERCURL) {
+    unibi_out_ext(ui, data->unibi_ext.enter_undercurl_mode);
+  }
+  if (to.sp != -1 && to.sp != from.sp) {
+    sp_color_out(ui, to.sp);
+  }
+  if (to.fg != from.fg) {
+    color_out(ui, to.fg, true);
+  }
+  if (to.bg != from.bg) {
+    color_out(ui, to.bg, false);
+  }
+}
 
-  // Non-BCE terminals can't clear with non-default background color. Some BCE
-  // terminals don't support attributes either, so don't rely on it. But assume
-  // italic and bold has no effect if there is no text.
-  data->can_clear_attr = !reverse && !standout && !underline && !undercurl
-    && (data->bce || bg == -1);
+static void color_out(UI *ui, int color, bool fg)
+{
+  TUIData *data = ui->data;
+  if (ui->rgb) {
+    UNIBI_SET_NUM_VAR(data->params[0], (color >> 16) & 0xff);  // red
+    UNIBI_SET_NUM_VAR(data->params[1], (color >> 8) & 0xff);   // green
+    UNIBI_SET_NUM_VAR(data->params[2], color & 0xff);          // blue
+    unibi_out_ext(ui, fg ? data->unibi_ext.set_rgb_foreground
+                         : data->unibi_ext.set_rgb_background);
+  } else {
+    UNIBI_SET_NUM_VAR(data->params[0], color);
+    unibi_out(ui, fg ? unibi_set_a_foreground : unibi_set_a_background);
+  }
+}
+
+static void sp_color_out(UI *ui, int color)
+{
+  TUIData *data = ui->data;
+  UNIBI_SET_NUM_VAR(data->params[0], (color >> 16) & 0xff);  // red
+  UNIBI_SET_NUM_VAR(data->params[1], (color >> 8) & 0xff);   // green
+  UNIBI_SET_NUM_VAR(data->params[2], color & 0xff);          // blue
+  unibi_out_ext(ui, data->unibi_ext.set_underline_color);
 }
 
 static void final_column_wrap(UI *ui)
@@ -641,8 +874,15 @@ static void print_cell(UI *ui, UCell *ptr)
     // Printing the next character finally advances the cursor.
     final_column_wrap(ui);
   }
+  char text[MAX_SCHAR_SIZE];
+  size_t len = schar_get(text, ptr->data);
   update_attrs(ui, ptr->attr);
-  out(ui, ptr->data, strlen(ptr->data));
+  out(ui, text, len);
+  UGrid *shown = &data->shown;
+  if (grid->row >= 0 && grid->row < shown->height
+      && grid->col < shown->width) {
+    shown->cells[grid->row][grid->col] = *ptr;
+  }
   grid->col++;
   if (data->immediate_wrap_after_last_column) {
     // Printing at the right margin immediately advances the cursor.
@@ -650,6 +890,63 @@ static void print_cell(UI *ui, UCell *ptr)
   }
 }
 
+/// Print the cells from "startcol" to "endcol" in "row", leaving out those
+/// the terminal already shows.
+static void print_cells(UI *ui, int row, int startcol, int endcol)
+{
+  TUIData *data = ui->data;
+  UGrid *grid = &data->grid;
+  UCell *shown = data->shown.cells[row];
+  bool print = true;
+  UGRID_FOREACH_CELL(grid, row, startcol, endcol, {
+    // The right half of a double-width char goes with the left half, which
+    // moved the cursor over it.
+    if (cell->data != 0 || curcol == startcol) {
+      print = cell->data != shown[curcol].data
+        || cell->attr != shown[curcol].attr;
+    }
+    if (print) {
+      cursor_goto(ui, row, curcol);
+      print_cell(ui, cell);
+    }
+  });
+}
+
+/// Forget what the terminal shows in a region, so that all of it is drawn
+/// the next time.
+static void shown_forget(UI *ui, int top, int bot, int left, int right)
+{
+  TUIData *data = ui->data;
+  UGrid *shown = &data->shown;
+  if (!shown->cells) {
+    return;
+  }
+  bot = MIN(bot, shown->height);
+  right = MIN(right, shown->width);
+  for (int row = top; row < bot; row++) {
+    UGRID_FOREACH_CELL(shown, row, left, right, {
+      cell->attr = -1;
+    });
+  }
+}
+
+/// Whether the terminal shows the cells from "left" to "right" in "row" as
+/// cleared with "attr_id".
+static bool shown_cleared(UI *ui, int row, int left, int right, int attr_id)
+{
+  TUIData *data = ui->data;
+  UCell *cells = data->shown.cells[row];
+  for (int col = left; col < right; col++) {
+    if (cells[col].data != SCHAR_SPACE || cells[col].attr != attr_id) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/// Whether the "next" cells from "col" in "row" can be printed again to move
+/// the cursor over them: they have the current attributes and are one byte
+/// each.
 static bool cheap_to_print(UI *ui, int row, int col, int next)
 {
   TUIData *data = ui->data;
@@ -657,13 +954,8 @@ static bool cheap_to_print(UI *ui, int row, int col, int next)
   UCell *cell = grid->cells[row] + col;
   while (next) {
     next--;
-    if (attrs_differ(ui, cell->attr,
-                     data->print_attr_id, ui->rgb)) {
-      if (data->default_attr) {
-        return false;
-      }
-    }
-    if (strlen(cell->data) > 1) {
+    if (attrs_differ(ui, cell->attr, data->print_attr_id, ui->rgb)
+        || !schar_is_single_byte(cell->data)) {
       return false;
     }
     cell++;
@@ -671,9 +963,127 @@ static bool cheap_to_print(UI *ui, int row, int col, int next)
   return true;
 }
 
-/// This optimizes several cases where it is cheaper to do something other
-/// than send a full cursor positioning control sequence.  However, there are
-/// some further optimizations that may seem obvious but that will not work.
+/// Number of bytes "unibi_index" takes with the current "data->params", or
+/// MOVE_NONE when the terminal doesn't have it.
+static int cap_cost(UI *ui, int unibi_index)
+{
+  TUIData *data = ui->data;
+  if (!unibi_get_str(data->ut, (unsigned)unibi_index)) {
+    return MOVE_NONE;
+  }
+  data->measuring = true;
+  data->measured = 0;
+  unibi_out(ui, unibi_index);
+  data->measuring = false;
+  return data->measured > 0 ? (int)data->measured : MOVE_NONE;
+}
+
+static int parm_cost(UI *ui, int unibi_index, int n)
+{
+  TUIData *data = ui->data;
+  UNIBI_SET_NUM_VAR(data->params[0], n);
+  return cap_cost(ui, unibi_index);
+}
+
+/// Move the cursor from row "from" to row "to" in the same column, with the
+/// fewest bytes: "n" single steps, one parametrized motion or an absolute
+/// row.
+///
+/// @param emit  false to only count the bytes.
+/// @return  Number of bytes, MOVE_NONE when the terminal can't do it.
+static int cursor_move_row(UI *ui, int from, int to, bool emit)
+{
+  TUIData *data = ui->data;
+  if (from == to) {
+    return 0;
+  }
+  int n = abs(to - from);
+  int step_cost = to > from ? data->move_cost.down : data->move_cost.up;
+  int step = step_cost == MOVE_NONE ? MOVE_NONE : n * step_cost;
+  int parm = parm_cost(ui, to > from ? unibi_parm_down_cursor
+                                     : unibi_parm_up_cursor, n);
+  int absolute = parm_cost(ui, unibi_row_address, to);
+
+  int best = MIN(step, MIN(parm, absolute));
+  if (!emit || best == MOVE_NONE) {
+    return best;
+  }
+  if (best == step) {
+    while (n--) {
+      unibi_out(ui, to > from ? unibi_cursor_down : unibi_cursor_up);
+    }
+  } else if (best == parm) {
+    UNIBI_SET_NUM_VAR(data->params[0], n);
+    unibi_out(ui, to > from ? unibi_parm_down_cursor : unibi_parm_up_cursor);
+  } else {
+    UNIBI_SET_NUM_VAR(data->params[0], to);
+    unibi_out(ui, unibi_row_address);
+  }
+  return best;
+}
+
+/// Move the cursor from column "from" to column "to" in "row", with the
+/// fewest bytes: "n" single steps, one parametrized motion, an absolute
+/// column or printing the cells in between again.
+///
+/// @param emit  false to only count the bytes.
+/// @return  Number of bytes, MOVE_NONE when the terminal can't do it.
+static int cursor_move_col(UI *ui, int row, int from, int to, bool emit)
+{
+  TUIData *data = ui->data;
+  if (from == to) {
+    return 0;
+  }
+  int n = abs(to - from);
+  int step = MOVE_NONE;
+  int parm = MOVE_NONE;
+  int print = MOVE_NONE;
+  // Deferred right margin wrap terminals have inconsistent ideas about
+  // where the cursor actually is during a deferred wrap.  Relative
+  // motion calculations have OBOEs that cannot be compensated for,
+  // because two terminals that claim to be the same will implement
+  // different cursor positioning rules.
+  if (data->immediate_wrap_after_last_column || from < ui->width) {
+    int step_cost = to > from ? data->move_cost.right : data->move_cost.left;
+    step = step_cost == MOVE_NONE ? MOVE_NONE : n * step_cost;
+    parm = parm_cost(ui, to > from ? unibi_parm_right_cursor
+                                   : unibi_parm_left_cursor, n);
+    if (to > from && cheap_to_print(ui, row, from, n)) {
+      print = n;
+    }
+  }
+  int absolute = parm_cost(ui, unibi_column_address, to);
+
+  int best = MIN(MIN(step, parm), MIN(print, absolute));
+  if (!emit || best == MOVE_NONE) {
+    return best;
+  }
+  if (best == print) {
+    UGrid *grid = &data->grid;
+    for (int col = from; col < to; col++) {
+      print_cell(ui, &grid->cells[row][col]);
+    }
+  } else if (best == step) {
+    while (n--) {
+      unibi_out(ui, to > from ? unibi_cursor_right : unibi_cursor_left);
+    }
+  } else if (best == parm) {
+    UNIBI_SET_NUM_VAR(data->params[0], n);
+    unibi_out(ui, to > from ? unibi_parm_right_cursor
+                            : unibi_parm_left_cursor);
+  } else {
+    UNIBI_SET_NUM_VAR(data->params[0], to);
+    unibi_out(ui, unibi_column_address);
+  }
+  return best;
+}
+
+/// Move the cursor with the fewest bytes, counted with the sequences of the
+/// terminal: an absolute position, or moving to the row and then to the
+/// column from where the cursor is or from the left margin after a CR.
+/// Moving right may also be done by printing the cells in between again.
+///
+/// Some optimizations may seem obvious but will not work.
 ///
 /// We cannot use VT (ASCII 0/11) for moving the cursor up, because VT means
 /// move the cursor down on a DEC terminal.  Similarly, on a DEC terminal FF
@@ -687,87 +1097,41 @@ static void cursor_goto(UI *ui, int row, int col)
   if (row == grid->row && col == grid->col) {
     return;
   }
-  if (0 == row && 0 == col) {
-    unibi_out(ui, unibi_cursor_home);
-    ugrid_goto(grid, row, col);
-    return;
-  }
   if (grid->row == -1) {
     goto safe_move;
   }
-  if (0 == col ? col != grid->col :
-      row != grid->row ? false :
-      1 == col ? 2 < grid->col && cheap_to_print(ui, grid->row, 0, col) :
-      2 == col ? 5 < grid->col && cheap_to_print(ui, grid->row, 0, col) :
-      false) {
-    // Motion to left margin from anywhere else, or CR + printing chars is
-    // even less expensive than using BSes or CUB.
-    unibi_out(ui, unibi_carriage_return);
-    ugrid_goto(grid, grid->row, 0);
-  }
-  if (row == grid->row) {
-    if (col < grid->col
-        // Deferred right margin wrap terminals have inconsistent ideas about
-        // where the cursor actually is during a deferred wrap.  Relative
-        // motion calculations have OBOEs that cannot be compensated for,
-        // because two terminals that claim to be the same will implement
-        // different cursor positioning rules.
-        && (data->immediate_wrap_after_last_column || grid->col < ui->width)) {
-      int n = grid->col - col;
-      if (n <= 4) {  // This might be just BS, so it is considered really cheap.
-        while (n--) {
-          unibi_out(ui, unibi_cursor_left);
-        }
-      } else {
-        UNIBI_SET_NUM_VAR(data->params[0], n);
-        unibi_out(ui, unibi_parm_left_cursor);
-      }
-      ugrid_goto(grid, row, col);
-      return;
-    } else if (col > grid->col) {
-      int n = col - grid->col;
-      if (n <= 2) {
-        while (n--) {
-          unibi_out(ui, unibi_cursor_right);
-        }
-      } else {
-        UNIBI_SET_NUM_VAR(data->params[0], n);
-        unibi_out(ui, unibi_parm_right_cursor);
-      }
-      ugrid_goto(grid, row, col);
-      return;
-    }
-  }
-  if (col == grid->col) {
-    if (row > grid->row) {
-      int n = row - grid->row;
-      if (n <= 4) {  // This might be just LF, so it is considered really cheap.
-        while (n--) {
-          unibi_out(ui, unibi_cursor_down);
-        }
-      } else {
-        UNIBI_SET_NUM_VAR(data->params[0], n);
-        unibi_out(ui, unibi_parm_down_cursor);
-      }
-      ugrid_goto(grid, row, col);
-      return;
-    } else if (row < grid->row) {
-      int n = grid->row - row;
-      if (n <= 2) {
-        while (n--) {
-          unibi_out(ui, unibi_cursor_up);
-        }
-      } else {
-        UNIBI_SET_NUM_VAR(data->params[0], n);
-        unibi_out(ui, unibi_parm_up_cursor);
-      }
-      ugrid_goto(grid, row, col);
-      return;
+
+  int absolute;
+  if (0 == row && 0 == col && data->move_cost.home != MOVE_NONE) {
+    absolute = data->move_cost.home;
+  } else {
+    UNIBI_SET_NUM_VAR(data->params[0], row);
+    UNIBI_SET_NUM_VAR(data->params[1], col);
+    absolute = cap_cost(ui, unibi_cursor_address);
+  }
+  int rows = cursor_move_row(ui, grid->row, row, false);
+  int relative = rows + cursor_move_col(ui, row, grid->col, col, false);
+  int from_cr = data->move_cost.cr + rows
+    + cursor_move_col(ui, row, 0, col, false);
+
+  if (MIN(relative, from_cr) < absolute) {
+    if (from_cr < relative) {
+      unibi_out(ui, unibi_carriage_return);
+      ugrid_goto(grid, grid->row, 0);
     }
+    cursor_move_row(ui, grid->row, row, true);
+    ugrid_goto(grid, row, grid->col);
+    cursor_move_col(ui, row, grid->col, col, true);
+    ugrid_goto(grid, row, col);
+    return;
   }
 
 safe_move:
-  unibi_goto(ui, row, col);
+  if (0 == row && 0 == col && data->move_cost.home != MOVE_NONE) {
+    unibi_out(ui, unibi_cursor_home);
+  } else {
+    unibi_goto(ui, row, col);
+  }
   ugrid_goto(grid, row, col);
 }
 
@@ -777,6 +1141,24 @@ static void clear_region(UI *ui, int top, int bot, int left, int right,
   TUIData *data = ui->data;
   UGrid *grid = &data->grid;
 
+  // Leave out the rows at the top and bottom the terminal already shows
+  // cleared.
+  while (top < bot && shown_cleared(ui, top, left, right, attr_id)) {
+    top++;
+  }
+  while (bot > top && shown_cleared(ui, bot - 1, left, right, attr_id)) {
+    bot--;
+  }
+  if (top == bot) {
+    return;
+  }
+  for (int row = top; row < bot; row++) {
+    UGRID_FOREACH_CELL(&data->shown, row, left, right, {
+      cell->data = SCHAR_SPACE;
+      cell->attr = (sattr_T)attr_id;
+    });
+  }
+
   update_attrs(ui, attr_id);
 
   // Background is set to the default color and the right edge matches the
@@ -870,6 +1252,8 @@ static void tui_grid_resize(UI *ui, Integer g, Integer width, Integer height)
   TUIData *data = ui->data;
   UGrid *grid = &data->grid;
   ugrid_resize(grid, (int)width, (int)height);
+  ugrid_resize(&data->shown, (int)width, (int)height);
+  shown_forget(ui, 0, (int)height, 0, (int)width);
 
   xfree(data->space_buf);
   data->space_buf = xmalloc((size_t)width * sizeof(*data->space_buf));
@@ -904,6 +1288,9 @@ static void tui_grid_clear(UI *ui, Integer g)
   UGrid *grid = &data->grid;
   ugrid_clear(grid);
   kv_size(data->invalid_regions) = 0;
+  // Clear the screen even when it looks cleared, it may have been messed up
+  // by another program.
+  shown_forget(ui, 0, grid->height, 0, grid->width);
   clear_region(ui, 0, grid->height, 0, grid->width, 0);
 }
 
@@ -1072,7 +1459,11 @@ static void tui_grid_scroll(UI *ui, Integer g, Integer startrow, Integer endrow,
                 || data->can_set_lr_margin
                 || data->can_set_left_right_margin)));
 
-  if (can_scroll) {
+  if (data->lagging) {
+    // The invalid regions that are not drawn yet were moved with the
+    // scrolled text: draw all of it.
+    invalidate(ui, top, bot + 1, left, right + 1);
+  } else if (can_scroll) {
     // Change terminal scroll region and move cursor to the top
     if (!data->scroll_region_is_full_screen) {
       set_scroll_region(ui, top, bot, left, right);
@@ -1099,6 +1490,13 @@ static void tui_grid_scroll(UI *ui, Integer g, Integer startrow, Integer endrow,
     if (!data->scroll_region_is_full_screen) {
       reset_scroll_region(ui, fullwidth);
     }
+
+    ugrid_scroll(&data->shown, top, bot, left, right, (int)rows);
+    if (rows > 0) {
+      shown_forget(ui, bot - (int)rows + 1, bot + 1, left, right + 1);
+    } else {
+      shown_forget(ui, top, top - (int)rows, left, right + 1);
+    }
   } else {
     // Mark the moved region as invalid for redrawing later
     if (rows > 0) {
@@ -1114,6 +1512,20 @@ static void tui_hl_attr_define(UI *ui, Integer id, HlAttrs attrs,
                                HlAttrs cterm_attrs, Array info)
 {
   TUIData *data = ui->data;
+  if ((size_t)id < kv_size(data->attrs)) {
+    HlAttrs old = kv_A(data->attrs, (size_t)id);
+    if (old.rgb_ae_attr != attrs.rgb_ae_attr
+        || old.cterm_ae_attr != attrs.cterm_ae_attr
+        || old.rgb_fg_color != attrs.rgb_fg_color
+        || old.rgb_bg_color != attrs.rgb_bg_color
+        || old.rgb_sp_color != attrs.rgb_sp_color
+        || old.cterm_fg_color != attrs.cterm_fg_color
+        || old.cterm_bg_color != attrs.cterm_bg_color) {
+      // Cells shown with the id look different now.
+      data->print_attr_id = -1;
+      shown_forget(ui, 0, data->shown.height, 0, data->shown.width);
+    }
+  }
   kv_a(data->attrs, (size_t)id) = attrs;
 }
 
@@ -1140,6 +1552,7 @@ static void tui_default_colors_set(UI *ui, Integer rgb_fg, Integer rgb_bg,
   data->clear_attrs.cterm_bg_color = (int)cterm_bg;
 
   data->print_attr_id = -1;
+  shown_forget(ui, 0, data->grid.height, 0, data->grid.width);
   invalidate(ui, 0, data->grid.height, 0, data->grid.width);
 }
 
@@ -1157,9 +1570,30 @@ static void tui_flush(UI *ui)
     // events in the queue, it could take hours. Clearing the queue allows the
     // UI to recover. #1234 #5396
     loop_purge(data->loop);
+    ui_bridge_purged(data->bridge);
     tui_busy_stop(ui);  // avoid hidden cursor
   }
 
+  if (data->writing) {
+    uv_run(&data->write_loop, UV_RUN_NOWAIT);
+  }
+  if (data->writing) {
+    // The terminal did not take the previous frame yet.  Keep what was
+    // already put in the buffer, and draw the rest of this frame together
+    // with the frames that follow when it did.
+    if (!data->lagging) {
+      data->lagging = true;
+      if (data->write_poll_init) {
+        uv_poll_start(&data->write_poll, UV_READABLE, write_poll_cb);
+      } else {
+        time_watcher_start(&data->write_timer, write_timer_cb, 5, 5);
+      }
+    }
+    tui_stat_add(&g_stats.tui_merged, 1);
+    return;
+  }
+  data->lagging = false;
+
   while (kv_size(data->invalid_regions)) {
     Rect r = kv_pop(data->invalid_regions);
     assert(r.bot <= grid->height && r.right <= grid->width);
@@ -1169,16 +1603,12 @@ static void tui_flush(UI *ui)
       int clear_col;
       for (clear_col = r.right; clear_col > 0; clear_col--) {
         UCell *cell = &grid->cells[row][clear_col-1];
-        if (!(cell->data[0] == ' ' && cell->data[1] == NUL
-              && cell->attr == clear_attr)) {
+        if (!(cell->data == SCHAR_SPACE && cell->attr == clear_attr)) {
           break;
         }
       }
 
-      UGRID_FOREACH_CELL(grid, row, r.left, clear_col, {
-        cursor_goto(ui, row, curcol);
-        print_cell(ui, cell);
-      });
+      print_cells(ui, row, r.left, clear_col);
       if (clear_col < r.right) {
         clear_region(ui, row, row+1, clear_col, r.right, clear_attr);
       }
@@ -1187,7 +1617,35 @@ static void tui_flush(UI *ui)
 
   cursor_goto(ui, data->row, data->col);
 
-  flush_buf(ui);
+  flush_buf_start(ui, true);
+}
+
+/// Continues writing the frame, and when flush_buf_cb() was called for it
+/// draws the frames that were merged meanwhile.
+static void write_continue(UI *ui)
+{
+  TUIData *data = ui->data;
+  uv_run(&data->write_loop, UV_RUN_NOWAIT);
+  if (data->writing) {
+    return;
+  }
+  if (data->write_poll_init) {
+    uv_poll_stop(&data->write_poll);
+  }
+  time_watcher_stop(&data->write_timer);
+  if (data->lagging) {
+    tui_flush(ui);
+  }
+}
+
+static void write_poll_cb(uv_poll_t *handle, int status, int events)
+{
+  write_continue(handle->data);
+}
+
+static void write_timer_cb(TimeWatcher *watcher, void *data)
+{
+  write_continue(data);
 }
 
 /// Dumps termcap info to the messages area, if 'verbose' >= 3.
@@ -1268,6 +1726,7 @@ static void tui_option_set(UI *ui, String name, Object value)
     ui->rgb = value.data.boolean;
 
     data->print_attr_id = -1;
+    shown_forget(ui, 0, data->grid.height, 0, data->grid.width);
     invalidate(ui, 0, data->grid.height, 0, data->grid.width);
   }
 }
@@ -1280,14 +1739,21 @@ static void tui_raw_line(UI *ui, Integer g, Integer linerow, Integer startcol,
   TUIData *data = ui->data;
   UGrid *grid = &data->grid;
   for (Integer c = startcol; c < endcol; c++) {
-    memcpy(grid->cells[linerow][c].data, chunk[c-startcol], sizeof(schar_T));
+    grid->cells[linerow][c].data = chunk[c-startcol];
     assert((size_t)attrs[c-startcol] < kv_size(data->attrs));
     grid->cells[linerow][c].attr = attrs[c-startcol];
   }
-  UGRID_FOREACH_CELL(grid, (int)linerow, (int)startcol, (int)endcol, {
-    cursor_goto(ui, (int)linerow, curcol);
-    print_cell(ui, cell);
-  });
+  if (data->lagging) {
+    // Only draw the last state of the line, see tui_flush().
+    if (clearcol > endcol) {
+      ugrid_clear_chunk(grid, (int)linerow, (int)endcol, (int)clearcol,
+                        (sattr_T)clearattr);
+    }
+    invalidate(ui, (int)linerow, (int)linerow+1, (int)startcol,
+               (int)MAX(endcol, clearcol));
+    return;
+  }
+  print_cells(ui, (int)linerow, (int)startcol, (int)endcol);
 
   if (clearcol > endcol) {
     ugrid_clear_chunk(grid, (int)linerow, (int)endcol, (int)clearcol,
@@ -1301,9 +1767,14 @@ static void tui_raw_line(UI *ui, Integer g, Integer linerow, Integer startcol,
     // Only do line wrapping if the grid width is equal to the terminal
     // width and the line continuation is within the grid.
 
-    if (endcol != grid->width) {
+    // The cursor is not after the last char of the row when cells the
+    // terminal already shows were left out.
+    bool at_end = data->immediate_wrap_after_last_column
+      ? grid->row == linerow + 1 && grid->col == 0
+      : grid->row == linerow && grid->col == grid->width;
+    if (!at_end) {
       // Print the last char of the row, if we haven't already done so.
-      int size = grid->cells[linerow][grid->width - 1].data[0] == NUL ? 2 : 1;
+      int size = grid->cells[linerow][grid->width - 1].data == 0 ? 2 : 1;
       cursor_goto(ui, (int)linerow, grid->width - size);
       print_cell(ui, &grid->cells[linerow][grid->width - size]);
     }
@@ -1415,7 +1886,7 @@ retry: \
       unibi_format(vars, vars + 26, str, data->params, out, ui, NULL, NULL); \
       if (data->overflow) { \
         data->bufpos = orig_pos; \
-        flush_buf(ui); \
+        flush_buf(ui, false); \
         goto retry; \
       } \
       data->cork = false; \
@@ -1437,6 +1908,11 @@ static void out(void *ctx, const char *str, size_t len)
   TUIData *data = ui->data;
   size_t available = sizeof(data->buf) - data->bufpos;
 
+  if (data->measuring) {
+    data->measured += len;
+    return;
+  }
+
   if (data->cork && data->overflow) {
     return;
   }
@@ -1446,7 +1922,7 @@ static void out(void *ctx, const char *str, size_t len)
       data->overflow = true;
       return;
     } else {
-      flush_buf(ui);
+      flush_buf(ui, false);
     }
   }
 
@@ -1897,6 +2373,13 @@ static void augment_terminfo(TUIData *data, const char *term,
       ut, "ext.enable_mouse", "\x1b[?1002h\x1b[?1006h");
   data->unibi_ext.disable_mouse = (int)unibi_add_ext_str(
       ut, "ext.disable_mouse", "\x1b[?1002l\x1b[?1006l");
+  // Synchronized update: the terminal shows what comes in between at once.
+  // "Sync" is the extended capability from tmux, 1 begins and 2 ends.
+  data->unibi_ext.sync = unibi_find_ext_str(ut, "Sync");
+  if (-1 == data->unibi_ext.sync) {
+    data->unibi_ext.sync = (int)unibi_add_ext_str(
+        ut, "Sync", "\x1b[?2026%?%p1%{1}%-%tl%eh%;");
+  }
 
   int ext_bool_Su = unibi_find_ext_bool(ut, "Su");  // used by kitty
   if (vte_version >= 5102
@@ -1911,49 +2394,105 @@ static void augment_terminfo(TUIData *data, const char *term,
   }
 }
 
-static void flush_buf(UI *ui)
+/// Writes the buffer to the terminal, and waits until it is written.
+///
+/// @param end  The frame is done, see flush_buf_start().
+static void flush_buf(UI *ui, bool end)
+{
+  flush_buf_wait(ui);
+  flush_buf_start(ui, end);
+  flush_buf_wait(ui);
+}
+
+/// Starts writing the buffer to the terminal.  Filling the buffer can go on
+/// while it is being written.  A previous write must be finished.
+///
+/// @param end  The frame is done.  Otherwise the buffer was full and more of
+///             the frame follows.
+static void flush_buf_start(UI *ui, bool end)
 {
-  uv_write_t req;
-  uv_buf_t bufs[3];
-  uv_buf_t *bufp = &bufs[0];
   TUIData *data = ui->data;
+  size_t len = 0;
 
-  if (data->bufpos <= 0 && data->busy == data->is_invisible) {
+  assert(!data->writing);
+  if (data->bufpos <= 0
+      && (!end || (data->busy == data->is_invisible && !data->frame_open))) {
     return;
   }
 
+  // Let the terminal show all that is drawn at once, so that a half drawn
+  // frame is never seen.  A frame that does not fit in the buffer is written
+  // in parts: begin with the first part, end with the last one.
+  if (data->bufpos > 0 && !data->frame_open) {
+    memcpy(data->wbuf + len, data->sync_begin, data->sync_beginlen);
+    len += data->sync_beginlen;
+    data->frame_open = true;
+  }
+
   if (!data->is_invisible) {
     // cursor is visible. Write a "cursor invisible" command before writing the
     // buffer.
-    bufp->base = data->invis;
-    bufp->len = UV_BUF_LEN(data->invislen);
-    bufp++;
+    memcpy(data->wbuf + len, data->invis, data->invislen);
+    len += data->invislen;
     data->is_invisible = true;
   }
 
-  if (data->bufpos > 0) {
-    bufp->base = data->buf;
-    bufp->len = UV_BUF_LEN(data->bufpos);
-    bufp++;
-  }
+  memcpy(data->wbuf + len, data->buf, data->bufpos);
+  len += data->bufpos;
 
-  if (!data->busy) {
+  if (end && !data->busy) {
     assert(data->is_invisible);
     // not busy and the cursor is invisible. Write a "cursor normal" command
     // after writing the buffer.
-    bufp->base = data->norm;
-    bufp->len = UV_BUF_LEN(data->normlen);
-    bufp++;
+    memcpy(data->wbuf + len, data->norm, data->normlen);
+    len += data->normlen;
     data->is_invisible = data->busy;
   }
 
-  uv_write(&req, STRUCT_CAST(uv_stream_t, &data->output_handle),
-           bufs, (unsigned)(bufp - bufs), NULL);
-  uv_run(&data->write_loop, UV_RUN_DEFAULT);
+  if (end && data->frame_open) {
+    memcpy(data->wbuf + len, data->sync_end, data->sync_endlen);
+    len += data->sync_endlen;
+    data->frame_open = false;
+  }
+
+  uv_buf_t buf = { .base = data->wbuf, .len = UV_BUF_LEN(len) };
+  data->write_req.data = data;
+  data->writing = true;
+  uv_write(&data->write_req, STRUCT_CAST(uv_stream_t, &data->output_handle),
+           &buf, 1, flush_buf_cb);
+  tui_stat_add(&g_stats.tui_bytes, (int64_t)len);
   data->bufpos = 0;
   data->overflow = false;
 }
 
+static void flush_buf_cb(uv_write_t *req, int status)
+{
+  TUIData *data = req->data;
+  data->writing = false;
+}
+
+/// Waits until the terminal took what flush_buf_start() wrote.
+static void flush_buf_wait(UI *ui)
+{
+  TUIData *data = ui->data;
+  if (data->writing) {
+    tui_stat_add(&g_stats.tui_waits, 1);
+  }
+  while (data->writing) {
+    uv_run(&data->write_loop, UV_RUN_ONCE);
+  }
+}
+
+/// Adds to a counter in g_stats, from the TUI thread.
+static void tui_stat_add(int64_t *stat, int64_t n)
+{
+#if defined(__GNUC__) || defined(__clang__)
+  __atomic_fetch_add(stat, n, __ATOMIC_RELAXED);
+#else
+  *stat += n;
+#endif
+}
+
 #if TERMKEY_VERSION_MAJOR > 0 || TERMKEY_VERSION_MINOR > 18
 /// Try to get "kbs" code from stty because "the terminfo kbs entry is extremely
 /// unreliable." (Vim, Bash, and tmux also do this.)
@@ -7,6 +7,7 @@
 #include <limits.h>
 
 #include "nvim/vim.h"
+#include "nvim/schar.h"
 #include "nvim/ui.h"
 #include "nvim/ugrid.h"
 
@@ -82,8 +83,7 @@ static void clear_region(UGrid *grid, int top, int bot, int left, int right,
 {
   for (int row = top; row <= bot; row++) {
     UGRID_FOREACH_CELL(grid, row, left, right+1, {
-      cell->data[0] = ' ';
-      cell->data[1] = 0;
+      cell->data = SCHAR_SPACE;
       cell->attr = attr;
     });
   }
@@ -7,10 +7,8 @@
 typedef struct ucell UCell;
 typedef struct ugrid UGrid;
 
-#define CELLBYTES (sizeof(schar_T))
-
 struct ucell {
-  char data[CELLBYTES + 1];
+  schar_T data;
   sattr_T attr;
 };
 
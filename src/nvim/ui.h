@@ -20,6 +20,7 @@ typedef enum {
   kUIMultigrid,
   kUIHlState,
   kUITermColors,
+  kUIPackedLines,
   kUIFloatDebug,
   kUIExtCount,
 } UIExtension;
@@ -34,6 +35,7 @@ EXTERN const char *ui_ext_names[] INIT(= {
   "ext_multigrid",
   "ext_hlstate",
   "ext_termcolors",
+  "ext_packedlines",
   "_debug_float",
 });
 
@@ -8,6 +8,7 @@
 #include <stdbool.h>
 #include <stdio.h>
 #include <limits.h>
+#include <string.h>
 
 #include "nvim/log.h"
 #include "nvim/main.h"
@@ -18,6 +19,20 @@
 #include "nvim/ugrid.h"
 #include "nvim/api/private/helpers.h"
 
+// Size of the ring buffer of calls, a multiple of the record alignment.
+#define RING_SIZE (512 * 1024)
+#define RING_ALIGN(n) (((n) + sizeof(void *) - 1) & ~(sizeof(void *) - 1))
+
+#if defined(__GNUC__) || defined(__clang__)
+# define RING_ATOMICS
+#endif
+
+/// A call in the ring buffer, followed by the data it points to.
+typedef struct {
+  Event event;  ///< NULL handler: skip to the start of the ring
+  size_t size;  ///< size of the record with its data
+} BridgeRecord;
+
 #ifdef INCLUDE_GENERATED_DECLARATIONS
 # include "ui_bridge.c.generated.h"
 #endif
@@ -26,8 +41,8 @@
 
 // Schedule a function call on the UI bridge thread.
 #define UI_BRIDGE_CALL(ui, name, argc, ...) \
-  ((UIBridgeData *)ui)->scheduler( \
-      event_create(ui_bridge_##name##_event, argc, __VA_ARGS__), UI(ui))
+  ui_bridge_push((UIBridgeData *)ui, \
+                 event_create(ui_bridge_##name##_event, argc, __VA_ARGS__))
 
 #define INT2PTR(i) ((void *)(intptr_t)i)
 #define PTR2INT(p) ((Integer)(intptr_t)p)
@@ -70,6 +85,9 @@ UI *ui_bridge_attach(UI *ui, ui_main_fn ui_main, event_scheduler scheduler)
   }
 
   rv->ui_main = ui_main;
+  rv->ring = xmalloc(RING_SIZE);
+  uv_mutex_init(&rv->ring_mutex);
+  uv_cond_init(&rv->ring_cond);
   uv_mutex_init(&rv->mutex);
   uv_cond_init(&rv->cond);
   uv_mutex_lock(&rv->mutex);
@@ -94,6 +112,24 @@ void ui_bridge_stopped(UIBridgeData *bridge)
   uv_mutex_lock(&bridge->mutex);
   bridge->stopped = true;
   uv_mutex_unlock(&bridge->mutex);
+  // Calls are not handled anymore, don't wait for room in the ring.
+  uv_mutex_lock(&bridge->ring_mutex);
+  bridge->ring_stopped = true;
+  uv_cond_signal(&bridge->ring_cond);
+  uv_mutex_unlock(&bridge->ring_mutex);
+}
+
+/// Called on the UI thread after its event queue was purged, which may have
+/// dropped the event scheduled to handle the calls in the ring.
+void ui_bridge_purged(UIBridgeData *bridge)
+{
+  ring_set_pending(bridge, false);
+  if (!bridge->ring_draining
+      && ring_load(bridge, &bridge->ring_head) != bridge->ring_tail
+      && !ring_set_pending(bridge, true)) {
+    bridge->scheduler(event_create(ui_bridge_drain_event, 1, bridge),
+                      bridge->ui);
+  }
 }
 
 static void ui_thread_run(void *data)
@@ -123,9 +159,176 @@ static void ui_bridge_stop(UI *b)
   uv_thread_join(&bridge->ui_thread);
   uv_mutex_destroy(&bridge->mutex);
   uv_cond_destroy(&bridge->cond);
+  uv_mutex_destroy(&bridge->ring_mutex);
+  uv_cond_destroy(&bridge->ring_cond);
+  xfree(bridge->ring);
   xfree(bridge->ui);  // Threads joined, now safe to free UI container. #7922
   xfree(b);
 }
+
+static inline size_t ring_load(UIBridgeData *bridge, size_t *p)
+{
+#ifdef RING_ATOMICS
+  return __atomic_load_n(p, __ATOMIC_SEQ_CST);
+#else
+  uv_mutex_lock(&bridge->ring_mutex);
+  size_t v = *p;
+  uv_mutex_unlock(&bridge->ring_mutex);
+  return v;
+#endif
+}
+
+static inline void ring_store(UIBridgeData *bridge, size_t *p, size_t v)
+{
+#ifdef RING_ATOMICS
+  __atomic_store_n(p, v, __ATOMIC_SEQ_CST);
+#else
+  uv_mutex_lock(&bridge->ring_mutex);
+  *p = v;
+  uv_mutex_unlock(&bridge->ring_mutex);
+#endif
+}
+
+/// Set ring_pending to `v`, return the old value.
+static inline bool ring_set_pending(UIBridgeData *bridge, bool v)
+{
+#ifdef RING_ATOMICS
+  return __atomic_exchange_n(&bridge->ring_pending, v, __ATOMIC_SEQ_CST);
+#else
+  uv_mutex_lock(&bridge->ring_mutex);
+  bool old = bridge->ring_pending;
+  bridge->ring_pending = v;
+  uv_mutex_unlock(&bridge->ring_mutex);
+  return old;
+#endif
+}
+
+/// Reserve a record for a call with `size` bytes of data in the ring of
+/// calls to the UI thread.  Waits for the UI thread when the ring is full.
+///
+/// @return  the record, to be filled in and passed to ui_bridge_commit().
+static BridgeRecord *ui_bridge_reserve(UIBridgeData *bridge, size_t size)
+{
+  const size_t need = RING_ALIGN(sizeof(BridgeRecord) + size);
+  assert(need <= RING_SIZE / 2);
+  size_t head = bridge->ring_head;
+  size_t pos = head % RING_SIZE;
+  // A record does not wrap around, skip the end of the ring when needed.
+  const size_t skip = RING_SIZE - pos < need ? RING_SIZE - pos : 0;
+  if (RING_SIZE - (head - ring_load(bridge, &bridge->ring_tail))
+      < skip + need) {
+    ui_bridge_wait(bridge, head, skip + need);
+  }
+  if (skip > 0) {
+    if (skip >= sizeof(BridgeRecord)) {
+      BridgeRecord *pad = (BridgeRecord *)(bridge->ring + pos);
+      pad->event.handler = NULL;
+      pad->size = skip;
+    }
+    head += skip;
+    pos = 0;
+    ring_store(bridge, &bridge->ring_head, head);
+  }
+  BridgeRecord *rec = (BridgeRecord *)(bridge->ring + pos);
+  rec->size = need;
+  return rec;
+}
+
+/// Wait until the UI thread made room for `need` bytes in the ring after
+/// `head`, or stopped.
+static void ui_bridge_wait(UIBridgeData *bridge, size_t head, size_t need)
+{
+  uv_mutex_lock(&bridge->ring_mutex);
+#ifdef RING_ATOMICS
+  __atomic_store_n(&bridge->ring_waiting, true, __ATOMIC_SEQ_CST);
+  while (RING_SIZE - (head - __atomic_load_n(&bridge->ring_tail,
+                                             __ATOMIC_SEQ_CST)) < need
+#else
+  bridge->ring_waiting = true;
+  while (RING_SIZE - (head - bridge->ring_tail) < need
+#endif
+         && !bridge->ring_stopped) {
+    uv_cond_wait(&bridge->ring_cond, &bridge->ring_mutex);
+  }
+#ifdef RING_ATOMICS
+  __atomic_store_n(&bridge->ring_waiting, false, __ATOMIC_SEQ_CST);
+#else
+  bridge->ring_waiting = false;
+#endif
+  uv_mutex_unlock(&bridge->ring_mutex);
+}
+
+/// Wake up the main thread when it waits for room in the ring.  Called on
+/// the UI thread after ring_tail was moved.
+static void ui_bridge_wake(UIBridgeData *bridge)
+{
+#ifdef RING_ATOMICS
+  if (!__atomic_load_n(&bridge->ring_waiting, __ATOMIC_SEQ_CST)) {
+    return;
+  }
+#endif
+  uv_mutex_lock(&bridge->ring_mutex);
+  if (bridge->ring_waiting) {
+    uv_cond_signal(&bridge->ring_cond);
+  }
+  uv_mutex_unlock(&bridge->ring_mutex);
+}
+
+/// Pass a record filled in after ui_bridge_reserve() to the UI thread.
+static void ui_bridge_commit(UIBridgeData *bridge, BridgeRecord *rec)
+{
+  ring_store(bridge, &bridge->ring_head, bridge->ring_head + rec->size);
+  if (!ring_set_pending(bridge, true)) {
+    bridge->scheduler(event_create(ui_bridge_drain_event, 1, bridge),
+                      bridge->ui);
+  }
+}
+
+/// Schedule a call without data in the ring on the UI thread.
+static void ui_bridge_push(UIBridgeData *bridge, Event event)
+{
+  BridgeRecord *rec = ui_bridge_reserve(bridge, 0);
+  rec->event = event;
+  ui_bridge_commit(bridge, rec);
+}
+
+/// Handle the calls in the ring, on the UI thread.
+static void ui_bridge_drain_event(void **argv)
+{
+  UIBridgeData *bridge = argv[0];
+  if (bridge->ring_draining) {
+    // A call is waiting for events, the calls after it are handled when it
+    // returns.
+    return;
+  }
+  bridge->ring_draining = true;
+  for (;;) {
+    ring_set_pending(bridge, false);
+    const size_t head = ring_load(bridge, &bridge->ring_head);
+    size_t tail = bridge->ring_tail;
+    if (tail == head) {
+      break;
+    }
+    while (tail != head) {
+      const size_t pos = tail % RING_SIZE;
+      if (RING_SIZE - pos < sizeof(BridgeRecord)) {
+        tail += RING_SIZE - pos;
+      } else {
+        BridgeRecord *rec = (BridgeRecord *)(bridge->ring + pos);
+        const size_t size = rec->size;
+        if (rec->event.handler != NULL) {
+          // The data of the call stays in the ring until it returns.
+          rec->event.handler(rec->event.argv);
+        }
+        tail += size;
+      }
+      ring_store(bridge, &bridge->ring_tail, tail);
+      ui_bridge_wake(bridge);
+    }
+  }
+  bridge->ring_draining = false;
+}
+
 static void ui_bridge_stop_event(void **argv)
 {
   UI *ui = UI(argv[0]);
@@ -135,9 +338,13 @@ static void ui_bridge_stop_event(void **argv)
 static void ui_bridge_hl_attr_define(UI *ui, Integer id, HlAttrs attrs,
                                      HlAttrs cterm_attrs, Array info)
 {
-  HlAttrs *a = xmalloc(sizeof(HlAttrs));
+  UIBridgeData *bridge = (UIBridgeData *)ui;
+  BridgeRecord *rec = ui_bridge_reserve(bridge, sizeof(HlAttrs));
+  HlAttrs *a = (HlAttrs *)(rec + 1);
   *a = attrs;
-  UI_BRIDGE_CALL(ui, hl_attr_define, 3, ui, INT2PTR(id), a);
+  rec->event = event_create(ui_bridge_hl_attr_define_event, 3, ui,
+                            INT2PTR(id), a);
+  ui_bridge_commit(bridge, rec);
 }
 static void ui_bridge_hl_attr_define_event(void **argv)
 {
@@ -145,7 +352,6 @@ static void ui_bridge_hl_attr_define_event(void **argv)
   Array info = ARRAY_DICT_INIT;
   ui->hl_attr_define(ui, PTR2INT(argv[1]), *((HlAttrs *)argv[2]),
                      *((HlAttrs *)argv[2]), info);
-  xfree(argv[2]);
 }
 
 static void ui_bridge_raw_line_event(void **argv)
@@ -154,6 +360,10 @@ static void ui_bridge_raw_line_event(void **argv)
   ui->raw_line(ui, PTR2INT(argv[1]), PTR2INT(argv[2]), PTR2INT(argv[3]),
                PTR2INT(argv[4]), PTR2INT(argv[5]), PTR2INT(argv[6]),
                (LineFlags)PTR2INT(argv[7]), argv[8], argv[9]);
+}
+static void ui_bridge_raw_line_free_event(void **argv)
+{
+  ui_bridge_raw_line_event(argv);
   xfree(argv[8]);
   xfree(argv[9]);
 }
@@ -163,12 +373,30 @@ static void ui_bridge_raw_line(UI *ui, Integer grid, Integer row,
                                LineFlags flags, const schar_T *chunk,
                                const sattr_T *attrs)
 {
+  UIBridgeData *bridge = (UIBridgeData *)ui;
   size_t ncol = (size_t)(endcol-startcol);
-  schar_T *c = xmemdup(chunk, ncol * sizeof(schar_T));
-  sattr_T *hl = xmemdup(attrs, ncol * sizeof(sattr_T));
-  UI_BRIDGE_CALL(ui, raw_line, 10, ui, INT2PTR(grid), INT2PTR(row),
-                 INT2PTR(startcol), INT2PTR(endcol), INT2PTR(clearcol),
-                 INT2PTR(clearattr), INT2PTR(flags), c, hl);
+  size_t csize = RING_ALIGN(ncol * sizeof(schar_T));
+  size_t hlsize = ncol * sizeof(sattr_T);
+  if (csize + hlsize > RING_SIZE / 4) {
+    // Very long line: copy it to allocated memory.
+    schar_T *c = xmemdup(chunk, ncol * sizeof(schar_T));
+    sattr_T *hl = xmemdup(attrs, hlsize);
+    UI_BRIDGE_CALL(ui, raw_line_free, 10, ui, INT2PTR(grid), INT2PTR(row),
+                   INT2PTR(startcol), INT2PTR(endcol), INT2PTR(clearcol),
+                   INT2PTR(clearattr), INT2PTR(flags), c, hl);
+    return;
+  }
+  // Copy the cells into the ring, after the record.
+  BridgeRecord *rec = ui_bridge_reserve(bridge, csize + hlsize);
+  schar_T *c = (schar_T *)(rec + 1);
+  sattr_T *hl = (sattr_T *)((char *)c + csize);
+  memcpy(c, chunk, ncol * sizeof(schar_T));
+  memcpy(hl, attrs, hlsize);
+  rec->event = event_create(ui_bridge_raw_line_event, 10, ui, INT2PTR(grid),
+                            INT2PTR(row), INT2PTR(startcol), INT2PTR(endcol),
+                            INT2PTR(clearcol), INT2PTR(clearattr),
+                            INT2PTR(flags), c, hl);
+  ui_bridge_commit(bridge, rec);
 }
 
 static void ui_bridge_suspend(UI *b)
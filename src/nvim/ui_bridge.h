@@ -27,6 +27,24 @@ struct ui_bridge_data {
   // thread finishes handling all events. This flag is set by the UI thread as a
   // signal that it will no longer send messages to the main thread.
   bool stopped;
+  // Calls from the main thread wait in this ring buffer until the UI thread
+  // handles them, see ui_bridge_reserve().  The main thread only writes
+  // ring_head, the UI thread only writes ring_tail.
+  char *ring;
+  size_t ring_head;
+  size_t ring_tail;
+  // A drain event was scheduled on the UI thread and did not start yet.
+  bool ring_pending;
+  // The UI thread is handling calls from the ring.
+  bool ring_draining;
+  // The main thread waits for room in the ring, see ui_bridge_wait().
+  bool ring_waiting;
+  // The UI thread stopped, it will not handle calls anymore.
+  bool ring_stopped;
+  // Protects the fields above when there are no atomic builtins.
+  uv_mutex_t ring_mutex;
+  // Signalled when the UI thread made room in the ring.
+  uv_cond_t ring_cond;
 };
 
 #define CONTINUE(b) \
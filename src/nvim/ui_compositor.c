@@ -20,6 +20,7 @@
 #include "nvim/highlight.h"
 #include "nvim/memory.h"
 #include "nvim/popupmnu.h"
+#include "nvim/schar.h"
 #include "nvim/ui_compositor.h"
 #include "nvim/ugrid.h"
 #include "nvim/screen.h"
@@ -45,6 +46,14 @@ static int chk_width = 0, chk_height = 0;
 
 static ScreenGrid *curgrid;
 
+// Occlusion map: the topmost layer of every cell of the screen.  When a grid
+// is put, moved, raised or removed, only the cells whose topmost layer
+// changed are composed again, and a line drawn under an opaque float is only
+// composed where it shows.
+static ScreenGrid **comp_top = NULL;
+static int comp_top_rows = 0;
+static int comp_top_cols = 0;
+
 static bool valid_screen = true;
 static bool msg_scroll_mode = false;
 static int msg_first_invalid = 0;
@@ -104,6 +113,9 @@ void ui_comp_detach(UI *ui)
     XFREE_CLEAR(linebuf);
     XFREE_CLEAR(attrbuf);
     bufsize = 0;
+    XFREE_CLEAR(comp_top);
+    comp_top_rows = 0;
+    comp_top_cols = 0;
   }
   ui->composed = false;
 }
@@ -122,32 +134,22 @@ bool ui_comp_should_draw(void)
 bool ui_comp_put_grid(ScreenGrid *grid, int row, int col, int height, int width,
                       bool valid, bool on_top)
 {
+  comp_check_layers();
   bool moved;
   if (grid->comp_index != 0) {
     moved = (row != grid->comp_row) || (col != grid->comp_col);
-    if (ui_comp_should_draw()) {
-      // Redraw the area covered by the old position, and is not covered
-      // by the new position. Disable the grid so that compose_area() will not
-      // use it.
-      grid->comp_disabled = true;
-      compose_area(grid->comp_row, row,
-                   grid->comp_col, grid->comp_col + grid->Columns);
-      if (grid->comp_col < col) {
-        compose_area(MAX(row, grid->comp_row),
-                     MIN(row+height, grid->comp_row+grid->Rows),
-                     grid->comp_col, col);
-      }
-      if (col+width < grid->comp_col+grid->Columns) {
-        compose_area(MAX(row, grid->comp_row),
-                     MIN(row+height, grid->comp_row+grid->Rows),
-                     col+width, grid->comp_col+grid->Columns);
-      }
-      compose_area(row+height, grid->comp_row+grid->Rows,
-                   grid->comp_col, grid->comp_col + grid->Columns);
-      grid->comp_disabled = false;
+    if (moved) {
+      int old_row = grid->comp_row;
+      int old_col = grid->comp_col;
+      grid->comp_row = row;
+      grid->comp_col = col;
+      // Compose the grid at its new position, and what it no longer covers
+      // at the old position.
+      comp_damage(row, row+grid->Rows, col, col+grid->Columns,
+                  valid ? grid : NULL, true);
+      comp_damage(old_row, old_row+grid->Rows,
+                  old_col, old_col+grid->Columns, NULL, true);
     }
-    grid->comp_row = row;
-    grid->comp_col = col;
   } else {
     moved = true;
 #ifndef NDEBUG
@@ -178,10 +180,10 @@ bool ui_comp_put_grid(ScreenGrid *grid, int row, int col, int height, int width,
     grid->comp_row = row;
     grid->comp_col = col;
     grid->comp_index = insert_at;
-  }
-  if (moved && valid && ui_comp_should_draw()) {
-    compose_area(grid->comp_row, grid->comp_row+grid->Rows,
-                 grid->comp_col, grid->comp_col+grid->Columns);
+    grid->comp_rows = grid->Rows;
+    grid->comp_cols = grid->Columns;
+    comp_damage(row, row+grid->Rows, col, col+grid->Columns,
+                valid ? grid : NULL, true);
   }
   return moved;
 }
@@ -198,6 +200,7 @@ void ui_comp_remove_grid(ScreenGrid *grid)
     curgrid = &default_grid;
   }
 
+  comp_check_layers();
   for (size_t i = grid->comp_index; i < kv_size(layers)-1; i++) {
     kv_A(layers, i) = kv_A(layers, i+1);
     kv_A(layers, i)->comp_index = i;
@@ -205,9 +208,9 @@ void ui_comp_remove_grid(ScreenGrid *grid)
   (void)kv_pop(layers);
   grid->comp_index = 0;
 
-  // recompose the area under the grid
-  // inefficent when being overlapped: only draw up to grid->comp_index
-  ui_comp_compose_grid(grid);
+  // recompose the area under the grid, where it was on top
+  comp_damage(grid->comp_row, grid->comp_row+grid->Rows,
+              grid->comp_col, grid->comp_col+grid->Columns, NULL, true);
 }
 
 bool ui_comp_set_grid(handle_T handle)
@@ -238,15 +241,9 @@ static void ui_comp_raise_grid(ScreenGrid *grid, size_t new_index)
   }
   kv_A(layers, new_index) = grid;
   grid->comp_index = new_index;
-  for (size_t i = old_index; i < new_index; i++) {
-    ScreenGrid *grid2 = kv_A(layers, i);
-    int startcol = MAX(grid->comp_col, grid2->comp_col);
-    int endcol = MIN(grid->comp_col+grid->Columns,
-                     grid2->comp_col+grid2->Columns);
-    compose_area(MAX(grid->comp_row, grid2->comp_row),
-                 MIN(grid->comp_row+grid->Rows, grid2->comp_row+grid2->Rows),
-                 startcol, endcol);
-  }
+  // compose where the grid now covers the grids it was raised above
+  comp_damage(grid->comp_row, grid->comp_row+grid->Rows,
+              grid->comp_col, grid->comp_col+grid->Columns, NULL, true);
 }
 
 static void ui_comp_grid_cursor_goto(UI *ui, Integer grid_handle,
@@ -320,8 +317,7 @@ static void compose_line(Integer row, Integer startcol, Integer endcol,
     int until = 0;
     for (size_t i = 0; i < kv_size(layers); i++) {
       ScreenGrid *g = kv_A(layers, i);
-      if (g->comp_row > row || row >= g->comp_row + g->Rows
-          || g->comp_disabled) {
+      if (g->comp_row > row || row >= g->comp_row + g->Rows) {
         continue;
       }
       if (g->comp_col <= col && col < g->comp_col+g->Columns) {
@@ -344,30 +340,23 @@ static void compose_line(Integer row, Integer startcol, Integer endcol,
 
     // 'pumblend' and 'winblend'
     if (grid->blending) {
-      for (int i = col-(int)startcol; i < until-startcol; i++) {
-        bool thru = strequal((char *)linebuf[i], " ");  // negative space
-        attrbuf[i] = (sattr_T)hl_blend_attrs(bg_attrs[i], attrbuf[i], &thru);
-        if (thru) {
-          memcpy(linebuf[i], bg_line[i], sizeof(linebuf[i]));
-        }
-      }
+      size_t i = (size_t)(col-startcol);
+      compose_blend(linebuf+i, attrbuf+i, bg_line+i, bg_attrs+i, n);
     }
 
     // Tricky: if overlap caused a doublewidth char to get cut-off, must
     // replace the visible half with a space.
-    if (linebuf[col-startcol][0] == NUL) {
-      linebuf[col-startcol][0] = ' ';
-      linebuf[col-startcol][1] = NUL;
+    if (linebuf[col-startcol] == 0) {
+      linebuf[col-startcol] = SCHAR_SPACE;
       if (col == endcol-1) {
         skipend = 0;
       }
-    } else if (n > 1 && linebuf[col-startcol+1][0] == NUL) {
+    } else if (n > 1 && linebuf[col-startcol+1] == 0) {
       skipstart = 0;
     }
     if (grid->comp_col+grid->Columns > until
-        && grid->chars[off+n][0] == NUL) {
-      linebuf[until-1-startcol][0] = ' ';
-      linebuf[until-1-startcol][1] = '\0';
+        && grid->chars[off+n] == 0) {
+      linebuf[until-1-startcol] = SCHAR_SPACE;
       if (col == startcol && n == 1) {
         skipstart = 0;
       }
@@ -375,7 +364,7 @@ static void compose_line(Integer row, Integer startcol, Integer endcol,
 
     col = until;
   }
-  if (linebuf[endcol-startcol-1][0] == NUL) {
+  if (linebuf[endcol-startcol-1] == 0) {
     skipend = 0;
   }
 
@@ -394,6 +383,36 @@ static void compose_line(Integer row, Integer startcol, Integer endcol,
                             (const sattr_T *)attrbuf+skipstart);
 }
 
+/// Blend `n` cells of a blending grid with the default grid.
+///
+/// Neighbouring cells mostly have the same attributes, the result for the
+/// previous cell is reused then.
+static void compose_blend(schar_T *chars, sattr_T *attrs,
+                          const schar_T *bg_chars, const sattr_T *bg_attrs,
+                          size_t n)
+{
+  int back_attr = -1;
+  int front_attr = -1;
+  bool thru_in = false;
+  bool thru_out = false;
+  int attr = 0;
+  for (size_t i = 0; i < n; i++) {
+    bool thru = chars[i] == SCHAR_SPACE;  // negative space
+    if (bg_attrs[i] != back_attr || attrs[i] != front_attr
+        || thru != thru_in) {
+      back_attr = bg_attrs[i];
+      front_attr = attrs[i];
+      thru_in = thru;
+      attr = hl_blend_attrs(back_attr, front_attr, &thru);
+      thru_out = thru;
+    }
+    attrs[i] = (sattr_T)attr;
+    if (thru_out) {
+      chars[i] = bg_chars[i];
+    }
+  }
+}
+
 static void compose_debug(Integer startrow, Integer endrow, Integer startcol,
                           Integer endcol, int syn_id, bool delay)
 {
@@ -446,10 +465,96 @@ static void compose_area(Integer startrow, Integer endrow,
 /// such as 'pumblend' for popupmenu grid.
 void ui_comp_compose_grid(ScreenGrid *grid)
 {
-  if (ui_comp_should_draw()) {
-    compose_area(grid->comp_row, grid->comp_row+grid->Rows,
-                 grid->comp_col, grid->comp_col+grid->Columns);
+  comp_check_layers();
+  comp_damage(grid->comp_row, grid->comp_row+grid->Rows,
+              grid->comp_col, grid->comp_col+grid->Columns, grid, true);
+}
+
+/// Find the topmost layer at (row, col).
+static ScreenGrid *comp_find_top(int row, int col)
+{
+  for (size_t i = kv_size(layers)-1; i > 0; i--) {
+    ScreenGrid *g = kv_A(layers, i);
+    if (row >= g->comp_row && row < g->comp_row+g->Rows
+        && col >= g->comp_col && col < g->comp_col+g->Columns) {
+      return g;
+    }
   }
+  return &default_grid;
+}
+
+/// Whether a change of `grid` shows in a cell where `top` is the topmost
+/// layer.  A blending layer is blended with the default grid.
+static inline bool comp_shows(ScreenGrid *top, ScreenGrid *grid)
+{
+  return top == grid || (grid == &default_grid && top->blending);
+}
+
+/// Update the occlusion map in an area.
+///
+/// @param dirty    when not NULL, also compose the cells where a change of
+///                 this grid shows
+/// @param compose  compose the cells whose topmost layer changed
+static void comp_damage(int startrow, int endrow, int startcol, int endcol,
+                        ScreenGrid *dirty, bool compose)
+{
+  startrow = MAX(startrow, 0);
+  startcol = MAX(startcol, 0);
+  endrow = MIN(endrow, comp_top_rows);
+  endcol = MIN(endcol, comp_top_cols);
+  compose = compose && ui_comp_should_draw();
+  for (int row = startrow; row < endrow; row++) {
+    ScreenGrid **top = comp_top + (size_t)row * (size_t)comp_top_cols;
+    int from = -1;
+    for (int col = startcol; col <= endcol; col++) {
+      bool changed = false;
+      if (col < endcol) {
+        ScreenGrid *g = comp_find_top(row, col);
+        changed = g != top[col] || (dirty != NULL && comp_shows(g, dirty));
+        top[col] = g;
+      }
+      if (changed && from < 0) {
+        from = col;
+      } else if (!changed && from >= 0) {
+        if (compose) {
+          compose_debug(row, row+1, from, col, dbghl_recompose, true);
+          compose_line(row, from, col, kLineFlagInvalid);
+        }
+        from = -1;
+      }
+    }
+  }
+}
+
+/// Update the occlusion map for grids that were resized since they were
+/// put, and compose the cells that changed.
+static void comp_check_layers(void)
+{
+  for (size_t i = 1; i < kv_size(layers); i++) {
+    ScreenGrid *g = kv_A(layers, i);
+    if (g->comp_rows != g->Rows || g->comp_cols != g->Columns) {
+      int rows = MAX(g->comp_rows, g->Rows);
+      int cols = MAX(g->comp_cols, g->Columns);
+      g->comp_rows = g->Rows;
+      g->comp_cols = g->Columns;
+      comp_damage(g->comp_row, g->comp_row+rows,
+                  g->comp_col, g->comp_col+cols, NULL, true);
+    }
+  }
+}
+
+/// Whether a layer above `grid` overlaps an area.
+static bool comp_covered(ScreenGrid *grid, int startrow, int endrow,
+                         int startcol, int endcol)
+{
+  for (size_t i = grid->comp_index+1; i < kv_size(layers); i++) {
+    ScreenGrid *g = kv_A(layers, i);
+    if (g->comp_row < endrow && startrow < g->comp_row+g->Rows
+        && g->comp_col < endcol && startcol < g->comp_col+g->Columns) {
+      return true;
+    }
+  }
+  return false;
 }
 
 static void ui_comp_raw_line(UI *ui, Integer grid, Integer row,
@@ -471,9 +576,33 @@ static void ui_comp_raw_line(UI *ui, Integer grid, Integer row,
   }
   assert(row < default_grid.Rows);
   assert(clearcol <= default_grid.Columns);
-  if (flags & kLineFlagInvalid
-      || kv_size(layers) > curgrid->comp_index+1
-      || curgrid->blending) {
+  comp_check_layers();
+  bool covered = curgrid->blending
+                 || comp_covered(curgrid, (int)row, (int)row+1,
+                                 (int)startcol, (int)clearcol);
+  if (covered && !(flags & kLineFlagInvalid)
+      && row < comp_top_rows && clearcol <= comp_top_cols) {
+    // Only compose the parts of the line that show.
+    ScreenGrid **top = comp_top + (size_t)row * (size_t)comp_top_cols;
+    int col = (int)startcol;
+    while (col < clearcol) {
+      while (col < clearcol && !comp_shows(top[col], curgrid)) {
+        col++;
+      }
+      int from = col;
+      while (col < clearcol && comp_shows(top[col], curgrid)) {
+        col++;
+      }
+      if (from < col) {
+        LineFlags part_flags = flags;
+        if (from > startcol || col < clearcol) {
+          part_flags &= ~kLineFlagWrap;
+        }
+        compose_debug(row, row+1, from, col, dbghl_composed, true);
+        compose_line(row, from, col, part_flags);
+      }
+    }
+  } else if (covered || flags & kLineFlagInvalid) {
     compose_debug(row, row+1, startcol, clearcol, dbghl_composed, true);
     compose_line(row, startcol, clearcol, flags);
   } else {
@@ -524,17 +653,18 @@ static void ui_comp_grid_scroll(UI *ui, Integer grid, Integer top,
   bot += curgrid->comp_row;
   left += curgrid->comp_col;
   right += curgrid->comp_col;
-  bool covered = kv_size(layers) > curgrid->comp_index+1 || curgrid->blending;
+  comp_check_layers();
+  bool covered = curgrid->blending
+                 || comp_covered(curgrid, (int)top, (int)bot,
+                                 (int)left, (int)right);
   if (!msg_scroll_mode && covered) {
-    // TODO(bfredl):
-    // 1. check if rectangles actually overlap
-    // 2. calulate subareas that can scroll.
+    // TODO(bfredl): calulate subareas that can scroll.
     if (rows > 0) {
       bot -= rows;
     } else {
       top += (-rows);
     }
-    compose_area(top, bot, left, right);
+    comp_damage((int)top, (int)bot, (int)left, (int)right, curgrid, true);
   } else {
     msg_first_invalid = MIN(msg_first_invalid, (int)top);
     ui_composed_call_grid_scroll(1, top, bot, left, right, rows, cols);
@@ -561,6 +691,13 @@ static void ui_comp_grid_resize(UI *ui, Integer grid,
       attrbuf = xmalloc(new_bufsize * sizeof(*attrbuf));
       bufsize = new_bufsize;
     }
+    if (comp_top_rows != height || comp_top_cols != width) {
+      xfree(comp_top);
+      comp_top = xcalloc((size_t)width * (size_t)height, sizeof(*comp_top));
+      comp_top_rows = (int)height;
+      comp_top_cols = (int)width;
+      comp_damage(0, comp_top_rows, 0, comp_top_cols, NULL, false);
+    }
   }
 }
 
@@ -343,6 +343,9 @@ int u_savecommon(linenr_T top, linenr_T bot, linenr_T newbot, int reload)
   u_entry_T   *prev_uep;
   long size;
 
+  // A file that is still being loaded must be complete before it changes.
+  ml_pt_finish_silent(curbuf);
+
   if (!reload) {
     /* When making changes is not allowed return FAIL.  It's a crude way
      * to make all change commands fail. */
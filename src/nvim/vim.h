@@ -166,10 +166,13 @@ enum {
 // Minimal size for block 0 of a swap file.
 // NOTE: This depends on size of struct block0! It's not done with a sizeof(),
 // because struct block0 is defined in memline.c (Sorry).
-// The maximal block size is arbitrary.
+// The maximal block size is the maximum for 'swappagesize'.
 
 #define MIN_SWAP_PAGE_SIZE 1048
-#define MAX_SWAP_PAGE_SIZE 50000
+#define MAX_SWAP_PAGE_SIZE 65536
+
+// Minimal value for 'swappagesize'.
+#define MIN_OPT_SWAP_PAGE_SIZE 4096
 
 
 
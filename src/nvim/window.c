@@ -4574,6 +4574,10 @@ win_free (
   xfree(wp->w_p_cc_cols);
 
   win_free_grid(wp, false);
+  win_linecache_free(wp);
+  win_stl_cache_free(wp);
+  win_search_hl_free(wp);
+  win_vcol_index_free(wp);
 
   if (wp != aucmd_win)
     win_remove(wp, tp);
@@ -6454,6 +6458,7 @@ int match_add(win_T *wp, const char *const grp, const char *const pat,
     prev->next = m;
   m->next = cur;
 
+  win_linecache_clear(wp, 0, 0);
   redraw_later(rtype);
   return id;
 
@@ -6512,6 +6517,7 @@ int match_delete(win_T *wp, int id, int perr)
     rtype = VALID;
   }
   xfree(cur);
+  win_linecache_clear(wp, 0, 0);
   redraw_later(rtype);
   return 0;
 }
@@ -6530,6 +6536,7 @@ void clear_matches(win_T *wp)
     xfree(wp->w_match_head);
     wp->w_match_head = m;
   }
+  win_linecache_clear(wp, 0, 0);
   redraw_later(SOME_VALID);
 }
 
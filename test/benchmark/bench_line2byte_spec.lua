@@ -0,0 +1,66 @@
+-- Benchmark for finding the byte offset of a line and the line of a byte
+-- offset in a large buffer, after changes all over the buffer.
+
+local helpers = require('test.functional.helpers')(after_each)
+local clear, source, eval = helpers.clear, helpers.source, helpers.eval
+local eq, write_file = helpers.eq, helpers.write_file
+
+local fname = 'Xbench-line2byte'
+local line_count = 10000000
+
+local measure_script = [[
+    func! Measure(what, count)
+      let last = line('$')
+      let size = line2byte(last + 1)
+      let sstart = reltime()
+      for i in range(a:count)
+        let lnum = (i * 7919) % last + 1
+        if a:what ==# 'line2byte'
+          call line2byte(lnum)
+        elseif a:what ==# 'byte2line'
+          call byte2line((i * 104729) % size + 1)
+        else
+          " Change the number of lines and bytes in front of the cursor.
+          call append(lnum, 'xxx')
+          call line2byte(lnum + (i * 31) % 1000)
+        endif
+      endfor
+      return printf('%s x %d: %s', a:what, a:count, reltimestr(reltime(sstart)))
+    endfunc]]
+
+describe('line2byte()', function()
+  local results = {}
+
+  setup(function()
+    local lines = {}
+    for i = 1, 100000 do
+      lines[i] = ('x'):rep(i % 80)
+    end
+    local block = table.concat(lines, '\n') .. '\n'
+    write_file(fname, block:rep(line_count / 100000))
+    clear()
+    source(measure_script)
+    helpers.command('edit ' .. fname)
+    eq(line_count, eval("line('$')"))
+  end)
+
+  teardown(function()
+    print('')
+    for _, line in ipairs(results) do
+      print(line)
+    end
+    os.remove(fname)
+  end)
+
+  it('on a 10M-line buffer', function()
+    table.insert(results, eval("Measure('line2byte', 100000)"))
+  end)
+
+  it('byte2line() on a 10M-line buffer', function()
+    table.insert(results, eval("Measure('byte2line', 100000)"))
+  end)
+
+  it('with changes all over a 10M-line buffer', function()
+    table.insert(results, eval("Measure('change', 20000)"))
+  end)
+end)
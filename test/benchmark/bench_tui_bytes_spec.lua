@@ -0,0 +1,74 @@
+-- Benchmark for the number of bytes the TUI sends to the terminal, for
+-- cursor motions and highlighted text.  Runs nvim in a :terminal and reads
+-- the "tui_bytes" stat of that nvim.
+
+local helpers = require('test.functional.helpers')(after_each)
+local thelpers = require('test.functional.terminal.helpers')
+local clear, connect, ok = helpers.clear, helpers.connect, helpers.ok
+local nvim_prog, nvim_set = helpers.nvim_prog, helpers.nvim_set
+
+if helpers.pending_win32(pending) then return end
+
+local socket_name = 'Xbench-tui-bytes.sock'
+local fname = 'src/nvim/tui/tui.c'
+
+describe('TUI output', function()
+  local results = {}
+  local session
+
+  before_each(function()
+    clear()
+    os.remove(socket_name)
+    thelpers.screen_setup(0, '["'..nvim_prog..'", "-u", "NONE", "-i", "NONE",'
+      ..' "--cmd", "'..nvim_set..'", "--listen", "'..socket_name..'"]',
+      80, {rgb=true})
+    helpers.retry(nil, 10000, function()
+      session = connect(socket_name)
+    end)
+    ok(session:request('nvim_command', 'syntax on | edit ' .. fname))
+  end)
+
+  after_each(function()
+    session:close()
+    os.remove(socket_name)
+  end)
+
+  teardown(function()
+    print('')
+    for _, line in ipairs(results) do
+      print(line)
+    end
+  end)
+
+  -- Runs "keys" in normal mode "count" times, drawing a frame each time.
+  local function measure(what, keys, count)
+    local function bytes()
+      helpers.sleep(200)  -- let the TUI write the last frame
+      local _, stats = session:request('nvim__stats')
+      return stats.tui_bytes
+    end
+    local start = bytes()
+    for _ = 1, count do
+      session:request('nvim_command', 'exe "normal! ' .. keys .. '" | redraw')
+    end
+    local total = bytes() - start
+    table.insert(results, ('%s x %d: %d bytes, %d per frame'):format(
+      what, count, total, total / count))
+  end
+
+  it('moving the cursor', function()
+    measure('j', 'j', 200)
+    measure('w', 'w', 200)
+    measure('}', '}', 100)
+  end)
+
+  it('scrolling', function()
+    measure('<C-E>', '\\<C-E>', 200)
+    measure('<C-D>', '\\<C-D>', 50)
+  end)
+
+  it('changing highlighted text', function()
+    measure('Vj', 'Vj\\<Esc>j', 100)
+    measure('~', '0~', 100)
+  end)
+end)
@@ -14,6 +14,7 @@ local meth_pcall = helpers.meth_pcall
 local command = helpers.command
 local bufmeths = helpers.bufmeths
 local feed = helpers.feed
+local source = helpers.source
 
 describe('api/buf', function()
   before_each(clear)
@@ -284,6 +285,60 @@ describe('api/buf', function()
       end
     end)
 
+    it('works with many lines filling several blocks', function()
+      local lines = {}
+      for i = 1, 5000 do
+        lines[i] = ('line %d '):format(i) .. ('x'):rep(i % 97)
+      end
+      set_lines(0, -1, true, {'first', 'last'})
+      set_lines(1, 1, true, lines)
+      eq(5002, curbufmeths.line_count())
+      eq({'first', lines[1], lines[2]}, get_lines(0, 3, true))
+      eq({lines[2500], lines[2501]}, get_lines(2500, 2502, true))
+      eq({lines[5000], 'last'}, get_lines(-3, -1, true))
+      eq(get_lines(0, -1, true), funcs.getline(1, '$'))
+      eq(6 + 9 + 1, funcs.line2byte(3))
+      set_lines(2, 2, true, lines)
+      eq(10002, curbufmeths.line_count())
+      eq({lines[1], lines[1], lines[2]}, get_lines(1, 4, true))
+      eq({lines[4999], lines[5000], lines[2]}, get_lines(5000, 5003, true))
+    end)
+
+    it('keeps byte offsets after inserting many lines in the middle',
+    function()
+      local function lines_of(n, text)
+        local lines = {}
+        for i = 1, n do
+          lines[i] = (text .. ' %d '):format(i) .. ('x'):rep(i % 53)
+        end
+        return lines
+      end
+      set_lines(0, -1, true, lines_of(1000, 'old'))
+      -- spans several chunks of 800 lines, splits the chunk it goes in
+      set_lines(500, 500, true, lines_of(2000, 'new'))
+      local all = get_lines(0, -1, true)
+      eq(3000, #all)
+      local offsets, offset = {}, 1
+      for i, line in ipairs(all) do
+        offsets[i] = offset
+        offset = offset + #line + 1
+      end
+      offsets[#all + 1] = offset
+      eq(offsets, funcs.eval(
+        "map(range(1, line('$') + 1), 'line2byte(v:val)')"))
+      local starts = {}
+      for i = 1, #all do
+        starts[i] = i
+      end
+      eq(starts, funcs.eval(
+        "map(range(1, line('$')), 'byte2line(line2byte(v:val))')"))
+      -- last byte of a line, around where chunks are split
+      for _, lnum in ipairs({399, 400, 401, 500, 501, 800, 1201, 2500, 2999}) do
+        eq(lnum, funcs.byte2line(offsets[lnum + 1] - 1))
+        eq(offsets[lnum] - 1, curbufmeths.get_offset(lnum - 1))
+      end
+    end)
+
     it('can get line ranges with non-strict indexing', function()
       set_lines(0, -1, true, {'a', 'b', 'c'})
       eq({'a', 'b', 'c'}, get_lines(0, -1, true)) --sanity
@@ -424,6 +479,34 @@ describe('api/buf', function()
       command("bunload! 1")
       eq(-1, bufmeths.get_offset(1,1))
     end)
+
+    it('is correct after many changes', function()
+      source([[
+        call setline(1, map(range(1, 5000), 'repeat("x", v:val % 37)'))
+        let s:seed = 1
+        for i in range(2000)
+          let s:seed = (s:seed * 1103515245 + 12345) % 2147483648
+          let lnum = s:seed % line('$') + 1
+          if i % 3 == 0
+            execute lnum . ',' . min([lnum + 10, line('$')]) . 'delete'
+          elseif i % 3 == 1
+            call append(lnum, repeat(['yy'], i % 23))
+          else
+            call setline(lnum, repeat('z', i % 91))
+          endif
+        endfor
+      ]])
+      local lines = curbufmeths.get_lines(0, -1, true)
+      local offset = 0
+      for i, line in ipairs(lines) do
+        if i % 97 == 1 then
+          eq(offset, get_offset(i - 1))
+          eq(i, funcs.byte2line(offset + 1))
+        end
+        offset = offset + #line + 1
+      end
+      eq(offset, get_offset(#lines))
+    end)
   end)
 
   describe('nvim_buf_get_var, nvim_buf_set_var, nvim_buf_del_var', function()
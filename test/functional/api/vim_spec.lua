@@ -1307,6 +1307,7 @@ describe('API', function()
           ext_multigrid = false,
           ext_hlstate = false,
           ext_termcolors = false,
+          ext_packedlines = false,
           ext_messages = false,
           height = 4,
           rgb = true,
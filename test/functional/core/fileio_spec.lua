@@ -12,6 +12,8 @@ local rmdir = helpers.rmdir
 local sleep = helpers.sleep
 local read_file = helpers.read_file
 local trim = helpers.trim
+local write_file = helpers.write_file
+local lfs = require('lfs')
 
 describe('fileio', function()
   before_each(function()
@@ -87,5 +89,141 @@ describe('fileio', function()
     eq('foo', bar_contents);
 
   end)
-end)
 
+  it('writes the swap file when idle', function()
+    clear({ args={ '-i', 'Xtest_startup_shada',
+                   '--cmd', 'set directory=Xtest_startup_swapdir' } })
+
+    command('set swapfile updatetime=9999')
+    command('edit Xtest_startup_file1')
+    command('call setline(1, map(range(1, 20000), "\'line \' . v:val"))')
+    command('write')
+    local swapname = funcs.swapname('%')
+    command('set updatetime=1')
+    feed('Gochanged at the end<esc>')
+    retry(nil, 3000, function()
+      local swap = read_file(swapname) or ''
+      eq(true, swap:find('changed at the end', 1, true) ~= nil)
+    end)
+    -- Blocks read back after the worker wrote them are intact.
+    command('set swapcache=16')
+    command('%s/^line/LINE/')
+    eq('LINE 1', funcs.getline(1))
+    eq('LINE 20000', funcs.getline(20000))
+    eq('changed at the end', funcs.getline('$'))
+  end)
+
+  it("'swapcache' swaps out blocks", function()
+    clear({ args={ '-i', 'Xtest_startup_shada',
+                   '--cmd', 'set directory=Xtest_startup_swapdir' } })
+
+    command('set swapfile swappagesize=16384')
+    command('edit Xtest_startup_file1')
+    command('call setline(1, map(range(1, 50000), "v:val . repeat(\'x\', 40)"))')
+    eq(0, request('nvim__stats').mf_evict)
+    command('set swapcache=64')
+    command('call setline(1, "first")')
+    command('%s/x$/y/')
+    local stats = request('nvim__stats')
+    eq(true, stats.mf_evict > 0)
+    eq(true, stats.mf_miss > 0)
+    eq(true, stats.mf_hit > 0)
+    eq('2' .. ('x'):rep(39) .. 'y', funcs.getline(2))
+    eq('50000' .. ('x'):rep(39) .. 'y', funcs.getline(50000))
+    command('write')
+    eq(50000, #read_file('Xtest_startup_file1'):gsub('[^\n]', ''))
+  end)
+
+  it('reloads only the changed lines', function()
+    clear()
+    local lines = {}
+    for i = 1, 100000 do
+      lines[i] = 'line ' .. i
+    end
+    write_file('Xtest_startup_file1', table.concat(lines, '\n') .. '\n', true)
+    command('edit Xtest_startup_file1')
+    command('set autoread undoreload=100000')
+    command('5mark a')
+    command('99000mark b')
+
+    -- Appended lines.
+    write_file('Xtest_startup_file1', 'line 100001\nline 100002', false, true)
+    lfs.touch('Xtest_startup_file1', os.time() + 10, os.time() + 10)
+    command('checktime')
+    eq(100002, funcs.line('$'))
+    eq('line 100002', funcs.getline('$'))
+    eq(0, funcs.eval('&endofline'))
+    eq(0, funcs.eval('&modified'))
+    eq(5, funcs.line("'a"))
+    eq(99000, funcs.line("'b"))
+
+    -- Changed line in the middle.
+    lines[50000] = 'changed'
+    write_file('Xtest_startup_file1', table.concat(lines, '\n') .. '\n', true)
+    lfs.touch('Xtest_startup_file1', os.time() + 20, os.time() + 20)
+    command('checktime')
+    eq(100000, funcs.line('$'))
+    eq('changed', funcs.getline(50000))
+    eq('line 100000', funcs.getline('$'))
+    eq(1, funcs.eval('&endofline'))
+    eq(5, funcs.line("'a"))
+    command('undo')
+    eq('line 50000', funcs.getline(50000))
+    eq(100002, funcs.line('$'))
+  end)
+
+  it('reloads the changed lines of a nomodifiable buffer', function()
+    clear()
+    local lines = {}
+    for i = 1, 1000 do
+      lines[i] = 'line ' .. i
+    end
+    write_file('Xtest_startup_file1', table.concat(lines, '\n') .. '\n', true)
+    command('edit Xtest_startup_file1')
+    command('set autoread nomodifiable undoreload=100')
+    command('let g:events = []')
+    command('autocmd BufReadPre * call add(g:events, "pre")')
+    command('autocmd BufReadPost * call add(g:events, "post")')
+
+    -- A line before the old end changed, and the file grew.
+    lines[2] = 'changed'
+    lines[1001] = 'line 1001'
+    write_file('Xtest_startup_file1', table.concat(lines, '\n') .. '\n', true)
+    lfs.touch('Xtest_startup_file1', os.time() + 10, os.time() + 10)
+    command('checktime')
+    eq('changed', funcs.getline(2))
+    eq(1001, funcs.line('$'))
+    eq(0, funcs.eval('&modified'))
+    eq({'pre', 'post'}, funcs.eval('g:events'))
+    -- More lines than 'undoreload': the undo history was cleared.
+    eq(0, funcs.eval('undotree().seq_last'))
+  end)
+
+  it('reloads the changed lines of a readonly buffer', function()
+    clear()
+    local lines = {}
+    for i = 1, 1000 do
+      lines[i] = 'line ' .. i
+    end
+    write_file('Xtest_startup_file1', table.concat(lines, '\n') .. '\n', true)
+    command('view Xtest_startup_file1')
+    command('set autoread')
+    command('let g:ro = 0')
+    command('autocmd FileChangedRO * let g:ro += 1')
+
+    lines[500] = 'changed'
+    lines[1001] = 'line 1001'
+    write_file('Xtest_startup_file1', table.concat(lines, '\n') .. '\n', true)
+    lfs.touch('Xtest_startup_file1', os.time() + 10, os.time() + 10)
+    command('checktime')
+    eq('changed', funcs.getline(500))
+    eq(1001, funcs.line('$'))
+    eq(1, funcs.eval('&readonly'))
+    eq(0, funcs.eval('&modified'))
+    -- Not a change by the user: no warning, no '. mark or changelist entry.
+    eq(0, funcs.eval('g:ro'))
+    eq(nil, string.find(funcs.execute('messages'), 'W10'))
+    eq(0, funcs.line("'."))
+    eq({}, funcs.getchangelist('%')[1])
+  end)
+end)
@@ -10,6 +10,7 @@ local feed_command = helpers.feed_command
 local funcs = helpers.funcs
 local meths = helpers.meths
 local iswin = helpers.iswin
+local read_file = helpers.read_file
 
 local fname = 'Xtest-functional-ex_cmds-write'
 local fname_bak = fname .. '~'
@@ -92,6 +93,20 @@ describe(':write', function()
     fifo:close()
   end)
 
+  it('writes and converts many lines', function()
+    command('call setline(1, map(range(1, 30000), "v:val . \' \\u00e9\'"))')
+    local expected = {}
+    for i = 1, 30000 do
+      expected[i] = i .. ' \233'
+    end
+    command('write ++enc=latin1 ' .. fname)
+    eq(table.concat(expected, '\n') .. '\n', read_file(fname))
+    command('set fileformat=dos')
+    command('write! ++enc=utf-8 ' .. fname)
+    local dos = table.concat(expected, '\r\n') .. '\r\n'
+    eq((dos:gsub('\233', '\195\169')), read_file(fname))
+  end)
+
   it('errors out correctly', function()
     command('let $HOME=""')
     eq(funcs.fnamemodify('.', ':p:h'), funcs.fnamemodify('.', ':p:h:~'))
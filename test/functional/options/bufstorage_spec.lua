@@ -0,0 +1,171 @@
+local helpers = require('test.functional.helpers')(after_each)
+local clear, command, eq, eval, funcs = helpers.clear, helpers.command,
+  helpers.eq, helpers.eval, helpers.funcs
+local exc_exec = helpers.exc_exec
+local write_file = helpers.write_file
+local read_file = helpers.read_file
+local retry = helpers.retry
+local lfs = require('lfs')
+
+local fname = 'Xtest-functional-options-bufstorage'
+
+describe("'bufstorage'", function()
+  before_each(function()
+    clear()
+    os.remove(fname)
+  end)
+  after_each(function()
+    os.remove(fname)
+  end)
+
+  it('defaults to "memline" and checks the value', function()
+    eq('memline', eval('&bufstorage'))
+    command('setlocal bufstorage=piecetable')
+    eq('piecetable', eval('&l:bufstorage'))
+    eq('Vim(setlocal):E474: Invalid argument: bufstorage=rope',
+       exc_exec('setlocal bufstorage=rope'))
+  end)
+
+  it('"piecetable" reads, changes and writes a file', function()
+    local lines = {}
+    for i = 1, 1000 do
+      lines[i] = 'line ' .. i
+    end
+    write_file(fname, table.concat(lines, '\n') .. '\n')
+    command('set bufstorage=piecetable')
+    command('edit ' .. fname)
+    eq(1000, funcs.line('$'))
+    eq('line 1', funcs.getline(1))
+    eq('line 500', funcs.getline(500))
+    eq('line 1000', funcs.getline(1000))
+    eq(8, funcs.line2byte(2))
+    eq(2, funcs.byte2line(8))
+    eq(1, funcs.byte2line(7))
+
+    command('2,999delete')
+    command('1put =\'added\'')
+    command('$substitute/line/last/')
+    eq({'line 1', 'added', 'last 1000'}, funcs.getline(1, '$'))
+    eq(14, funcs.line2byte(3))
+    command('undo')
+    eq('line 1000', funcs.getline(3))
+    command('undo')
+    command('undo')
+    eq(1000, funcs.line('$'))
+    eq('line 999', funcs.getline(999))
+
+    command('global/0$/delete')
+    eq(900, funcs.line('$'))
+    command('write')
+    local expected = {}
+    for i = 1, 1000 do
+      if i % 10 ~= 0 then
+        table.insert(expected, 'line ' .. i)
+      end
+    end
+    eq(table.concat(expected, '\n') .. '\n', read_file(fname))
+  end)
+
+  it('"piecetable" indexes a large file in the background', function()
+    local lines = {}
+    for i = 1, 800000 do
+      lines[i] = 'line ' .. i
+    end
+    -- More than 8 Mbyte, indexed in steps.
+    write_file(fname, table.concat(lines, '\n'))
+    command('set bufstorage=piecetable')
+    command('edit ' .. fname)
+    eq('line 1', funcs.getline(1))
+    -- a line number does not wait for indexing, "$" does
+    retry(nil, 10000, function()
+      eq('line 800000', funcs.getline(800000))
+    end)
+    eq(800000, funcs.line('$'))
+    eq(0, eval('&endofline'))
+  end)
+
+  it('"piecetable" indexes the whole file for a range or "$"', function()
+    local lines = {}
+    for i = 1, 800000 do
+      lines[i] = 'line ' .. i
+    end
+    write_file(fname, table.concat(lines, '\n') .. '\n')
+    command('set bufstorage=piecetable')
+    command('edit ' .. fname)
+    eq(800000, funcs.line('$'))
+    command('edit! ' .. fname .. ' | %substitute/line/x/')
+    eq('x 800000', funcs.getline(800000))
+    command('edit! ' .. fname .. ' | %delete')
+    eq({''}, funcs.getline(1, '$'))
+    command('edit! ' .. fname .. ' | $delete')
+    eq('line 799999', funcs.getline('$'))
+    command('edit! ' .. fname)
+    helpers.feed('G')
+    eq(800000, funcs.line('.'))
+  end)
+
+  it('"piecetable" indexes the whole file before a change', function()
+    local lines = {}
+    for i = 1, 800000 do
+      lines[i] = 'line ' .. i
+    end
+    write_file(fname, table.concat(lines, '\n') .. '\n')
+    command('set bufstorage=piecetable')
+    command('edit ' .. fname .. ' | 1delete')
+    eq(799999, funcs.line('$'))
+    eq('line 800000', funcs.getline('$'))
+  end)
+
+  it('"piecetable" checks the whole file for a NL without a CR', function()
+    local lines = {}
+    for i = 1, 800000 do
+      lines[i] = 'line ' .. i
+    end
+    -- only the line break after 8 Mbyte has no CR
+    local text = table.concat(lines, '\r\n') .. '\nlast\r\n'
+    write_file(fname, text)
+    command('set bufstorage=piecetable fileformats=unix,dos')
+    command('edit ' .. fname)
+    eq('unix', eval('&fileformat'))
+    eq(800001, funcs.line('$'))
+    eq('line 800000\r', funcs.getline(800000))
+    command('write')
+    eq(text, read_file(fname))
+  end)
+
+  it('"piecetable" handles dos format and a missing last line break',
+  function()
+    write_file(fname, 'one\r\ntwo\r\nthree')
+    command('set bufstorage=piecetable fileformats=unix,dos')
+    command('edit ' .. fname)
+    eq('dos', eval('&fileformat'))
+    eq(0, eval('&endofline'))
+    eq({'one', 'two', 'three'}, funcs.getline(1, '$'))
+    eq(6, funcs.line2byte(2))
+    command('write')
+    eq('one\r\ntwo\r\nthree\r\n', read_file(fname))
+  end)
+
+  it('"piecetable" is not used for a file read as latin1', function()
+    write_file(fname, 'caf\233\nna\239ve\n')
+    command('set bufstorage=piecetable fileencodings=latin1')
+    command('edit ' .. fname)
+    eq('latin1', eval('&fileencoding'))
+    eq({'café', 'naïve'}, funcs.getline(1, '$'))
+  end)
+
+  it('"piecetable" marks the buffer modified when the file is truncated',
+  function()
+    write_file(fname, 'one\ntwo\nthree\n')
+    command('set bufstorage=piecetable noautoread')
+    command('edit ' .. fname)
+    command('autocmd FileChangedShell * let g:reason = v:fcs_reason')
+    write_file(fname, 'one\n')
+    lfs.touch(fname, os.time() + 10, os.time() + 10)
+    command('checktime')
+    eq('conflict', eval('g:reason'))
+    eq(1, eval('&modified'))
+    eq(3, funcs.line('$'))
+    eq('one', funcs.getline(1))
+  end)
+end)
@@ -0,0 +1,144 @@
+local helpers = require('test.functional.helpers')(after_each)
+local clear, command, eq, eval, funcs = helpers.clear, helpers.command,
+  helpers.eq, helpers.eval, helpers.funcs
+local meths = helpers.meths
+local write_file = helpers.write_file
+local retry = helpers.retry
+
+local fname = 'Xtest-functional-options-followfile'
+
+describe("'followfile'", function()
+  before_each(function()
+    clear()
+    os.remove(fname)
+  end)
+  after_each(function()
+    os.remove(fname)
+  end)
+
+  it('is off by default', function()
+    eq(0, eval('&followfile'))
+  end)
+
+  it('appends the lines added to the file', function()
+    write_file(fname, 'one\ntwo\n')
+    command('edit ' .. fname)
+    command('setlocal followfile')
+    write_file(fname, 'three\nfour\n', true, true)
+    retry(nil, 5000, function()
+      eq({'one', 'two', 'three', 'four'}, funcs.getline(1, '$'))
+    end)
+    eq(0, eval('&modified'))
+    write_file(fname, 'five\n', true, true)
+    retry(nil, 5000, function()
+      eq('five', funcs.getline('$'))
+    end)
+    eq(5, funcs.line('$'))
+  end)
+
+  it('completes a last line without a line break', function()
+    write_file(fname, 'one\ntw')
+    command('edit ' .. fname)
+    command('setlocal followfile')
+    write_file(fname, 'o\nthree\n', true, true)
+    retry(nil, 5000, function()
+      eq({'one', 'two', 'three'}, funcs.getline(1, '$'))
+    end)
+  end)
+
+  it('appends to a nomodifiable buffer as one undo change', function()
+    write_file(fname, 'one\n')
+    command('edit ' .. fname)
+    command('setlocal followfile nomodifiable')
+    write_file(fname, 'two\n', true, true)
+    retry(nil, 5000, function()
+      eq(2, funcs.line('$'))
+    end)
+    write_file(fname, 'three\n', true, true)
+    retry(nil, 5000, function()
+      eq(3, funcs.line('$'))
+    end)
+    command('undo')
+    eq({'one'}, funcs.getline(1, '$'))
+  end)
+
+  it('appends to a readonly buffer without a warning', function()
+    write_file(fname, 'one\n')
+    command('view ' .. fname)
+    command('setlocal followfile')
+    command('let g:ro = 0')
+    command('autocmd FileChangedRO * let g:ro += 1')
+    write_file(fname, 'two\n', true, true)
+    retry(nil, 5000, function()
+      eq(2, funcs.line('$'))
+    end)
+    write_file(fname, 'three\n', true, true)
+    retry(nil, 5000, function()
+      eq(3, funcs.line('$'))
+    end)
+    eq(1, eval('&readonly'))
+    eq(0, eval('&modified'))
+    eq(0, eval('g:ro'))
+    eq(nil, string.find(funcs.execute('messages'), 'W10'))
+    eq(0, funcs.line("'."))
+    eq({}, funcs.getchangelist('%')[1])
+  end)
+
+  it('sends the appended lines to buffer update callbacks', function()
+    write_file(fname, 'one\n')
+    command('edit ' .. fname)
+    command('setlocal followfile')
+    meths.execute_lua([[
+      events = {}
+      vim.api.nvim_buf_attach(0, false, {
+        on_lines = function(_, _, _, first, last, new_last)
+          table.insert(events, {first, last, new_last})
+        end,
+      })
+    ]], {})
+    write_file(fname, 'two\nthree\n', true, true)
+    retry(nil, 5000, function()
+      eq({{1, 1, 3}}, meths.execute_lua('return events', {}))
+    end)
+    eq({'one', 'two', 'three'}, funcs.getline(1, '$'))
+  end)
+
+  it('reads the new file after the file was renamed', function()
+    write_file(fname, 'one\ntwo\n')
+    command('edit ' .. fname)
+    command('setlocal followfile')
+    os.rename(fname, fname .. '.1')
+    write_file(fname, 'new one\nnew two\nnew three\n')
+    retry(nil, 5000, function()
+      eq({'new one', 'new two', 'new three'}, funcs.getline(1, '$'))
+    end)
+    write_file(fname, 'new four\n', true, true)
+    retry(nil, 5000, function()
+      eq('new four', funcs.getline('$'))
+    end)
+    os.remove(fname .. '.1')
+  end)
+
+  it('watches the file with the new name of the buffer', function()
+    write_file(fname, 'one\n')
+    command('edit ' .. fname)
+    command('setlocal followfile')
+    write_file(fname .. '.2', 'one\n')
+    command('file ' .. fname .. '.2')
+    write_file(fname .. '.2', 'two\n', true, true)
+    retry(nil, 5000, function()
+      eq({'one', 'two'}, funcs.getline(1, '$'))
+    end)
+    os.remove(fname .. '.2')
+  end)
+
+  it('reloads a file that was truncated', function()
+    write_file(fname, 'one\ntwo\nthree\n')
+    command('edit ' .. fname)
+    command('setlocal followfile')
+    write_file(fname, 'new\n')
+    retry(nil, 5000, function()
+      eq({'new'}, funcs.getline(1, '$'))
+    end)
+  end)
+end)
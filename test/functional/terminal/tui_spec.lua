@@ -86,6 +86,67 @@ describe('TUI', function()
     ]])
   end)
 
+  it('draws changed cells next to double-width chars', function()
+    feed_data('iabcＸＹZ\027')
+    screen:expect([[
+      abcＸＹ{1:Z}                                          |
+      {4:~                                                 }|
+      {4:~                                                 }|
+      {4:~                                                 }|
+      {5:[No Name] [+]                                     }|
+                                                        |
+      {3:-- TERMINAL --}                                    |
+    ]])
+    feed_data('03lr1')
+    screen:expect([[
+      abc{1:1}ＹZ                                           |
+      {4:~                                                 }|
+      {4:~                                                 }|
+      {4:~                                                 }|
+      {5:[No Name] [+]                                     }|
+                                                        |
+      {3:-- TERMINAL --}                                    |
+    ]])
+    feed_data('rＸ')
+    screen:expect([[
+      abc{1:Ｘ}ＹZ                                          |
+      {4:~                                                 }|
+      {4:~                                                 }|
+      {4:~                                                 }|
+      {5:[No Name] [+]                                     }|
+                                                        |
+      {3:-- TERMINAL --}                                    |
+    ]])
+    -- CTRL-L draws all of it again.
+    feed_data('\012')
+    screen:expect([[
+      abc{1:Ｘ}ＹZ                                          |
+      {4:~                                                 }|
+      {4:~                                                 }|
+      {4:~                                                 }|
+      {5:[No Name] [+]                                     }|
+                                                        |
+      {3:-- TERMINAL --}                                    |
+    ]])
+  end)
+
+  it('scrolls while the terminal does not take the output', function()
+    feed_data(':for i in range(1, 2000) | call append("$", "line " . i)'
+              ..' | $ | redraw | endfor\r')
+    -- Stop reading the output for a while, the TUI merges the frames.
+    command('lua local t = os.clock() while os.clock() - t < 0.5 do end')
+    feed_data(':echo "done"\r')
+    screen:expect([[
+      line 1997                                         |
+      line 1998                                         |
+      line 1999                                         |
+      {1:l}ine 2000                                         |
+      {5:[No Name] [+]                                     }|
+      done                                              |
+      {3:-- TERMINAL --}                                    |
+    ]])
+  end)
+
   it('interprets leading <Esc> byte as ALT modifier in normal-mode', function()
     local keys = 'dfghjkl'
     for c in keys:gmatch('.') do
@@ -304,6 +365,33 @@ describe('TUI', function()
     ]])
   end)
 
+  it('draws a frame larger than the output buffer as one synchronized update',
+  function()
+    local screen = thelpers.screen_setup(0, '"'..nvim_prog
+      ..' -u NONE -i NONE --cmd \'set noswapfile lines=100 columns=300\''
+      ..' | cat > testF"')
+    -- 99 lines of 300 three-byte chars, more than OUTBUF_SIZE.
+    feed_data(':call setline(1, map(range(100), '
+              ..'\'repeat(nr2char(8364), 300)\'))\r')
+    feed_data(':qa!\r')
+    screen:expect({any='%[Process exited 0%]'})
+    local out = read_file('testF')
+    local euro = '\226\130\172'
+    local first = out:find(euro, 1, true)
+    local last, count = first, 0
+    local pos = first
+    while pos do
+      last, count = pos, count + 1
+      pos = out:find(euro, pos + 3, true)
+    end
+    ok(count * 3 > 0xffff)
+    -- All of it is between one begin and end of a synchronized update.
+    local frame_begin = out:sub(1, first):match('.*()\027%[%?2026h')
+    ok(frame_begin ~= nil)
+    local frame_end = out:find('\027[?2026l', frame_begin, true)
+    ok(frame_end ~= nil and frame_end > last)
+  end)
+
   it('<C-h> #10134', function()
     local screen = thelpers.screen_setup(0, '["'..nvim_prog
       ..[[", "-u", "NONE", "-i", "NONE", "--cmd", "set noruler", "--cmd", ':nnoremap <C-h> :echomsg "\<C-h\>"<CR>']]..']')
@@ -0,0 +1,96 @@
+local helpers = require('test.functional.helpers')(after_each)
+local Screen = require('test.functional.ui.screen')
+local clear, meths = helpers.clear, helpers.meths
+
+describe('compositor', function()
+  local screen
+
+  before_each(function()
+    clear()
+    screen = Screen.new(20, 6)
+    screen:attach()
+    local lines = {}
+    for i = 1, 5 do
+      table.insert(lines, string.rep(tostring(i), 20))
+    end
+    meths.buf_set_lines(0, 0, -1, true, lines)
+  end)
+
+  after_each(function()
+    screen:detach()
+  end)
+
+  local function float(text, row, col)
+    local buf = meths.create_buf(false, false)
+    meths.buf_set_lines(buf, 0, -1, true, {text, text})
+    return meths.open_win(buf, false, {relative='editor', width=6, height=2,
+                                       row=row, col=col})
+  end
+
+  it("shows the text under a float with 'winblend'", function()
+    local a = float('AA', 1, 2)
+    meths.win_set_option(a, 'winblend', 30)
+    screen:expect([[
+      ^11111111111111111111|
+      22AA2222222222222222|
+      33AA3333333333333333|
+      44444444444444444444|
+      55555555555555555555|
+                          |
+    ]])
+    meths.buf_set_lines(0, 1, 3, true, {string.rep('x', 20),
+                                        string.rep('y', 20)})
+    screen:expect([[
+      ^11111111111111111111|
+      xxAAxxxxxxxxxxxxxxxx|
+      yyAAyyyyyyyyyyyyyyyy|
+      44444444444444444444|
+      55555555555555555555|
+                          |
+    ]])
+  end)
+
+  it('composes only what changed when floats overlap', function()
+    local a = float('AAAAAA', 1, 2)
+    local b = float('BBBBBB', 2, 5)
+    screen:expect([[
+      ^11111111111111111111|
+      22AAAAAA222222222222|
+      33AAABBBBBB333333333|
+      44444BBBBBB444444444|
+      55555555555555555555|
+                          |
+    ]])
+
+    meths.win_set_config(a, {relative='editor', row=1, col=12})
+    screen:expect([[
+      ^11111111111111111111|
+      222222222222AAAAAA22|
+      33333BBBBBB3AAAAAA33|
+      44444BBBBBB444444444|
+      55555555555555555555|
+                          |
+    ]])
+
+    -- drawn under the float, only shows next to it
+    meths.buf_set_lines(0, 3, 4, true, {string.rep('x', 20)})
+    screen:expect([[
+      ^11111111111111111111|
+      222222222222AAAAAA22|
+      33333BBBBBB3AAAAAA33|
+      xxxxxBBBBBBxxxxxxxxx|
+      55555555555555555555|
+                          |
+    ]])
+
+    meths.win_close(b, true)
+    screen:expect([[
+      ^11111111111111111111|
+      222222222222AAAAAA22|
+      333333333333AAAAAA33|
+      xxxxxxxxxxxxxxxxxxxx|
+      55555555555555555555|
+                          |
+    ]])
+  end)
+end)
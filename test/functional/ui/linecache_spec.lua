@@ -0,0 +1,62 @@
+local helpers = require('test.functional.helpers')(after_each)
+local Screen = require('test.functional.ui.screen')
+local clear, command = helpers.clear, helpers.command
+local funcs, meths = helpers.funcs, helpers.meths
+
+describe('drawing lines that were drawn before', function()
+  local screen
+
+  before_each(function()
+    clear()
+    screen = Screen.new(20, 5)
+    screen:attach()
+    screen:set_default_attr_ids({
+      [1] = {background = Screen.colors.Yellow},
+      [2] = {foreground = Screen.colors.DarkBlue, background = Screen.colors.Grey},
+      [3] = {foreground = Screen.colors.Grey100, background = Screen.colors.Red},
+    })
+    command('set signcolumn=yes')
+    command('sign define piet text=>> texthl=Search')
+    local lines = {}
+    for i = 1, 20 do
+      lines[i] = 'line ' .. i
+    end
+    funcs.setline(1, lines)
+  end)
+
+  after_each(function()
+    screen:detach()
+  end)
+
+  it('shows what changed while the lines were not shown', function()
+    command('normal! 10Gzt')
+    screen:expect([[
+      {2:  }^line 10           |
+      {2:  }line 11           |
+      {2:  }line 12           |
+      {2:  }line 13           |
+                          |
+    ]])
+    command('sign place 1 line=2 name=piet buffer=1')
+    meths.buf_add_highlight(0, -1, 'ErrorMsg', 2, 0, 4)
+    meths.buf_set_lines(0, 3, 4, true, {'changed'})
+    command('normal! gg')
+    screen:expect([[
+      {2:  }^line 1            |
+      {1:>>}line 2            |
+      {2:  }{3:line} 3            |
+      {2:  }changed           |
+                          |
+    ]])
+    command('normal! 10Gzt')
+    funcs.matchadd('Search', 'changed')
+    command('normal! gg')
+    screen:expect([[
+      {2:  }^line 1            |
+      {1:>>}line 2            |
+      {2:  }{3:line} 3            |
+      {2:  }{1:changed}           |
+                          |
+    ]])
+  end)
+end)
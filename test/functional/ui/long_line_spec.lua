@@ -0,0 +1,73 @@
+local helpers = require('test.functional.helpers')(after_each)
+local Screen = require('test.functional.ui.screen')
+local clear, command, eq, eval = helpers.clear, helpers.command, helpers.eq,
+  helpers.eval
+local feed, meths = helpers.feed, helpers.meths
+
+describe('long line', function()
+  local screen
+
+  before_each(function()
+    clear()
+    screen = Screen.new(20, 4)
+    screen:attach()
+    -- Tabs and double-width characters all over a line of some 20000 bytes.
+    local chunk = 'ab\tc' .. 'Ｘ' .. string.rep('d', 50)
+    meths.buf_set_lines(0, 0, -1, true, {string.rep(chunk, 350) .. 'END'})
+  end)
+
+  after_each(function()
+    screen:detach()
+  end)
+
+  -- Virtual columns of a few positions, with and without the checkpoints
+  -- that skip most of the line.
+  local function vcols()
+    local res = {}
+    for _, col in ipairs({1, 2000, 10001, 19999, 20000}) do
+      table.insert(res, eval('virtcol([1, ' .. col .. '])'))
+    end
+    table.insert(res, eval('virtcol([1, "$"])'))
+    return res
+  end
+
+  it('has the same virtual columns as when walking the whole line', function()
+    command('set nowrap')
+    local indexed = vcols()
+    command('set linebreak')
+    eq(vcols(), indexed)
+    command('set nolinebreak tabstop=3')
+    local indexed3 = vcols()
+    command('set linebreak')
+    eq(vcols(), indexed3)
+    command('set nolinebreak wrap')
+    local wrapped = vcols()
+    command('set linebreak')
+    eq(vcols(), wrapped)
+  end)
+
+  it('shows the end of the line', function()
+    command('set nowrap sidescroll=1')
+    feed('$')
+    screen:expect([[
+      dddddddddddddddddEN^D|
+      ~                   |
+      ~                   |
+                          |
+    ]])
+    feed('0')
+    screen:expect([[
+      ^ab      cＸddddddddd|
+      ~                   |
+      ~                   |
+                          |
+    ]])
+    feed('$x')
+    screen:expect([[
+      dddddddddddddddddE^N |
+      ~                   |
+      ~                   |
+                          |
+    ]])
+  end)
+end)
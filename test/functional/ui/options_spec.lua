@@ -29,6 +29,7 @@ describe('ui receives option updates', function()
       ext_multigrid=false,
       ext_messages=false,
       ext_termcolors=false,
+      ext_packedlines=false,
     }
 
     clear(...)
@@ -0,0 +1,64 @@
+local helpers = require('test.functional.helpers')(after_each)
+local Screen = require('test.functional.ui.screen')
+local clear, command, eq, meths = helpers.clear, helpers.command, helpers.eq,
+  helpers.meths
+local expect_err = helpers.expect_err
+
+describe('ext_packedlines', function()
+  local screen
+
+  before_each(function()
+    clear()
+    screen = Screen.new(20, 5)
+    screen:attach({ext_packedlines=true})
+    screen:set_default_attr_ids({
+      [1] = {bold = true, foreground = Screen.colors.Blue1},
+      [2] = {foreground = Screen.colors.Red},
+    })
+  end)
+
+  after_each(function()
+    screen:detach()
+  end)
+
+  it('draws highlighted text', function()
+    meths.buf_set_lines(0, 0, -1, true, {'abc def', 'xyz'})
+    command('hi Err guifg=Red')
+    meths.buf_add_highlight(0, -1, 'Err', 0, 4, 7)
+    screen:expect([[
+      ^abc {2:def}             |
+      xyz                 |
+      {1:~                   }|
+      {1:~                   }|
+                          |
+    ]])
+  end)
+
+  it('draws double-width and composing chars, again after a change',
+  function()
+    meths.buf_set_lines(0, 0, -1, true, {'ＸＸaé̀', 'é̀Ｘ'})
+    screen:expect([[
+      ^ＸＸaé̀              |
+      é̀Ｘ                 |
+      {1:~                   }|
+      {1:~                   }|
+                          |
+    ]])
+    -- the glyphs sent before are now sent by number
+    meths.buf_set_lines(0, 0, 1, true, {'é̀Ｘé̀ＸＸ'})
+    screen:expect([[
+      ^é̀Ｘé̀ＸＸ            |
+      é̀Ｘ                 |
+      {1:~                   }|
+      {1:~                   }|
+                          |
+    ]])
+  end)
+
+  it('cannot be changed', function()
+    expect_err('ext_packedlines option cannot be changed',
+               meths.ui_set_option, 'ext_packedlines', false)
+    eq(true, meths.list_uis()[1].ext_packedlines)
+    eq(true, meths.list_uis()[1].ext_linegrid)
+  end)
+end)
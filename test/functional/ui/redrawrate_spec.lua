@@ -0,0 +1,68 @@
+local helpers = require('test.functional.helpers')(after_each)
+local Screen = require('test.functional.ui.screen')
+local clear, command, eq, ok = helpers.clear, helpers.command, helpers.eq,
+  helpers.ok
+local meths, request = helpers.meths, helpers.request
+local exc_exec = helpers.exc_exec
+
+describe("'redrawrate'", function()
+  local screen
+
+  before_each(function()
+    clear()
+    screen = Screen.new(20, 5)
+    screen:attach()
+  end)
+
+  after_each(function()
+    screen:detach()
+  end)
+
+  it('is zero by default and cannot be negative', function()
+    eq(0, meths.get_option('redrawrate'))
+    eq('Vim(set):E487: Argument must be positive: redrawrate=-1',
+       exc_exec('set redrawrate=-1'))
+  end)
+
+  it('draws changes made in between together', function()
+    command('set redrawrate=2')
+    screen:expect([[
+      ^                    |
+      ~                   |
+      ~                   |
+      ~                   |
+                          |
+    ]])
+    local before = request('nvim__stats')
+    for i = 1, 10 do
+      meths.buf_set_lines(0, 0, -1, true, {'line ' .. i})
+    end
+    screen:expect([[
+      ^line 10             |
+      ~                   |
+      ~                   |
+      ~                   |
+                          |
+    ]])
+    local after = request('nvim__stats')
+    ok(after.redraw - before.redraw <= 2)
+    ok(after.redraw_deferred > before.redraw_deferred)
+    ok(after.redraw_time_max >= after.redraw_time)
+  end)
+
+  it('draws the cursor window and the other windows', function()
+    command('set redrawrate=5')
+    command('split')
+    meths.buf_set_lines(0, 0, -1, true, {'one', 'two'})
+    screen:expect([[
+      ^one                 |
+      {1:[No Name] [+]       }|
+      one                 |
+      {2:[No Name] [+]       }|
+                          |
+    ]], {
+      [1] = {bold = true, reverse = true},
+      [2] = {reverse = true},
+    })
+  end)
+end)
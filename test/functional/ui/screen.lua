@@ -218,8 +218,13 @@ function Screen:attach(options, session)
     options.ext_linegrid = true
   end
 
+  if options.ext_packedlines then
+    options.ext_linegrid = true
+  end
+
   self._session = session
   self._options = options
+  self._glyphs = {}
   self._clear_attrs = (options.ext_linegrid and {{},{}}) or {}
   self:_handle_resize(self._width, self._height)
   self.uimeths.attach(self._width, self._height, options)
@@ -880,6 +885,42 @@ function Screen:_handle_grid_line(grid, row, col, items)
   end
 end
 
+function Screen:_handle_grid_line_packed(grid, row, col, data)
+  assert(self._options.ext_packedlines)
+  local pos = 1
+  local function num()
+    local n, scale = 0, 1
+    repeat
+      local byte = data:byte(pos)
+      pos = pos + 1
+      n = n + (byte % 128) * scale
+      scale = scale * 128
+    until byte < 128
+    return n
+  end
+  local items = {}
+  while pos <= #data do
+    local count = num()
+    local hl_id = (count % 2 == 1) and num() or nil
+    local glyph = num()
+    local text
+    if glyph < 128 then
+      text = (glyph == 0) and '' or string.char(glyph)
+    elseif glyph == 128 then
+      local len = num()
+      text = data:sub(pos, pos+len-1)
+      pos = pos + len
+      if #self._glyphs < 4096 then
+        table.insert(self._glyphs, text)
+      end
+    else
+      text = self._glyphs[glyph-128]
+    end
+    table.insert(items, {text, hl_id, math.floor(count / 2)})
+  end
+  self:_handle_grid_line(grid, row, col, items)
+end
+
 function Screen:_handle_bell()
   self.bell = true
 end
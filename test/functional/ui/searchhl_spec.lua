@@ -499,5 +499,46 @@ describe('search highlighting', function()
     ]])
 
   end)
+
+  it('works on a long line and after changing it', function()
+    command('set nowrap sidescroll=0')
+    helpers.funcs.setline(1, string.rep('ab ', 20000) .. 'end')
+    feed('/ab<cr>$')
+    screen:expect([[
+      ]] .. string.rep('{2:ab} ', 6) .. [[en^d                   |
+      {1:~                                       }|
+      {1:~                                       }|
+      {1:~                                       }|
+      {1:~                                       }|
+      {1:~                                       }|
+      /ab                                     |
+    ]])
+    feed('bbrx')
+    screen:expect([[
+      ]] .. string.rep('{2:ab} ', 5) .. [[^xb end                   |
+      {1:~                                       }|
+      {1:~                                       }|
+      {1:~                                       }|
+      {1:~                                       }|
+      {1:~                                       }|
+      /ab                                     |
+    ]])
+  end)
+
+  it('keeps going on a long line after the time limit', function()
+    command('set nowrap sidescroll=0 redrawtime=1')
+    helpers.funcs.setline(1, string.rep('ab ', 100000) .. 'end')
+    feed('/ab<cr>$')
+    screen:expect([[
+      ]] .. string.rep('{2:ab} ', 6) .. [[en^d                   |
+      {1:~                                       }|
+      {1:~                                       }|
+      {1:~                                       }|
+      {1:~                                       }|
+      {1:~                                       }|
+      /ab                                     |
+    ]])
+    eq(1, eval('v:hlsearch'))
+  end)
 end)
 
@@ -0,0 +1,90 @@
+local helpers = require('test.functional.helpers')(after_each)
+local Screen = require('test.functional.ui.screen')
+local clear, command, eq, eval, feed = helpers.clear, helpers.command,
+  helpers.eq, helpers.eval, helpers.feed
+local curbufmeths, ok, source = helpers.curbufmeths, helpers.ok,
+  helpers.source
+
+describe('status line', function()
+  local screen
+
+  before_each(function()
+    clear()
+    screen = Screen.new(20, 6)
+    screen:attach()
+  end)
+
+  after_each(function()
+    screen:detach()
+  end)
+
+  it('is not evaluated again when nothing changed', function()
+    source([[
+      let g:n = 0
+      function! Stl() abort
+        let g:n += 1
+        return 'stl ' . g:n
+      endfunction
+      set laststatus=2 statusline=%{Stl()}
+      split
+    ]])
+    local n = eval('g:n')
+    feed('<C-L>')
+    screen:expect({any = 'stl ' .. (n + 2)})
+    -- Redrawing all status lines uses the ones built before.
+    feed('<C-L>')
+    eq(n + 2, eval('g:n'))
+    command('redrawstatus!')
+    ok(eval('g:n') >= n + 4)
+  end)
+
+  it('shows the cursor position and the modified flag', function()
+    command('set laststatus=2 statusline=%l%m')
+    curbufmeths.set_lines(0, -1, true, {'one', 'two', 'three'})
+    command('set nomodified')
+    feed('j')
+    screen:expect([[
+      one                 |
+      ^two                 |
+      three               |
+      ~                   |
+      2                   |
+                          |
+    ]])
+    feed('x')
+    screen:expect([[
+      one                 |
+      ^wo                  |
+      three               |
+      ~                   |
+      2[+]                |
+                          |
+    ]])
+  end)
+
+  it('shows options and the file name changed by a command', function()
+    command('set laststatus=2 statusline=%t%r%y')
+    feed('<C-L>')
+    screen:expect({any = '%[No Name%]'})
+    command('set filetype=c')
+    screen:expect({any = '%[No Name%]%[c%]'})
+    command('set readonly')
+    screen:expect({any = '%[No Name%]%[RO%]%[c%]'})
+    command('file Xname')
+    screen:expect({any = 'Xname%[RO%]%[c%]'})
+  end)
+
+  it('evaluates an expression again for Visual mode and recording',
+  function()
+    command('set laststatus=2')
+    command('set statusline=%{mode()}/%{reg_recording()}')
+    feed('<C-L>')
+    screen:expect({any = 'n/ '})
+    feed('v')
+    screen:expect({any = 'v/ '})
+    feed('<Esc>qa')
+    screen:expect({any = 'n/a'})
+    feed('q')
+    screen:expect({any = 'n/ '})
+  end)
+end)
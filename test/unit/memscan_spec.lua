@@ -0,0 +1,92 @@
+local helpers = require("test.unit.helpers")(after_each)
+local itp = helpers.gen_itp(it)
+
+local cimport = helpers.cimport
+local eq = helpers.eq
+local ffi = helpers.ffi
+
+local m = cimport('./src/nvim/memscan.h')
+
+local function buf(s)
+  local p = ffi.new('char_u[?]', #s + 1)
+  ffi.copy(p, s, #s)
+  return p
+end
+
+describe('memscan_eol()', function()
+  local function eol(s, cr)
+    local p = buf(s)
+    return tonumber(m.memscan_eol(p, p + #s, cr) - p)
+  end
+
+  itp('finds NL and NUL', function()
+    eq(0, eol('\nabc', false))
+    eq(3, eol('abc\n', false))
+    eq(3, eol('abc\0def\n', false))
+    eq(5, eol('abcde', false))
+    eq(0, eol('', false))
+  end)
+
+  itp('finds CR only when asked to', function()
+    eq(6, eol('abc\rde\n', false))
+    eq(3, eol('abc\rde\n', true))
+  end)
+
+  itp('finds a line break at any position of a long text', function()
+    for _, len in ipairs({15, 16, 17, 31, 32, 33, 63, 64, 65, 100}) do
+      for i = 0, len - 1 do
+        local s = string.rep('x', i) .. '\n' .. string.rep('y', len - i - 1)
+        eq(i, eol(s, false))
+      end
+      eq(len, eol(string.rep('z', len), true))
+    end
+  end)
+end)
+
+describe('memscan_count()', function()
+  local function count(s, c)
+    local p = buf(s)
+    return tonumber(m.memscan_count(p, p + #s, c:byte()))
+  end
+
+  itp('counts bytes', function()
+    eq(0, count('', '\n'))
+    eq(0, count('abc', '\n'))
+    eq(2, count('a\nb\n', '\n'))
+    eq(3, count('\r\r\r', '\r'))
+  end)
+
+  itp('counts bytes in a long text', function()
+    local s = string.rep('ab\ncd\r\n', 37)
+    eq(74, count(s, '\n'))
+    eq(37, count(s, '\r'))
+    eq(37, count(s, 'a'))
+  end)
+end)
+
+describe('memscan_diff() and memscan_rdiff()', function()
+  local function diff(a, b)
+    return tonumber(m.memscan_diff(buf(a), buf(b), #a)),
+           tonumber(m.memscan_rdiff(buf(a), buf(b), #a))
+  end
+
+  itp('find the first and last different byte', function()
+    eq({0, 0}, {diff('', '')})
+    eq({3, 0}, {diff('abc', 'abc')})
+    eq({1, 2}, {diff('abc', 'aXc')})
+    eq({0, 3}, {diff('abc', 'XbX')})
+  end)
+
+  itp('find different bytes at any position of a long text', function()
+    for _, len in ipairs({15, 16, 17, 31, 32, 33, 63, 64, 65, 100}) do
+      local a = string.rep('x', len)
+      eq({len, 0}, {diff(a, a)})
+      for i = 0, len - 1 do
+        local b = string.rep('x', i) .. 'y' .. string.rep('x', len - i - 1)
+        eq({i, i + 1}, {diff(a, b)})
+      end
+      local b = 'y' .. string.rep('x', len - 2) .. 'y'
+      eq({0, len}, {diff(a, b)})
+    end
+  end)
+end)
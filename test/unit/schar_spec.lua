@@ -0,0 +1,52 @@
+local helpers = require("test.unit.helpers")(after_each)
+local itp = helpers.gen_itp(it)
+
+local cimport = helpers.cimport
+local eq = helpers.eq
+local neq = helpers.neq
+local ffi = helpers.ffi
+local to_cstr = helpers.to_cstr
+
+local m = cimport('./src/nvim/schar.h')
+
+local MAX_SCHAR_SIZE = 29
+
+local function get(sc)
+  local buf = ffi.new('char[?]', MAX_SCHAR_SIZE)
+  local len = m.schar_get(buf, sc)
+  return ffi.string(buf, len)
+end
+
+local function from_str(s)
+  return m.schar_from_str(to_cstr(s))
+end
+
+describe('schar', function()
+  itp('stores a character in the cell', function()
+    for _, s in ipairs({'', 'a', ' ', 'é', '€', '𝄞', '\xff'}) do
+      eq(s, get(from_str(s)))
+    end
+    eq(0, from_str(''))
+    eq(from_str(' '), m.schar_from_ascii(32))
+    eq(from_str('€'), m.schar_from_char(0x20ac))
+    eq(true, m.schar_is_single_byte(from_str('a')))
+    eq(false, m.schar_is_single_byte(from_str('é')))
+  end)
+
+  itp('gives the same value for the same text', function()
+    local texts = {'e\xcc\x81', 'a\xcc\x81\xcc\x82', 'e\xcc\x81\xcc\x82'}
+    local values = {}
+    for i, s in ipairs(texts) do
+      values[i] = from_str(s)
+      eq(s, get(values[i]))
+    end
+    for i, s in ipairs(texts) do
+      eq(values[i], from_str(s))
+      for j = i + 1, #texts do
+        neq(values[i], values[j])
+      end
+    end
+    local u8cc = ffi.new('int[?]', 6, {0x301, 0x302})
+    eq(values[3], m.schar_from_cc(string.byte('e'), u8cc))
+  end)
+end)